@@ -21,10 +21,24 @@
 # include <fcntl.h>
 # include <signal.h>
 # include <cstring>
+# include <cstdlib>
+# include <ctime>
 # include "Config.hpp"
 # include "Request.hpp"
 # include "FileHandler.hpp"
 # include "HTTPCommon.hpp"
+# include "TimerWheel.hpp"
+# include "Gzip.hpp"
+# include "ResponseCache.hpp"
+
+struct RuntimeLocation;
+
+# define CGI_TIMEOUT			5
+# define CGI_MAX_HEADER		8192		// bloc d'en-têtes CGI maximal
+# define CGI_BUFFER_LIMIT	262144		// sortie en attente avant pause de stdout
+
+class	FastCGIConnection;
+class	ProxyConnection;
 
 struct	CGIResult {
 	int			exitCode;
@@ -32,6 +46,69 @@ struct	CGIResult {
 	bool		success;
 };
 
+/*	============================================================================
+	CGIHeaders : en-têtes émis par le script avant la ligne vide
+	(Status et Content-Type interprétés, les autres relayés tels quels)
+	============================================================================ */
+
+struct	CGIHeaders {
+	int													statusCode;
+	std::string											contentType;
+	long												contentLength;	// -1 si absent
+	std::vector<std::pair<std::string, std::string> >	extra;
+};
+
+/*	============================================================================
+	CGIJob : processus CGI asynchrone piloté par la boucle principale
+	Les pipes sont non bloquants et enregistrés auprès du poller ; le job
+	se termine quand stdout atteint EOF. Dès que le bloc d'en-têtes est
+	complet, le corps est relayé au client au fil de l'eau (chunked si le
+	script n'annonce pas de Content-Length).
+	============================================================================ */
+
+struct	CGIJob {
+	pid_t			pid;
+	int				stdinFd;		// -1 une fois le body entièrement écrit
+	int				stdoutFd;		// -1 une fois EOF atteint
+	std::string		input;
+	size_t			inputOffset;
+	CGIResult		result;
+	bool			exited;
+	bool			timedOut;
+	time_t			lastActivity;
+	Timer			timer;			// échéance CGI_TIMEOUT dans la boucle
+	ServerConfig*	server;
+	bool			keepAlive;
+	int				keepAliveTimeout;
+	std::string		httpVersion;	// version de la requête cliente
+	size_t			headerScan;		// octets déjà examinés pour la fin des en-têtes
+	bool			headersSent;
+	bool			chunked;
+	long			contentLength;	// annoncé par le script, -1 sinon
+	long			bodySent;
+	bool			paused;			// stdout retiré du poller (client lent)
+	const RuntimeLocation*	location;	// politique gzip de la location
+	bool			acceptsGzip;	// Accept-Encoding du client
+	GzipStream*		gzip;			// corps streamé compressé, NULL sinon
+	// Corps resté sur disque, relu par tranches (pread) par FastCGI et le proxy
+	int									bodyFd;			// spool du parseur, -1 si corps en mémoire
+	size_t								bodySize;
+	// Backend FastCGI (pid == -1, pas de pipes) : voir FastCGI.hpp
+	std::string							fastcgiPass;
+	std::map<std::string, std::string>	params;
+	FastCGIConnection*					fcgiConn;	// NULL hors connexion active
+	int									fcgiId;
+	// Reverse proxy (pid == -1 aussi) : voir Proxy.hpp
+	std::string							proxyPass;		// nom de l'upstream
+	std::string							proxyMethod;
+	std::string							proxyRequest;	// tête de requête pour le backend
+	ProxyConnection*					proxyConn;		// NULL hors connexion active
+	std::vector<size_t>					proxyTried;		// serveurs en échec pour ce job
+	CacheTicket							cache;			// microcache (cache_valid), clé vide sinon
+
+	~CGIJob();
+};
+
 class	CGIHandler {
 
 	public:
@@ -39,11 +116,23 @@ class	CGIHandler {
 								const std::map<std::string, std::string> &handlers);
 		static std::string	getCGIInterpreter(const std::string &filePath,
 											const std::map<std::string, std::string> &handlers);
-		static CGIResult	execute(const std::string &scriptPath, const Request &request,
-								const ServerConfig &server,
+		static CGIJob*		start(const std::string &scriptPath, const Request &request,
+								ServerConfig &server,
 								const std::map<std::string, std::string> &handlers);
+		static CGIJob*		prepareFastCGI(const std::string &scriptPath, const Request &request,
+								ServerConfig &server, const std::string &pass);
+		static CGIJob*		prepareProxy(const Request &request, ServerConfig &server,
+								const std::string &pass, const std::string &uri);
+		static ssize_t		writeInput(CGIJob &job);
+		static ssize_t		readOutput(CGIJob &job);
+		static bool			reap(CGIJob &job);
+		static void			kill(CGIJob &job);
+		static size_t		findHeaderEnd(CGIJob &job, size_t &bodyStart);
+		static void			parseHeaders(const std::string &block, CGIHeaders &headers);
 
 	private:
+		static CGIJob*		_newJob(const Request &request, ServerConfig &server);
+		static bool			_openBody(const Request &request, CGIJob *job);
 		static std::map<std::string, std::string>
 				_buildCGIEnvironment(const Request &request, const std::string &scriptPath,
 									const ServerConfig &server);
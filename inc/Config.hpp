@@ -19,10 +19,16 @@
 #include <sstream>
 #include <iostream>
 #include <cstdlib>
+#include <sys/socket.h>
 #include "Exceptions.hpp"
 
+// Valeurs spéciales de la directive "expires" (sinon : durée en secondes)
+#define EXPIRES_OFF		-1
+#define EXPIRES_EPOCH	-2
+
 struct	LocationConfig {
 	std::string							path;
+	bool								exactMatch;		// "location = /chemin"
 	std::string							root;
 	std::vector<std::string>			allowedMethods;
 	std::string							index;
@@ -31,6 +37,60 @@ struct	LocationConfig {
 	bool								allowUpload;
 	std::string							uploadStore;
 	std::map<std::string, std::string>	cgiHandlers;
+	std::string							fastcgiPass;	// "unix:/chemin" ou "hôte:port"
+	std::string							proxyPass;		// nom d'un bloc upstream
+	std::string							proxyUri;		// remplace le préfixe de la location si non vide
+	long								expires;		// secondes, ou EXPIRES_OFF/EXPIRES_EPOCH
+	std::string							cacheControl;	// remplace le Cache-Control de expires
+	bool								gzipStatic;		// sert "fichier.gz" si le client accepte gzip
+	bool								gzip;			// compression à la volée
+	std::vector<std::string>			gzipTypes;		// en plus de text/html, "*" : tous
+	long								gzipMinLength;
+	int									gzipLevel;		// 1 (rapide) à 9 (compact)
+	long								maxBodySize;	// -1 : hérite du serveur
+	std::map<int, long>					cacheValid;		// code -> secondes (0 : tout code)
+	std::string							cacheKey;		// "$host$request_uri" par défaut
+	std::vector<std::string>			cacheBypass;	// une valeur non vide et != "0" : pas de lecture
+};
+
+/*	============================================================================
+	Bloc "upstream" : serveurs derrière un proxy_pass et leur répartition
+	============================================================================ */
+
+#define UPSTREAM_ROUND_ROBIN	0
+#define UPSTREAM_LEAST_CONN		1
+#define UPSTREAM_HASH			2
+
+struct	UpstreamServer {
+	std::string					address;		// "hôte:port" ou "[ipv6]:port"
+	struct sockaddr_storage		sockaddr;		// résolue une fois à la lecture de la config
+	socklen_t					sockaddrLen;
+	int							weight;
+	int							maxFails;		// 0 : jamais écarté
+	int							failTimeout;	// secondes
+};
+
+struct	UpstreamConfig {
+	std::string					name;
+	int							balance;		// UPSTREAM_*
+	std::string					hashKey;		// "$request_uri", "$host$uri"...
+	bool						consistent;		// anneau de hachage (ketama)
+	int							keepalive;		// connexions inactives gardées par serveur
+	std::vector<UpstreamServer>	servers;
+};
+
+struct	GlobalConfig {
+	std::string					eventBackend;
+	int							workerProcesses;	// 1 : pas de fork
+	int							openFileCacheMax;	// 0 : désactivé
+	int							openFileCacheValid;	// secondes
+	long						contentCacheSize;	// octets, 0 : désactivé
+	long						contentCacheMaxFile;	// taille max d'un fichier mis en cache
+	long						responseCacheSize;		// réponses CGI/proxy, 0 : désactivé
+	long						responseCacheMaxEntry;
+	std::string					responseCachePath;		// débordement sur disque, vide : aucun
+	long						responseCacheDiskSize;
+	std::map<std::string, UpstreamConfig>	upstreams;
 };
 
 struct	ServerConfig {
@@ -38,9 +98,17 @@ struct	ServerConfig {
 	std::string					host;
 	std::string					root;
 	long						maxBodySize;
+	long						clientBodyBufferSize;	// au-delà, le corps part sur disque
+	std::string					clientBodyTempPath;
 	std::map<int, std::string>	errorPages;
 	std::vector<LocationConfig>	locations;
 	std::vector<std::string>	serverNames;
+	int							keepaliveTimeout;
+	int							keepaliveRequests;
+	int							clientHeaderTimeout;	// secondes
+	int							clientBodyTimeout;
+	int							sendTimeout;
+	long						sendMinRate;			// octets/s, 0 = désactivé
 };
 
 class	ConfigParser {
@@ -50,16 +118,20 @@ public:
 	~ConfigParser();
 
 	std::vector<ServerConfig>	parse(const std::string &filepath);
+	const GlobalConfig&			getGlobalConfig() const;
 
 private:
 	std::string					_fileContent;
 	size_t						_position;
 	int							_lineNumber;
+	GlobalConfig				_global;
 
 	void						_readFile(const std::string &filepath);
 	void						_skipSpacesAndC();
 	std::string					_formatErrorMsg(const std::string &msg);
 	int							_stringToInt(const std::string &str);
+	long						_stringToSize(const std::string &str);
+	long						_parseExpires(const std::string &str);
 	bool						_stringToBool(const std::string &str);
 	std::string					_readToken();
 	std::string					_peekToken();
@@ -69,4 +141,15 @@ private:
 	void						_parseLocationDirective(const std::string &key, LocationConfig &location);
 	LocationConfig				_parseLocationBlock();
 	ServerConfig				_parseServerBlock();
+	void						_parseEventsBlock();
+	void						_parseWorkerProcesses();
+	void						_parseOpenFileCache();
+	void						_parseContentCache();
+	void						_parseResponseCache();
+	void						_parseCacheValid(LocationConfig &location);
+	void						_parseUpstreamBlock();
+	void						_parseUpstreamServer(UpstreamConfig &upstream);
+	void						_resolveUpstreamServer(UpstreamServer &server);
+	void						_parseProxyPass(const std::string &target, LocationConfig &location);
+	void						_resolveUpstreams(std::vector<ServerConfig> &servers);
 };
@@ -0,0 +1,61 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ContentCache.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 18:40:22 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 18:40:22 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef CONTENTCACHE_HPP
+# define CONTENTCACHE_HPP
+
+# include <string>
+# include <list>
+# include <map>
+# include "OutputQueue.hpp"
+# include "OpenFileCache.hpp"
+
+/*	============================================================================
+	ContentCache: small static files kept as ready-to-send responses
+	Each entry is one SharedBuffer: status line and headers (minus the
+	per-connection "Connection" lines and the blank line), then the body;
+	split() marks where the head ends. Connections queue slices of the
+	block, so a hit costs neither a read nor a copy. Entries are checked
+	against the file's FileInfo (through OpenFileCache) on every hit and
+	the cache is bounded in bytes, least recently used out first.
+	============================================================================ */
+
+class	ContentCache {
+
+	private:
+		struct	Entry {
+			std::string		path;
+			FileInfo		info;
+			SharedBuffer	*buffer;
+		};
+		typedef std::list<Entry>								EntryList;
+		typedef std::map<std::string, EntryList::iterator>		EntryIndex;
+
+		static EntryList	_lru;
+		static EntryIndex	_index;
+		static size_t		_bytes;
+		static size_t		_maxBytes;
+		static size_t		_maxFile;
+
+		static void			_drop(EntryList::iterator it);
+
+	public:
+		static void			configure(size_t maxBytes, size_t maxFile);
+		static bool			accepts(long size);
+		static SharedBuffer	*lookup(const std::string &path, const FileInfo &info);
+		static void			store(const std::string &path, const FileInfo &info,
+		                          SharedBuffer *buffer);
+		static void			invalidate(const std::string &path);
+		static void			clear();
+};
+
+#endif
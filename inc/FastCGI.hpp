@@ -0,0 +1,128 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.hpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 14:05:12 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 14:05:12 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <deque>
+#include <sys/types.h>
+#include "CGIHandler.hpp"
+
+# define FCGI_VERSION_1				1
+# define FCGI_BEGIN_REQUEST			1
+# define FCGI_ABORT_REQUEST			2
+# define FCGI_END_REQUEST			3
+# define FCGI_PARAMS				4
+# define FCGI_STDIN					5
+# define FCGI_STDOUT				6
+# define FCGI_STDERR				7
+# define FCGI_GET_VALUES			9
+# define FCGI_GET_VALUES_RESULT		10
+# define FCGI_RESPONDER				1
+# define FCGI_KEEP_CONN				1
+# define FCGI_REQUEST_COMPLETE		0
+# define FCGI_HEADER_LEN			8
+# define FCGI_MAX_CONTENT			65535
+
+# define FASTCGI_MAX_CONNS			4	// connexions ouvertes par backend
+# define FASTCGI_MAX_REQUESTS		16	// requêtes multiplexées par connexion
+
+/*	============================================================================
+	FastCGIConnection : une connexion persistante vers un serveur applicatif
+	Plusieurs CGIJob y sont multiplexés (un request id chacun). Tant que le
+	backend n'a pas confirmé FCGI_MPXS_CONNS, une seule requête à la fois.
+	Les records STDOUT sont ajoutés à job->result.output, exactement comme
+	la lecture d'un pipe CGI ; la boucle principale fait le reste. Un
+	corps resté sur disque part en records STDIN relus par tranches au
+	fil des écritures : jamais plus d'un record d'avance en mémoire.
+	============================================================================ */
+
+class	FastCGIConnection {
+
+private:
+	int							_fd;
+	std::string					_address;
+	std::string					_out;
+	size_t						_outOffset;
+	std::string					_in;
+	std::map<int, CGIJob*>		_requests;		// NULL : abandonnée, id réservé
+	size_t						_maxRequests;
+	int							_paused;		// jobs dont le client est saturé
+	std::vector<CGIJob*>		_bodies;		// corps sur disque pas encore envoyés
+
+	void		_appendRecord(int type, int id, const char *data, size_t len);
+	void		_appendStream(int type, int id, const std::string &data);
+	void		_appendParams(int id, const std::map<std::string, std::string> &params);
+	void		_handleRecord(int type, int id, const std::string &content,
+							std::vector<CGIJob*> &touched);
+	void		_handleValues(const std::string &content);
+	void		_finish(int id, int appStatus, int protocolStatus,
+							std::vector<CGIJob*> &touched);
+	int			_nextId() const;
+	void		_fillBody();
+	void		_dropBody(CGIJob *job);
+
+	FastCGIConnection(const FastCGIConnection &other);
+	FastCGIConnection	&operator=(const FastCGIConnection &other);
+
+public:
+	FastCGIConnection(const std::string &address);
+	~FastCGIConnection();
+
+	bool				open();
+	int					getFd() const;
+	int					releaseFd();
+	const std::string	&getAddress() const;
+	size_t				activeCount() const;
+	bool				hasCapacity() const;
+	int					interest() const;
+
+	bool				submit(CGIJob *job);
+	void				abort(CGIJob *job);
+	void				setPaused(CGIJob *job, bool paused);
+	ssize_t				flush();
+	ssize_t				receive(std::vector<CGIJob*> &touched);
+	void				failAll(std::vector<CGIJob*> &touched);
+};
+
+/*	============================================================================
+	FastCGIPool : connexions réutilisées, indexées par adresse et par fd
+	acquire() préfère une connexion existante ayant de la place, en ouvre
+	une nouvelle sous FASTCGI_MAX_CONNS, sinon ne rend rien : le job entre
+	dans la file d'attente de l'adresse et repart quand une requête se
+	termine (jamais de request id en trop sur une connexion pleine).
+	============================================================================ */
+
+class	FastCGIPool {
+
+private:
+	std::map<std::string, std::vector<FastCGIConnection*> >	_backends;
+	std::map<int, FastCGIConnection*>						_byFd;
+	std::map<std::string, std::deque<CGIJob*> >				_waiting;
+
+	FastCGIPool(const FastCGIPool &other);
+	FastCGIPool	&operator=(const FastCGIPool &other);
+
+public:
+	FastCGIPool();
+	~FastCGIPool();
+
+	FastCGIConnection	*acquire(const std::string &address, bool &created);
+	FastCGIConnection	*find(int fd) const;
+	void				remove(FastCGIConnection *conn);
+	bool				saturated(const std::string &address);
+	void				wait(CGIJob *job);
+	CGIJob				*nextWaiting(const std::string &address);
+	void				cancelWait(CGIJob *job);
+};
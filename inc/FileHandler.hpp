@@ -21,7 +21,10 @@
 # include <sys/types.h>
 # include <sys/stat.h>
 # include <dirent.h>
+# include <fcntl.h>
+# include <unistd.h>
 # include "HTTPCommon.hpp"
+# include "OpenFileCache.hpp"
 
 class	FileHandler {
 
@@ -31,8 +34,10 @@ class	FileHandler {
 		static bool			isFile(const std::string &path);
 
 		static std::string	getContent(const std::string &path);
+		static int			openForReading(const std::string &path, long &size);
 		static bool			writeContent(const std::string &path, const std::string &content);
 		static bool			deleteFile(const std::string &path);
+		static bool			moveFile(const std::string &from, const std::string &to);
 		static long			getFileSize(const std::string &path);
 		static std::string	getFileExtension(const std::string &path);
 
@@ -43,6 +48,7 @@ class	FileHandler {
 
 		static std::string	buildFilePath(const std::string &root, const std::string &uri);
 		static std::string	extractFileName(const std::string &uri);
+		static std::string	safeFileName(const std::string &name);
 		static std::string	normalizePath(const std::string &path);
 };
 
@@ -0,0 +1,46 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Gzip.hpp                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 10:05:13 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/18 10:05:13 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef GZIP_HPP
+# define GZIP_HPP
+
+# include <string>
+# include <zlib.h>
+
+/*	============================================================================
+	GzipStream: incremental gzip encoder (zlib deflate, gzip wrapper)
+	Bodies that arrive piecewise (streamed CGI) are compressed one chunk
+	at a time with a sync flush, so each chunk can go out immediately and
+	the event loop never stalls on a whole response. compress() is the
+	one-shot form for bodies already in memory.
+	============================================================================ */
+
+class	GzipStream {
+
+	private:
+		z_stream	_zs;
+		bool		_open;
+
+		GzipStream(const GzipStream &other);
+		GzipStream	&operator=(const GzipStream &other);
+
+	public:
+		GzipStream(int level);
+		~GzipStream();
+
+		bool		isOpen() const;
+		bool		write(const std::string &in, std::string &out, bool finish);
+
+		static bool	compress(const std::string &in, int level, std::string &out);
+};
+
+#endif
@@ -17,17 +17,27 @@
 # include <map>
 # include <cstdlib>
 # include <vector>
+# include <ctime>
+# include <sys/types.h>
 class RequestHandler;
+struct RawRequest;
+struct CGIJob;
+struct RawResponse;
+class Response;
+class SharedBuffer;
 # include "Config.hpp"
 
 /*	============================================================================
 	HTTP STATUS CODES
 	============================================================================ */
 
+# define HTTP_CONTINUE_LINE			"HTTP/1.1 100 Continue\r\n\r\n"
+
 # define HTTP_OK					200
 # define HTTP_CREATED				201
 # define HTTP_ACCEPTED				202
 # define HTTP_NO_CONTENT			204
+# define HTTP_PARTIAL_CONTENT		206
 # define HTTP_MOVED_PERMANENTLY		301
 # define HTTP_FOUND					302
 # define HTTP_NOT_MODIFIED			304
@@ -36,11 +46,15 @@ class RequestHandler;
 # define HTTP_FORBIDDEN				403
 # define HTTP_NOT_FOUND				404
 # define HTTP_METHOD_NOT_ALLOWED	405
+# define HTTP_REQUEST_TIMEOUT		408
 # define HTTP_CONFLICT				409
 # define HTTP_PAYLOAD_TOO_LARGE		413
+# define HTTP_RANGE_NOT_SATISFIABLE	416
 # define HTTP_INTERNAL_SERVER_ERROR	500
 # define HTTP_NOT_IMPLEMENTED		501
+# define HTTP_BAD_GATEWAY			502
 # define HTTP_SERVICE_UNAVAILABLE	503
+# define HTTP_GATEWAY_TIMEOUT		504
 
 /*	============================================================================
 	HTTP METHODS
@@ -62,13 +76,99 @@ class RequestHandler;
 	int				httpStringToMethod(const std::string &method);
 	std::string		httpMethodToString(int method);
 	std::string		httpIntToString(long num);
+	std::string		httpSizeToHex(size_t num);
+	std::string		httpFormatDate(time_t when);
+	time_t			httpParseDate(const std::string &date);
+	bool			httpAcceptsEncoding(const std::string &accept, const std::string &coding);
 	std::string		httpToLower(const std::string &str);
 	std::string		httpStatusCodeToMessage(int code);
 	bool			httpIsValidVersion(const std::string &version);
 	bool			httpIsValidMethod(const std::string &method);
+	bool			httpParseContentLength(const std::string &value, long &length);
 	std::string		httpGetMimeType(const std::string &filename);
 	void			httpInitMimeTypes(void);
 
+/*	============================================================================
+	BYTE RANGES (Range: bytes=...)
+	============================================================================ */
+
+# define HTTP_MAX_RANGES	16		// more ranges than this: Range is ignored
+
+	struct	HTTPRange {
+		long	first;
+		long	last;				// inclusive
+	};
+
+	// Slice of a response's body file, preceded by in-memory bytes
+	// (multipart/byteranges part headers, or the closing boundary alone)
+	struct	FileRange {
+		std::string	prefix;
+		off_t		offset;
+		long		length;
+	};
+
+	int				httpParseRange(const std::string &value, long size,
+	                               std::vector<HTTPRange> &ranges);
+
+/*	============================================================================
+	HTTP CONNECTION STATE (keep-alive)
+	============================================================================ */
+
+	struct	HTTPConnection {
+		int		port;				// listening port the client connected to
+		int		requestCount;		// requests already answered on this socket
+		bool	keepAlive;			// out: keep the socket open after the response
+		int		keepAliveTimeout;	// out: idle timeout in seconds
+	};
+
+/*	============================================================================
+	CLIENT TIMEOUTS (seconds)
+	The header phase always uses the port's default server: the virtual
+	host is only known once the headers are in. Body and send limits
+	follow the virtual host that answers.
+	============================================================================ */
+
+	struct	ClientTimeouts {
+		int		header;		// client_header_timeout
+		int		body;		// client_body_timeout
+		int		send;		// send_timeout
+		long	minRate;	// send_min_rate, bytes/s, 0 if disabled
+	};
+
+/*	============================================================================
+	REQUEST BODY POLICY (decided once the headers are parsed)
+	============================================================================ */
+
+	struct	BodyPolicy {
+		size_t		maxSize;		// max_body_size of the route, 0 if unlimited
+		size_t		memoryLimit;	// client_body_buffer_size, then spooled to disk
+		std::string	directory;		// where the temp file goes
+		std::string	boundary;		// multipart upload: split into parts while reading
+	};
+
+	// One multipart/form-data part; file parts are already on disk
+	struct	UploadPart {
+		std::string	name;		// form field name
+		std::string	filename;	// as sent by the client, empty for plain fields
+		std::string	path;		// temp file holding the content, empty if discarded
+	};
+
+/*	============================================================================
+	HTTP OUTPUT (segments queued as-is on the client's OutputQueue)
+	============================================================================ */
+
+	struct	HTTPOutput {
+		std::string	head;		// status line and headers
+		std::string	body;		// in-memory body, may be empty
+		int			fileFd;		// file body streamed after head, -1 if none
+		long		fileLength;
+		std::vector<FileRange>	fileRanges;	// slices of fileFd, whole file if empty
+		CGIJob*		cgi;		// pending CGI job: head/body come later, NULL if none
+		SharedBuffer*	shared;	// cached status line + headers + body, head is the tail
+
+		HTTPOutput() : fileFd(-1), fileLength(0), cgi(NULL), shared(NULL) {}
+	};
+
 /*	============================================================================
 	HTTP SERVER ENGINE
 	============================================================================ */
@@ -78,10 +178,20 @@ class RequestHandler;
 		private:
 			RequestHandler*	_handler;
 
+			static bool	_fromCache(const Response &resp, const RawResponse &raw,
+			                       HTTPOutput &out);
+
 		public:
 			HTTPServerEngine(const std::vector<ServerConfig> &servers);
 			~HTTPServerEngine();
-			std::string processRequest(const std::string &rawData, int clientPort);
+			HTTPOutput	processRequest(const RawRequest &raw, HTTPConnection &conn);
+			BodyPolicy	bodyPolicy(const RawRequest &raw, int port);
+			bool		clientTimeouts(const RawRequest &raw, int port, ClientTimeouts &out);
+			HTTPOutput	rejectRequest(const RawRequest &raw, int port, int code,
+			                          const std::string &message);
+			HTTPOutput	finishCGI(CGIJob &job);
+			HTTPOutput	startCGIStream(CGIJob &job, size_t headerEnd, size_t bodyStart);
+			std::string buildErrorResponse(int code, const std::string &message);
 	};
 
 #endif
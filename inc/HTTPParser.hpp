@@ -15,6 +15,7 @@
 
 # include <string>
 # include <map>
+# include <vector>
 # include <cstdlib>
 # include "HTTPCommon.hpp"
 # include "Exceptions.hpp"
@@ -24,24 +25,24 @@ struct	RawRequest {
 	std::string							uri;
 	std::string							version;
 	std::map<std::string, std::string>	headers;
-	std::string							body;
+	std::string							body;		// empty when spooled to bodyFile
+	std::string							bodyFile;	// temp file holding the body, if any
+	size_t								bodySize;
+	std::vector<UploadPart>				parts;		// multipart upload, split while reading
 	int									headerCount;
+	bool								closeAfter;	// framing was suspicious: no keep-alive
 };
 
 class	HTTPParser {
 
 	public:
-		static RawRequest	parseRequest(const std::string &rawData);
-		static bool			isRequestComplete(const std::string &rawData,
-									const std::map<std::string, std::string> &headers);
-		static size_t		findBodyStart(const std::string &rawData);
+		static void			parseRequestLine(const std::string &line, RawRequest &req);
+		static void			parseHeaderLine(const std::string &line, RawRequest &req);
+		static bool			parseChunkSize(const std::string &line, size_t &chunkSize);
 
 	private:
 		static std::string	_trim(const std::string &str);
 		static std::string	_split(const std::string &str, char delimiter, size_t &pos);
-		static void			_parseRequestLine(const std::string &line, RawRequest &req);
-		static void			_parseHeaders(const std::string &headerBlock, RawRequest &req);
-		static std::string	_unchunkBody(const std::string &chunked);
 };
 
 #endif
@@ -24,12 +24,19 @@ struct	RawResponse {
 	std::string							version;
 	std::map<std::string, std::string>	headers;
 	std::string							body;
+	int									bodyFd;		// file body sent with sendfile(), -1 if none
+	long								bodyLength;
+	std::vector<FileRange>				bodyRanges;	// slices of bodyFd, whole file if empty
+
+	RawResponse() : statusCode(0), bodyFd(-1), bodyLength(0) {}
 };
 
 class	HTTPSerializer {
 
 	public:
 		static std::string	serializeResponse(const RawResponse &response);
+		static std::string	serializeHead(const RawResponse &response);
+		static std::string	serializeTail(const RawResponse &response);
 		static RawResponse	createErrorResponse(int code, const std::string &message);
 
 	private:
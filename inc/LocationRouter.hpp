@@ -0,0 +1,55 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationRouter.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 16:05:12 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 16:05:12 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef LOCATIONROUTER_HPP
+# define LOCATIONROUTER_HPP
+
+# include <string>
+# include <vector>
+
+/*	============================================================================
+	LocationRouter: per-server radix trie of location paths
+	Built once at startup; maps each path to the index of its location in
+	the owner's table (see RuntimeServer). Edges hold
+	path fragments (nginx prefix semantics are per character, so "/img"
+	also covers "/images"); each node may carry a prefix location and an
+	exact ("location = /path") one. lookup() walks the URI once, stops at
+	'?' and allocates nothing. Nodes live in a vector and refer to each
+	other by index, so the router can be copied like any config value.
+	============================================================================ */
+
+class	LocationRouter {
+
+	private:
+		struct	Node {
+			std::string								edge;
+			std::vector<std::pair<char, size_t> >	children;
+			int										prefix;		// -1 if none
+			int										exact;
+
+			Node(const std::string &fragment);
+		};
+
+		std::vector<Node>	_nodes;		// _nodes[0] is the root (empty edge)
+
+		long		_child(size_t node, char c) const;
+		void		_setChild(size_t node, char c, size_t child);
+
+	public:
+		LocationRouter();
+		~LocationRouter();
+
+		void		insert(const std::string &path, bool exact, int location);
+		int			lookup(const std::string &uri) const;
+};
+
+#endif
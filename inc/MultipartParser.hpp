@@ -0,0 +1,82 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MultipartParser.hpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 10:02:17 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 10:02:17 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef MULTIPARTPARSER_HPP
+# define MULTIPARTPARSER_HPP
+
+# include <string>
+# include <vector>
+# include "HTTPCommon.hpp"
+
+# define MULTIPART_MAX_HEADERS	8192
+# define MULTIPART_MAX_BOUNDARY	70
+
+/*	============================================================================
+	Streaming multipart/form-data parser (RFC 7578, RFC 2046 §5.1)
+	Fed the decoded request body one recv() slice at a time. The
+	delimiter is searched with Boyer-Moore-Horspool; only the last
+	delimiter-length bytes of a slice are carried over, so memory stays
+	bounded whatever the size of the parts. Each file part is written to
+	its own temp file in the upload store as it arrives; reset() removes
+	the ones nobody moved away.
+	============================================================================ */
+
+class	MultipartParser {
+
+	public:
+		MultipartParser();
+		~MultipartParser();
+
+		static std::string	boundaryOf(const std::string &contentType);
+
+		void				start(const std::string &boundary, const std::string &directory);
+		bool				feed(const char *data, size_t len);
+		bool				finish();
+		void				reset();
+
+		bool				isActive() const;
+		const std::vector<UploadPart>&	getParts() const;
+		const std::string&	getError() const;
+		int					getErrorStatus() const;
+
+	private:
+		enum	State {
+			MP_PREAMBLE,
+			MP_DELIMITER,
+			MP_HEADERS,
+			MP_BODY,
+			MP_EPILOGUE,
+			MP_ERROR
+		};
+
+		State					_state;
+		bool					_active;
+		std::string				_delimiter;		// "\r\n--" + boundary
+		size_t					_skip[256];		// Horspool bad-character shifts
+		std::string				_directory;
+		std::string				_buffer;
+		std::vector<UploadPart>	_parts;
+		int						_fd;			// current file part, -1 if discarded
+		std::string				_error;
+		int						_errorStatus;
+
+		size_t	_search(const char *data, size_t len) const;
+		bool	_scan();
+		bool	_readDelimiter();
+		bool	_readHeaders();
+		bool	_openPart(const std::string &headers);
+		bool	_write(const char *data, size_t len);
+		void	_closePart();
+		bool	_fail(const std::string &msg, int status = 400);
+};
+
+#endif
@@ -0,0 +1,75 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OpenFileCache.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 17:58:41 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 17:58:41 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef OPENFILECACHE_HPP
+# define OPENFILECACHE_HPP
+
+# include <string>
+# include <list>
+# include <map>
+# include <ctime>
+# include <sys/types.h>
+
+# define FILE_MISSING		0
+# define FILE_REGULAR		1
+# define FILE_DIRECTORY		2
+# define FILE_OTHER			3
+
+struct	FileInfo {
+	int		type;		// FILE_*
+	long	size;
+	time_t	mtime;
+	ino_t	inode;
+	dev_t	device;
+};
+
+/*	============================================================================
+	OpenFileCache: bounded LRU of stat() results and open descriptors,
+	keyed by the normalized path (nginx "open_file_cache")
+	An entry is trusted for `valid` seconds, then re-stat'ed; the open fd
+	is kept only while device, inode, size and mtime are unchanged.
+	Missing paths are cached too. Each response gets its own dup() of the
+	cached fd: the OutputQueue closes its copy, eviction closes the
+	original. With max == 0 (default) every query goes to the filesystem.
+	The server's own writes (upload, DELETE) invalidate their path.
+	============================================================================ */
+
+class	OpenFileCache {
+
+	private:
+		struct	Entry {
+			std::string	path;
+			FileInfo	info;
+			int			fd;			// -1 until first opened
+			time_t		checked;
+		};
+		typedef std::list<Entry>								EntryList;
+		typedef std::map<std::string, EntryList::iterator>		EntryIndex;
+
+		static EntryList	_lru;		// most recently used first
+		static EntryIndex	_index;
+		static size_t		_max;
+		static int			_valid;
+
+		static FileInfo		_stat(const std::string &path);
+		static Entry&		_entry(const std::string &path);
+		static void			_drop(EntryList::iterator it);
+
+	public:
+		static void			configure(size_t maxEntries, int validSeconds);
+		static FileInfo		lookup(const std::string &path);
+		static int			open(const std::string &path, long &size);
+		static void			invalidate(const std::string &path);
+		static void			clear();
+};
+
+#endif
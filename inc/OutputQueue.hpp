@@ -0,0 +1,101 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutputQueue.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 11:20:03 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 11:20:03 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <deque>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*	============================================================================
+	SharedBuffer : bloc d'octets immuable partagé entre plusieurs files
+	(réponses pré-sérialisées du ContentCache). Compteur de références :
+	le dernier release() libère le bloc.
+	============================================================================ */
+
+class	SharedBuffer {
+
+private:
+	std::string	_data;
+	size_t		_split;		// fin de la partie "tête" du bloc
+	int			_refs;
+
+	SharedBuffer();
+	~SharedBuffer();
+	SharedBuffer(const SharedBuffer &other);
+	SharedBuffer	&operator=(const SharedBuffer &other);
+
+public:
+	static SharedBuffer	*adopt(std::string &data, size_t split);
+
+	SharedBuffer		*retain();
+	void				release();
+	const std::string	&data() const;
+	size_t				split() const;
+};
+
+/*	============================================================================
+	OutputQueue : file d'attente de sortie d'un SocketClient
+	Liste de segments (status line + headers, body, fichier...) avec un
+	offset consommé par segment : un octet déjà envoyé n'est jamais recopié.
+	Les segments mémoire consécutifs partent en un seul writev(), les
+	segments fichier avec sendfile(). Un segment partagé référence une
+	tranche d'un SharedBuffer au lieu de la recopier.
+	============================================================================ */
+
+class	OutputQueue {
+
+private:
+	enum	SegmentType {
+		SEGMENT_MEMORY,
+		SEGMENT_SHARED,
+		SEGMENT_FILE
+	};
+
+	struct	Segment {
+		SegmentType		type;
+		std::string		data;
+		SharedBuffer	*shared;
+		size_t			end;		// SEGMENT_SHARED : fin de la tranche
+		size_t			consumed;
+		int				fd;
+		off_t			fileOffset;
+		long			remaining;
+	};
+
+	std::deque<Segment>	_segments;
+	size_t				_memoryBytes;
+
+	static const std::string	&_bytes(const Segment &seg);
+	static size_t				_end(const Segment &seg);
+	ssize_t		_flushMemory(int sockFd);
+	ssize_t		_flushFile(int sockFd, Segment &seg);
+	void		_popFront();
+
+	OutputQueue(const OutputQueue &other);
+	OutputQueue	&operator=(const OutputQueue &other);
+
+public:
+	OutputQueue();
+	~OutputQueue();
+
+	void		append(const std::string &data);
+	void		appendSwap(std::string &data);
+	void		appendShared(SharedBuffer *buffer, size_t start, size_t end);
+	void		appendFile(int fd, off_t offset, long length);
+	ssize_t		flush(int sockFd);
+	void		clear();
+
+	bool		empty() const;
+	size_t		memoryBytes() const;
+};
@@ -0,0 +1,118 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Poller.hpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 09:12:41 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 09:12:41 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <exception>
+#include <sys/select.h>
+#ifdef __linux__
+# include <sys/epoll.h>
+#endif
+
+/*	============================================================================
+	INTERETS / EVENEMENTS
+	============================================================================ */
+
+# define POLLER_READ	1
+# define POLLER_WRITE	2
+# define POLLER_ERROR	4
+# define POLLER_EXCLUSIVE	8	// add() seulement : un seul worker réveillé par évènement
+# define POLLER_HANGUP	16	// intérêt seulement : fermeture du pair, remontée en POLLER_READ
+
+struct	PollEvent {
+	int	fd;
+	int	events;
+};
+
+/*	============================================================================
+	APoller : backend d'evenements abstrait utilise par server::run()
+	Les fds sont enregistres une seule fois (add), l'interet n'est modifie
+	que lorsqu'un client passe de la lecture a l'ecriture (modify).
+	============================================================================ */
+
+class	APoller {
+
+public:
+	virtual ~APoller();
+
+	virtual bool		add(int fd, int events) = 0;
+	virtual bool		modify(int fd, int events) = 0;
+	virtual void		remove(int fd) = 0;
+	virtual int			wait(std::vector<PollEvent> &events, int timeoutMs) = 0;
+	virtual const char*	name() const = 0;
+
+	static APoller*		create(const std::string &backend);
+	static bool			isSupported(const std::string &backend);
+
+	class	pollerException : public std::exception {
+		private:
+			std::string	_msg;
+		public:
+			pollerException();
+			pollerException(const std::string &msg);
+			virtual const char*	what() const throw();
+			virtual ~pollerException() throw();
+	};
+};
+
+/*	============================================================================
+	SelectPoller : fd_set maitres mis a jour de facon incrementale,
+	limite a FD_SETSIZE descripteurs
+	============================================================================ */
+
+class	SelectPoller : public APoller {
+
+private:
+	fd_set				_readSet;
+	fd_set				_writeSet;
+	std::map<int, int>	_interest;
+
+public:
+	SelectPoller();
+	virtual ~SelectPoller();
+
+	bool		add(int fd, int events);
+	bool		modify(int fd, int events);
+	void		remove(int fd);
+	int			wait(std::vector<PollEvent> &events, int timeoutMs);
+	const char*	name() const;
+};
+
+#ifdef __linux__
+
+/*	============================================================================
+	EpollPoller : backend Linux, cout par reveil proportionnel au nombre
+	de fds actifs et non au nombre total de connexions
+	============================================================================ */
+
+class	EpollPoller : public APoller {
+
+private:
+	int		_epfd;
+	size_t	_registered;
+	std::vector<struct epoll_event>	_ready;
+
+public:
+	EpollPoller();
+	virtual ~EpollPoller();
+
+	bool		add(int fd, int events);
+	bool		modify(int fd, int events);
+	void		remove(int fd);
+	int			wait(std::vector<PollEvent> &events, int timeoutMs);
+	const char*	name() const;
+};
+
+#endif
@@ -0,0 +1,167 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Proxy.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 16:20:41 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 16:20:41 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <ctime>
+#include <sys/types.h>
+#include "Config.hpp"
+#include "CGIHandler.hpp"
+
+# define PROXY_BUFFER			65536	// lecture du backend / relecture du spool
+# define PROXY_RING_POINTS		160		// points par unité de poids (hash consistent)
+
+// Résultat de ProxyConnection::handle()
+# define PROXY_PENDING			0
+# define PROXY_DONE				1
+# define PROXY_FAILED			2
+
+class	Upstream;
+
+/*	============================================================================
+	ProxyConnection : une connexion HTTP/1.1 vers un serveur d'un upstream
+	Un seul job à la fois. La requête (tête + corps, en mémoire ou relu
+	depuis le spool du parseur) part au fil des notifications d'écriture ;
+	la réponse est décodée (Content-Length, chunked ou fin de connexion)
+	et convertie au format CGI dans job->result.output, exactement comme
+	la sortie d'un pipe CGI ou d'un backend FastCGI. Une fois la réponse
+	complète, la connexion retourne au pool si le backend la garde ouverte.
+	============================================================================ */
+
+class	ProxyConnection {
+
+private:
+	int				_fd;
+	Upstream		*_upstream;
+	size_t			_peer;
+	CGIJob			*_job;
+	bool			_reused;		// sortie du pool : peut avoir été fermée par le backend
+	bool			_paused;
+	size_t			_sent;			// octets de requête envoyés (tête + corps)
+	std::string		_chunk;			// morceau du spool en cours d'envoi
+	size_t			_chunkPos;
+	std::string		_in;
+	int				_state;
+	size_t			_remaining;		// octets du corps ou du chunk en cours
+	size_t			_headerBytes;
+	bool			_chunked;
+	bool			_responded;		// au moins un octet de réponse reçu
+	bool			_keepAlive;		// le backend garde la connexion
+
+	size_t		_requestSize() const;
+	ssize_t		_sendBody(size_t offset);
+	int			_parse();
+	bool		_takeLine(std::string &line);
+	bool		_parseStatus(const std::string &line);
+	bool		_parseHeader(const std::string &line);
+	int			_endHeaders();
+	int			_finish();
+
+	ProxyConnection(const ProxyConnection &other);
+	ProxyConnection	&operator=(const ProxyConnection &other);
+
+public:
+	ProxyConnection(Upstream *upstream, size_t peer);
+	~ProxyConnection();
+
+	bool		open();
+	int			getFd() const;
+	int			releaseFd();
+	Upstream	*getUpstream() const;
+	size_t		getPeer() const;
+	CGIJob		*getJob() const;
+	bool		isReused() const;
+	bool		retriable() const;
+	bool		reusable() const;
+	int			interest() const;
+
+	void		submit(CGIJob *job, bool reused);
+	void		detach();
+	void		setPaused(bool paused);
+	int			handle(int events);
+};
+
+/*	============================================================================
+	Upstream : serveurs d'un bloc "upstream" et leur état dans ce worker
+	Choix du serveur : round-robin pondéré (lissé), least_conn (requêtes
+	en cours / poids) ou hash d'une clé ($request_uri...), en anneau
+	consistent si demandé. Contrôle passif : max_fails échecs écartent
+	le serveur pendant fail_timeout, puis une requête le remet à l'essai.
+	============================================================================ */
+
+struct	UpstreamPeer {
+	UpstreamServer					config;
+	int								currentWeight;	// round-robin lissé
+	int								active;			// requêtes en cours
+	int								fails;
+	time_t							failedAt;
+	std::vector<ProxyConnection*>	idle;			// keep-alive inactives
+};
+
+class	Upstream {
+
+private:
+	UpstreamConfig							_config;
+	std::vector<UpstreamPeer>				_peers;
+	std::vector<std::pair<unsigned long, size_t> >	_ring;	// point -> serveur
+	size_t									_cursor;
+
+	bool		_usable(size_t peer, const std::vector<size_t> &tried, time_t now) const;
+	int			_roundRobin(const std::vector<size_t> &tried, time_t now);
+	int			_leastConn(const std::vector<size_t> &tried, time_t now);
+	int			_hash(const std::string &key, const std::vector<size_t> &tried, time_t now);
+	std::string	_hashKey(const std::map<std::string, std::string> &vars) const;
+	int			_pick(const CGIJob &job, time_t now);
+
+public:
+	Upstream(const UpstreamConfig &config);
+
+	const std::string	&getName() const;
+	size_t				size() const;
+	UpstreamPeer		&peer(size_t index);
+	int					select(const CGIJob &job);
+	void				markFailure(size_t peer);
+	void				markSuccess(size_t peer);
+	bool				keepIdle(ProxyConnection *conn);
+	void				dropIdle(ProxyConnection *conn);
+	void				takeIdle(size_t peer, std::vector<ProxyConnection*> &out);
+};
+
+/*	============================================================================
+	ProxyPool : upstreams du worker et index fd -> connexion
+	acquire() choisit un serveur, reprend une connexion keep-alive
+	inactive vers lui ou en ouvre une nouvelle (connect non bloquant).
+	============================================================================ */
+
+class	ProxyPool {
+
+private:
+	std::map<std::string, Upstream*>	_upstreams;
+	std::map<int, ProxyConnection*>		_byFd;
+
+	ProxyPool(const ProxyPool &other);
+	ProxyPool	&operator=(const ProxyPool &other);
+
+public:
+	ProxyPool();
+	~ProxyPool();
+
+	void				configure(const std::map<std::string, UpstreamConfig> &upstreams);
+	ProxyConnection		*acquire(CGIJob *job, bool &created);
+	ProxyConnection		*find(int fd) const;
+	bool				release(ProxyConnection *conn);
+	void				fail(ProxyConnection *conn, std::vector<ProxyConnection*> &stale);
+	void				remove(ProxyConnection *conn);
+};
@@ -30,6 +30,10 @@ private:
 	std::string		_headerValues[MAX_HEADERS];
 	int				_headerCount;
 	std::string		_body;
+	std::string		_bodyFile;		// corps resté sur disque (voir RequestParser)
+	size_t			_bodySize;
+	std::vector<UploadPart>	_parts;		// upload multipart découpé à la lecture
+	bool			_closeAfter;	// Transfer-Encoding + Content-Length : pas de keep-alive
 
 public:
 	Request();
@@ -39,7 +43,11 @@ public:
 	std::string		getUri() const;
 	std::string		getVersion() const;
 	std::string		getHeader(const std::string &key) const;
-	std::string		getBody() const;
+	const std::string&	getBody() const;
+	const std::string&	getBodyFile() const;
+	size_t			getBodySize() const;
+	const std::vector<UploadPart>&	getParts() const;
+	bool			mustClose() const;
 	int				getHeaderCount() const;
 	std::string		getHeaderKey(int index) const;
 	std::string		getHeaderValue(int index) const;
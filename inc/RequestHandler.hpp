@@ -22,35 +22,84 @@
 # include "FileHandler.hpp"
 # include "CGIHandler.hpp"
 # include "HTTPCommon.hpp"
+# include "RuntimeConfig.hpp"
+# include "VirtualHostIndex.hpp"
+# include "MultipartParser.hpp"
+# include "ResponseCache.hpp"
 # include <dirent.h>
 # include <sys/stat.h>
 # include <sys/types.h>
 
 class ResponseBuilder;
 
+// Representation chosen for a static GET: the file itself or its .gz sidecar
+struct	StaticFile {
+	std::string	path;
+	FileInfo	info;
+	std::string	mimeType;		// always the original file's type
+	std::string	encoding;		// Content-Encoding of the file itself (.gz sidecar)
+	int			gzipLevel;		// > 0: compressed on the fly, memoized in ContentCache
+	std::string	cacheKey;		// ContentCache key of this representation
+};
+
 class	RequestHandler {
 
 	private:
 		std::vector<ServerConfig>	_servers;
+		std::vector<RuntimeServer>	_runtime;	// one per entry of _servers
+		VirtualHostIndex			_vhosts;
 
-		ServerConfig*	_findServerConfig(int port, const std::string &host);
-		LocationConfig*	_findLocation(ServerConfig* server, const std::string &uri);
-		bool			_isMethodAllowed(LocationConfig* loc, const std::string &method);
-		bool			_isBodyComplete(const std::string &rawData, const Request &request);
-		bool			_isBodyTooLarge(long bodySize, ServerConfig* server);
+		const RuntimeServer*	_findServer(int port, const std::string &host);
+		const RuntimeServer*	_findServer(int port, const RawRequest &raw);
+		const RuntimeServer*	_runtimeFor(const ServerConfig* config) const;
+		bool			_isBodyTooLarge(long bodySize, const RuntimeLocation* loc);
+		void			_applyKeepAlive(const Request &request, const RuntimeServer* server,
+		                                Response &resp, HTTPConnection &conn);
+		void			_setConnectionHeader(Response &resp, bool keepAlive, int timeout);
 
-		std::string		_buildFilePath(const std::string &uri,
-		                               ServerConfig* server, LocationConfig* loc);
+		std::string		_buildFilePath(const std::string &uri, const RuntimeLocation* loc);
+		Response		_serveStatic(const Request &request, const std::string &filePath,
+		                             const RuntimeLocation* loc, ResponseBuilder &builder);
+		StaticFile		_selectVariant(const Request &request, const std::string &filePath,
+		                               const RuntimeLocation* loc);
+		void			_setFileHeaders(Response &resp, const StaticFile &file, bool compressed);
+		void			_gzipBody(const RuntimeLocation* loc, bool accepted, Response &resp);
+		Response		_serveFile(const StaticFile &file, ResponseBuilder &builder);
+		Response		_serveRanges(const std::string &rangeHeader, const StaticFile &file,
+		                             ResponseBuilder &builder);
+		bool			_isNotModified(const Request &request, const FileInfo &info);
+		bool			_rangeApplies(const Request &request, const FileInfo &info);
+		void			_applyExpires(Response &resp, const RuntimeLocation* loc);
+		Response		_startCGI(const std::string &scriptPath, const Request &request,
+		                          const RuntimeServer* server, const RuntimeLocation* loc,
+		                          ResponseBuilder &builder);
+		Response		_startFastCGI(const Request &request, const RuntimeServer* server,
+		                              const RuntimeLocation* loc, ResponseBuilder &builder);
+		Response		_startProxy(const Request &request, const RuntimeServer* server,
+		                            const RuntimeLocation* loc, ResponseBuilder &builder);
 		Response		_buildCGIResponse(const CGIResult &result, ResponseBuilder &builder);
-		Response		_handleGET(const Request &request, ServerConfig* server, LocationConfig* loc);
-		Response		_handlePOST(const Request &request, ServerConfig* server, LocationConfig* loc);
-		Response		_handleDELETE(const Request &request, ServerConfig* server, LocationConfig* loc);
+		Response		_handleGET(const Request &request, const RuntimeServer* server, const RuntimeLocation* loc);
+		Response		_handlePOST(const Request &request, const RuntimeServer* server, const RuntimeLocation* loc);
+		Response		_storeParts(const Request &request, const RuntimeLocation* loc,
+		                            ResponseBuilder &builder);
+		Response		_handleDELETE(const Request &request, const RuntimeServer* server, const RuntimeLocation* loc);
+		Response		_dispatch(const Request &request, const RuntimeServer* server);
+		Response		_route(const Request &request, const RuntimeServer* server,
+		                       const RuntimeLocation* loc, int method);
+		Response		_serveCached(const Request &request, const RuntimeServer* server,
+		                             const RuntimeLocation* loc);
 
 	public:
 		RequestHandler(const std::vector<ServerConfig>& servers);
 		~RequestHandler();
 
-		Response	handleRequest(const Request& request, const std::string &rawData, int port);
+		Response	handleRequest(const Request& request, HTTPConnection &conn);
+		BodyPolicy	bodyPolicy(const RawRequest &raw, int port);
+		bool		clientTimeouts(const RawRequest &raw, int port, ClientTimeouts &out);
+		Response	rejectRequest(const RawRequest &raw, int port, int code,
+		                          const std::string &message);
+		Response	finishCGI(CGIJob &job);
+		Response	startCGIStream(CGIJob &job, size_t headerEnd, size_t bodyStart);
 };
 
 #endif
@@ -0,0 +1,99 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RequestParser.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 10:02:17 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 10:02:17 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef REQUESTPARSER_HPP
+# define REQUESTPARSER_HPP
+
+# include <string>
+# include <cstring>
+# include "HTTPParser.hpp"
+# include "MultipartParser.hpp"
+
+# define PARSER_MAX_LINE		8192
+# define PARSER_MAX_HEADERS		100
+
+/*	============================================================================
+	Incremental HTTP/1.1 request parser (one per SocketClient)
+	feed() consumes bytes as they arrive and remembers where it stopped:
+	nothing already seen is scanned twice, and a complete request is
+	handed off exactly once through getRequest().
+	Once the headers are in, feed() pauses until setBodyPolicy() gives the
+	route's limits: a body over max_body_size fails with 413 as soon as
+	its size is announced (or, chunked, as soon as the total passes it);
+	past the memory limit the bytes go straight to a temp file, which
+	reset() removes unless it was moved. A multipart upload is split into
+	its parts on the fly instead (see MultipartParser).
+	============================================================================ */
+
+class	RequestParser {
+
+	public:
+		enum	State {
+			PARSE_REQUEST_LINE,
+			PARSE_HEADERS,
+			PARSE_BODY,
+			PARSE_CHUNK_SIZE,
+			PARSE_CHUNK_DATA,
+			PARSE_CHUNK_CRLF,
+			PARSE_TRAILERS,
+			PARSE_COMPLETE,
+			PARSE_ERROR
+		};
+
+		RequestParser();
+		~RequestParser();
+
+		size_t				feed(const char *data, size_t len);
+		void				reset();
+		bool				needsBodyPolicy() const;
+		void				setBodyPolicy(const BodyPolicy &policy);
+		bool				expectsContinue() const;
+
+		State				getState() const;
+		bool				isComplete() const;
+		bool				hasError() const;
+		bool				hasStarted() const;
+		bool				isReadingBody() const;
+		int					getErrorStatus() const;
+		const std::string&	getError() const;
+		RawRequest&			getRequest();
+
+	private:
+		State		_state;
+		RawRequest	_request;
+		std::string	_line;
+		size_t		_remaining;
+		size_t		_headerBytes;
+		bool		_started;
+		std::string	_error;
+		int			_errorStatus;
+		bool		_policyReady;
+		BodyPolicy	_policy;
+		std::string	_spoolPath;
+		int			_spoolFd;
+		MultipartParser	_multipart;
+
+		size_t		_consumeLine(const char *data, size_t len, bool &lineReady);
+		void		_processLine();
+		void		_onHeadersComplete();
+		bool		_checkCodings(const std::string &value);
+		void		_addTrailer();
+		void		_fail(const std::string &msg, int status = 400);
+		bool		_checkBodySize(size_t announced);
+		void		_appendBody(const char *data, size_t len);
+		bool		_openSpool();
+		bool		_writeSpool(const char *data, size_t len);
+		void		_finishBody();
+		void		_discardSpool();
+};
+
+#endif
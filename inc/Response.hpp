@@ -14,6 +14,9 @@
 
 # include <string>
 # include "HTTPSerializer.hpp"
+
+struct CGIJob;
+class SharedBuffer;
 # define MAX_HEADERS 50
 
 class	Response {
@@ -26,6 +29,11 @@ class	Response {
 		std::string	_body;
 		int			_statusCode;
 		int			_headerCount;
+		int			_bodyFd;
+		long		_bodyLength;
+		std::vector<FileRange>	_bodyRanges;
+		CGIJob*		_cgiJob;
+		SharedBuffer*	_cached;	// pre-serialized head + body, borrowed
 
 	public:
 		Response();
@@ -35,8 +43,16 @@ class	Response {
 		void		setStatus(int code, const std::string &message);
 		void		setHeader(const std::string &key, const std::string &value);
 		void		setBody(const std::string &body);
+		void		setFileBody(int fd, long length);
+		void		addFileRange(const std::string &prefix, off_t offset, long length);
+		void		setCGIJob(CGIJob *job);
+		void		setCached(SharedBuffer *cached);
 
 		RawResponse	toRaw() const;
 		int			getStatusCode() const;
+		std::string	getHeader(const std::string &key) const;
 		std::string	getBody() const;
+		int			getBodyFd() const;
+		CGIJob*		getCGIJob() const;
+		SharedBuffer*	getCached() const;
 };
@@ -15,23 +15,32 @@
 
 # include <string>
 # include "Response.hpp"
-# include "Config.hpp"
+# include "RuntimeConfig.hpp"
 # include "FileHandler.hpp"
 # include "HTTPCommon.hpp"
 # include "HTTPSerializer.hpp"
+# include "OutputQueue.hpp"
 
 class ResponseBuilder {
 
 	private:
-		ServerConfig*	_server;
-		std::string		_loadErrorPage(int code);
+		const RuntimeServer*	_server;
 
 	public:
-		ResponseBuilder(ServerConfig* server);
+		ResponseBuilder(const RuntimeServer* server);
 		~ResponseBuilder();
 
 		Response	buildSuccess(int code, const std::string &body, const std::string &mimeType);
+		Response	buildFile(int code, int fd, long size, const std::string &mimeType);
+		Response	buildRanges(int fd, const std::vector<HTTPRange> &ranges, long size,
+		                        const std::string &mimeType);
 		Response	buildError(int code, const std::string &message);
+		Response	buildCached(int code, SharedBuffer *cached);
+		Response	buildNotModified(const FileInfo &info);
+
+		static std::string	etag(const FileInfo &info);
+		static void			setValidators(Response &resp, const FileInfo &info);
+		static SharedBuffer	*serialize(const Response &head, const std::string &body);
 };
 
 #endif
@@ -0,0 +1,124 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ResponseCache.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 17:42:08 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 17:42:08 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef RESPONSECACHE_HPP
+# define RESPONSECACHE_HPP
+
+# include <string>
+# include <list>
+# include <map>
+# include <vector>
+# include <ctime>
+# include "OutputQueue.hpp"
+# include "Request.hpp"
+# include "Response.hpp"
+
+# define RESPONSE_CACHE_LOCK	10	// seconds one request may hold a stale entry's update
+
+// Outcome of a lookup, reported to the client as X-Cache-Status
+enum	CacheStatus {
+	CACHE_MISS,
+	CACHE_BYPASS,		// cache_bypass matched: fetched, and the entry refreshed
+	CACHE_EXPIRED,		// stale: this request revalidates, others get STALE
+	CACHE_STALE,
+	CACHE_HIT
+};
+
+/*	============================================================================
+	CacheTicket: carried by a CGIJob from the lookup to the store
+	Holds what the response needs to be filed under the right variant,
+	then the response itself: a head without Content-Length or
+	Connection lines, and the body as the client received it (after
+	gzip), collected while it streams.
+	============================================================================ */
+
+struct	CacheTicket {
+	int									status;		// CacheStatus of the lookup
+	std::string							key;		// expanded cache_key, empty: not cached
+	std::map<std::string, std::string>	request;	// request headers, for Vary
+	std::string							locked;		// variant whose update this request holds
+	bool								storing;	// the response is being collected
+	int									code;
+	time_t								expires;
+	time_t								staleUntil;	// 0: stale served for as long as an update runs
+	std::vector<std::string>			vary;
+	std::string							head;
+	std::string							body;
+
+	CacheTicket();
+};
+
+/*	============================================================================
+	ResponseCache: microcache for CGI, FastCGI and proxied responses
+	Entries are ready-to-send blocks (SharedBuffer, like ContentCache), so
+	a hit forks nothing and copies nothing. Freshness comes from the
+	location's cache_valid, overridden by the response's Cache-Control;
+	Vary splits a key into variants. An expired entry keeps being served
+	(STALE) while the one request that found it expired fetches the new
+	version. Memory is bounded in bytes, least recently used out first;
+	with a path, evicted entries overflow to files there (bounded too)
+	and come back to memory on their next hit. State is per worker.
+	============================================================================ */
+
+class	ResponseCache {
+
+	private:
+		struct	Entry {
+			std::string		key;		// variant key
+			int				code;
+			time_t			expires;
+			time_t			staleUntil;
+			SharedBuffer	*buffer;	// NULL while on disk
+			std::string		file;
+			size_t			size;
+			size_t			split;
+		};
+		typedef std::list<Entry>								EntryList;
+		typedef std::map<std::string, EntryList::iterator>		EntryIndex;
+
+		static EntryList	_memory;
+		static EntryList	_disk;
+		static EntryIndex	_index;
+		static std::map<std::string, std::vector<std::string> >	_vary;
+		static std::map<std::string, time_t>					_updating;
+		static size_t		_bytes;
+		static size_t		_maxBytes;
+		static size_t		_maxEntry;
+		static std::string	_path;
+		static size_t		_diskBytes;
+		static size_t		_maxDisk;
+		static unsigned long	_fileCounter;
+
+		static std::string	_variantKey(const std::string &key,
+		                                const std::map<std::string, std::string> &request);
+		static void			_drop(EntryList::iterator it);
+		static void			_evict();
+		static bool			_spill(EntryList::iterator it);
+		static bool			_load(EntryList::iterator it);
+		static std::string	_variable(const std::string &name, const Request &request);
+
+	public:
+		static void			configure(size_t maxBytes, size_t maxEntry,
+		                              const std::string &path, size_t maxDisk);
+		static bool			enabled();
+		static std::string	expand(const std::string &pattern, const Request &request);
+		static int			lookup(CacheTicket &ticket, SharedBuffer *&buffer, int &code);
+		static bool			prepare(CacheTicket &ticket, const Response &resp,
+		                            const std::map<int, long> &valid);
+		static void			collect(CacheTicket &ticket, const std::string &data);
+		static void			store(CacheTicket &ticket);
+		static void			release(CacheTicket &ticket);
+		static const char	*statusName(int status);
+		static void			clear();
+};
+
+#endif
@@ -0,0 +1,85 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RuntimeConfig.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 17:20:08 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 17:20:08 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef RUNTIMECONFIG_HPP
+# define RUNTIMECONFIG_HPP
+
+# include <string>
+# include <vector>
+# include <map>
+# include <set>
+# include "Config.hpp"
+# include "LocationRouter.hpp"
+# include "OutputQueue.hpp"
+
+// Bit of an HTTP_METHOD_* code in RuntimeLocation::methods
+# define METHOD_BIT(code)	(1u << (code))
+
+/*	============================================================================
+	Runtime configuration, compiled once from the parsed ServerConfig
+	The request path only reads these: methods as a bitmask, roots and
+	upload directories already absolute and '/'-terminated, error pages
+	already serialized in memory. ServerConfig/LocationConfig stay the parser's
+	output; `config`/`source` point back to them for what the CGI layer
+	still consumes (environment, interpreter table).
+	============================================================================ */
+
+struct	RuntimeLocation {
+	const LocationConfig	*source;
+	std::string				path;
+	unsigned				methods;		// METHOD_BIT(HTTP_METHOD_*)
+	std::string				root;			// absolute, ends with '/'
+	std::string				index;
+	bool					autoIndex;
+	std::string				redirectUrl;
+	bool					allowUpload;
+	std::string				uploadStore;	// absolute, ends with '/', or empty
+	std::string				fastcgiPass;
+	std::string				proxyPass;		// upstream name
+	std::string				proxyUri;		// replaces the location prefix if set
+	long					expires;		// seconds, or EXPIRES_OFF/EXPIRES_EPOCH
+	std::string				cacheControl;
+	bool					gzipStatic;
+	bool					gzip;
+	std::set<std::string>	gzipTypes;		// always holds text/html
+	long					gzipMinLength;
+	int						gzipLevel;
+	long					maxBodySize;	// 0: unlimited, server value if not set
+
+	bool	allows(int method) const;
+	bool	hasCGI() const;
+	bool	caches() const;
+	bool	compresses(const std::string &contentType, long length) const;
+};
+
+struct	RuntimeServer {
+	ServerConfig					*config;
+	std::vector<RuntimeLocation>	locations;
+	LocationRouter					router;
+	std::map<int, SharedBuffer*>	errorPages;		// pre-serialized, see ResponseBuilder
+
+	const RuntimeLocation*	findLocation(const std::string &uri) const;
+	SharedBuffer*			errorPage(int code) const;
+};
+
+class	RuntimeConfig {
+
+	private:
+		static std::string	_absoluteDir(const std::string &path);
+		static std::string	_readErrorPage(const std::string &root, const std::string &page);
+
+	public:
+		static RuntimeServer	compile(ServerConfig &server);
+		static void				release(RuntimeServer &server);
+};
+
+#endif
@@ -13,11 +13,37 @@
 #pragma	once
 
 #include "ASocket.hpp"
+#include "RequestParser.hpp"
+#include "OutputQueue.hpp"
+#include "TimerWheel.hpp"
+
+struct CGIJob;
+
+// Échéance en cours d'un client (une seule à la fois)
+enum	ClientPhase {
+	PHASE_NONE,		// réponse CGI en préparation : c'est le job qui est minuté
+	PHASE_HEADER,	// client_header_timeout
+	PHASE_BODY,		// client_body_timeout
+	PHASE_IDLE,		// keepalive_timeout
+	PHASE_SEND,		// send_timeout / send_min_rate
+	PHASE_LINGER	// LINGERING_TIMEOUT : fin d'un corps refusé, lue puis jetée
+};
 
 class	SocketClient : public ASocket {
 private:
 	std::string _requestBuffer;
-	std::string _responseBuffer;
+	RequestParser _parser;
+	OutputQueue _output;
+	bool        _keepAlive;
+	int         _keepAliveTimeout;
+	int         _requestCount;
+	CGIJob*     _cgiJob;
+	Timer       _timer;
+	int         _phase;
+	size_t      _progress;
+	bool        _lingering;
+	bool        _interim;	// "100 Continue" en file, corps lu une fois parti
+	ClientTimeouts _timeouts;
 
 public:
 	SocketClient(int fd, struct sockaddr_in addr);
@@ -27,9 +53,33 @@ public:
 	void		setNonBlocking();
 	ssize_t		sendData(const void* buf, size_t len);
 	ssize_t		recvData(void* buf, size_t len);
+	ssize_t		flushOutput();
 	bool		isConnected() const;
 
 	std::string& getRequestBuffer();
-	std::string& getResponseBuffer();
+	RequestParser& getParser();
+	OutputQueue& getOutput();
+	bool		hasPendingOutput() const;
+
+	void		setKeepAlive(bool keepAlive, int timeout);
+	void		startLingering();
+	bool		isLingering() const;
+	void		setInterim(bool interim);
+	bool		hasInterim() const;
+	bool		isKeepAlive() const;
+	int			getKeepAliveTimeout() const;
+	int			getRequestCount() const;
+	void		countRequest();
+
+	Timer&		getTimer();
+	int			getPhase() const;
+	void		setPhase(int phase);
+	void		addProgress(size_t bytes);
+	size_t		takeProgress();
+	void		setTimeouts(const ClientTimeouts& timeouts);
+	const ClientTimeouts& getTimeouts() const;
+
+	void		setCGIJob(CGIJob* job);
+	CGIJob*		getCGIJob() const;
 
 };
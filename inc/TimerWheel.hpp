@@ -0,0 +1,75 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 15:32:47 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 15:32:47 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+
+# define TIMER_TICK_MS		100		// résolution de la roue
+# define TIMER_LEVELS		4
+# define TIMER_LEVEL_BITS	6
+# define TIMER_SLOTS		64		// 1 << TIMER_LEVEL_BITS
+
+/*	============================================================================
+	Timer : entrée intrusive d'une TimerWheel
+	Le propriétaire (client, job CGI) embarque son Timer ; owner et kind
+	permettent à la boucle de retrouver à qui appartient une échéance.
+	============================================================================ */
+
+struct	Timer {
+	Timer*			prev;
+	Timer*			next;
+	unsigned long	expires;	// en ticks absolus
+	bool			active;
+	int				owner;
+	int				kind;
+
+	Timer();
+};
+
+/*	============================================================================
+	TimerWheel : roue hiérarchique (4 niveaux de 64 cases, tick 100 ms)
+	schedule() et cancel() sont en O(1) ; une échéance lointaine descend
+	d'un niveau quand sa case est atteinte (cascade). Les timers échus
+	sont déplacés dans une liste "due" que la boucle vide via popDue() :
+	un timer annulé pendant ce traitement en est simplement retiré.
+	============================================================================ */
+
+class	TimerWheel {
+
+private:
+	Timer			_slots[TIMER_LEVELS][TIMER_SLOTS];	// têtes de listes
+	Timer			_due;
+	unsigned long	_tick;		// prochain tick à traiter
+	size_t			_count;
+
+	void			_insert(Timer &timer);
+	void			_cascade(int level, int index);
+	static void		_link(Timer &head, Timer &timer);
+	static void		_unlink(Timer &timer);
+
+	TimerWheel(const TimerWheel &other);
+	TimerWheel	&operator=(const TimerWheel &other);
+
+public:
+	TimerWheel();
+	~TimerWheel();
+
+	void			schedule(Timer &timer, unsigned long delayMs);
+	void			cancel(Timer &timer);
+	void			advance(unsigned long nowMs);
+	Timer*			popDue();
+	long			nextTimeout(unsigned long nowMs) const;
+	size_t			size() const;
+
+	static unsigned long	nowMs();
+};
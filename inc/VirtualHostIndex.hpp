@@ -0,0 +1,74 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHostIndex.hpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 16:41:30 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 16:41:30 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#ifndef VIRTUALHOSTINDEX_HPP
+# define VIRTUALHOSTINDEX_HPP
+
+# include <string>
+# include <vector>
+# include <map>
+# include "Config.hpp"
+
+/*	============================================================================
+	VirtualHostIndex: (port, Host) -> ServerConfig, precomputed at startup
+	Resolution order follows nginx:
+	  1. exact name         hash table keyed on (port, lowercased name)
+	  2. "*.example.com"    longest match in a trie of reversed labels
+	  3. "www.example.*"    longest match in a trie of forward labels
+	  4. the first server declared on the port
+	Trie edges live in a second hash table keyed on (parent node, label),
+	so a lookup costs one hash per label and allocates nothing: the Host
+	header is lowercased on the fly and its ":port" suffix ignored.
+	============================================================================ */
+
+class	VirtualHostIndex {
+
+	private:
+		struct	Entry {
+			unsigned long	salt;	// port, or parent node of a trie edge
+			std::string		key;
+			int				value;
+		};
+
+		struct	PortIndex {
+			int		fallback;		// first server on the port
+			int		suffixRoot;		// trie of "*.name" (labels right to left)
+			int		prefixRoot;		// trie of "name.*" (labels left to right)
+		};
+
+		std::vector<ServerConfig*>				_servers;
+		std::map<int, PortIndex>				_ports;
+		std::vector<std::vector<Entry> >		_exact;
+		std::vector<std::vector<Entry> >		_edges;
+		std::vector<int>						_nodeServer;	// server index or -1
+
+		static unsigned long	_hash(unsigned long salt, const char *data, size_t len);
+		static bool				_equals(const std::string &key, const char *data, size_t len);
+		static const Entry*		_find(const std::vector<std::vector<Entry> > &table,
+		                              unsigned long salt, const char *data, size_t len);
+		static void				_store(std::vector<std::vector<Entry> > &table,
+		                               unsigned long salt, const std::string &key, int value);
+
+		int			_newNode();
+		int			_child(int node, const char *label, size_t len, bool create);
+		void		_addWildcard(int root, const std::string &name, bool reversed, int server);
+		int			_walk(int root, const char *host, size_t len, bool reversed) const;
+
+	public:
+		VirtualHostIndex();
+		~VirtualHostIndex();
+
+		void			build(std::vector<ServerConfig> &servers);
+		ServerConfig*	lookup(int port, const std::string &host) const;
+};
+
+#endif
@@ -3,11 +3,30 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <set>
+#include <ctime>
+#include "TimerWheel.hpp"
 #include "Config.hpp"
 #include "SocketServer.hpp"
 #include "SocketClient.hpp"
 #include "HTTPCommon.hpp"
 #include "HTTPParser.hpp"
+#include "Poller.hpp"
+#include "CGIHandler.hpp"
+#include "FastCGI.hpp"
+#include "Proxy.hpp"
+#include "OpenFileCache.hpp"
+#include "ContentCache.hpp"
+#include "ResponseCache.hpp"
+
+// Délai accordé au client pour finir d'envoyer un corps refusé (413)
+#define LINGERING_TIMEOUT 5
+
+// Propriétaire d'un Timer (Timer::owner est le fd du client dans les deux cas)
+enum	TimerKind {
+	TIMER_CLIENT,
+	TIMER_CGI
+};
 
 class server
 {
@@ -15,13 +34,61 @@ private:
 	int _maxUsers;
 	std::map<int, SocketClient*> _clients;
 	std::map<int, SocketServer*> _serverPorts;
+	std::map<int, int>           _listenFds;
 	std::map<int, int>           _clientPorts;
+	std::map<int, int>           _cgiFds;
+	std::set<int>                _cgiExiting;
+	std::vector<pid_t>           _zombies;
+	FastCGIPool                  _fcgiPool;
+	std::map<CGIJob*, int>       _fcgiJobs;
+	ProxyPool                    _proxyPool;
+	std::map<CGIJob*, int>       _proxyJobs;
+	std::vector<int>             _deferredClose;
+	TimerWheel                   _timers;
+	std::map<int, ClientTimeouts> _timeouts;	// serveur par défaut de chaque port
+	GlobalConfig                 _global;
 	HTTPServerEngine*            _engine;
+	APoller*                     _poller;
+
+	void _initPoller();
+	void _acceptClients(int listenFd);
+	void _readClient(int fd, SocketClient* client, std::vector<int>& toRemove);
+	void _feedClient(int fd, SocketClient* client, const char* data, size_t len);
+	void _queueOutput(SocketClient* client, HTTPOutput& out);
+	void _appendBody(OutputQueue& output, std::string& data, bool chunked);
+	void _writeClient(int fd, SocketClient* client, std::vector<int>& toRemove);
+	void _closeClient(int fd);
+	void _armClient(int fd, SocketClient* client);
+	void _resolveTimeouts(int fd, SocketClient* client);
+	void _expireTimers();
+	void _expireClient(int fd, SocketClient* client);
+	void _expireCGI(int clientFd);
+	int  _pollTimeout() const;
+
+	void _attachCGI(int fd, SocketClient* client, CGIJob* job);
+	void _handleCGIEvent(int pipeFd, int events);
+	void _releaseCGIFd(int& pipeFd);
+	void _detachCGI(CGIJob* job);
+	void _pauseCGI(CGIJob* job, bool paused);
+	void _attachFastCGI(int fd, CGIJob* job);
+	void _handleFastCGIEvent(FastCGIConnection* conn, int events);
+	void _resumeFastCGI(const std::string& address);
+	void _attachProxy(int fd, CGIJob* job);
+	void _handleProxyEvent(ProxyConnection* conn, int events);
+	void _closeProxy(ProxyConnection* conn);
+	void _streamCGI(int clientFd);
+	void _drainCGIStream(int fd, SocketClient* client);
+	void _endCGIStream(int clientFd);
+	void _completeCGI(int clientFd);
+	void _probeClient(int fd, SocketClient* client, std::vector<int>& toRemove);
+	void _abortCGI(SocketClient* client);
+	void _reapChildren();
 
 public:
-	server(const std::vector<ServerConfig>& serverConfigs);
+	server(const std::vector<ServerConfig>& serverConfigs, const GlobalConfig& global);
 	~server();
 	int getServerLimit();
+	void start();
 	void run();
 
 	class	serverException : public std::exception {
@@ -11,8 +11,6 @@
 /* ************************************************************************** */
 
 #include "../inc/CGIHandler.hpp"
-#include <sys/select.h>
-#include <sys/time.h>
 
 /*	============================================================================
 		CGI DETECTION
@@ -114,51 +112,194 @@ std::vector<char*>	CGIHandler::_mapToCharArray(const std::map<std::string, std::
 	return (result);
 }
 
+// Une mise à jour abandonnée (erreur, client parti) libère l'entrée périmée
+CGIJob::~CGIJob() {
+	ResponseCache::release(cache);
+	if (bodyFd >= 0)
+		close(bodyFd);
+	delete gzip;
+}
+
+/*	============================================================================
+		JOB SETUP
+		Shared by fork/exec CGI and FastCGI: only the transport differs.
+	============================================================================ */
+
+CGIJob*	CGIHandler::_newJob(const Request &request, ServerConfig &server) {
+	CGIJob	*job = new CGIJob();
+	job->pid = -1;
+	job->stdinFd = -1;
+	job->stdoutFd = -1;
+	job->input = request.getBody();
+	job->inputOffset = 0;
+	job->result.exitCode = -1;
+	job->result.success = false;
+	job->exited = false;
+	job->timedOut = false;
+	job->lastActivity = time(NULL);
+	job->server = &server;
+	job->keepAlive = false;
+	job->keepAliveTimeout = 0;
+	job->httpVersion = request.getVersion();
+	job->headerScan = 0;
+	job->headersSent = false;
+	job->chunked = false;
+	job->contentLength = -1;
+	job->bodySent = 0;
+	job->paused = false;
+	job->location = NULL;
+	job->acceptsGzip = false;
+	job->gzip = NULL;
+	job->fcgiConn = NULL;
+	job->fcgiId = 0;
+	job->bodyFd = -1;
+	job->bodySize = 0;
+	job->proxyConn = NULL;
+	return (job);
+}
+
+// Corps mis sur disque par le parseur : le job garde un fd dessus (il survit
+// à l'unlink() du parseur) et le backend le relit par tranches
+bool	CGIHandler::_openBody(const Request &request, CGIJob *job) {
+	if (request.getBodyFile().empty())
+		return (true);
+	job->bodyFd = open(request.getBodyFile().c_str(), O_RDONLY | O_CLOEXEC);
+	if (job->bodyFd < 0)
+		return (false);
+	job->input.clear();
+	job->bodySize = request.getBodySize();
+	return (true);
+}
+
+// Le serveur applicatif reçoit l'environnement CGI/1.1 exact en paramètres FastCGI
+CGIJob*	CGIHandler::prepareFastCGI(const std::string &scriptPath, const Request &request,
+					ServerConfig &server, const std::string &pass) {
+	CGIJob	*job = _newJob(request, server);
+	if (!_openBody(request, job)) {
+		delete job;
+		return (NULL);
+	}
+	job->fastcgiPass = pass;
+	job->params = _buildCGIEnvironment(request, scriptPath, server);
+	return (job);
+}
+
 /*	============================================================================
-		CGI EXECUTION (fork/execve/pipe)
+		REVERSE PROXY REQUEST
+		HTTP/1.1 to the upstream with the client's end-to-end headers.
+		Hop-by-hop fields are dropped (the body is already de-chunked and
+		an Expect was answered by us); a spooled body stays on disk and is
+		streamed from its fd, which outlives the parser's unlink().
 	============================================================================ */
 
-CGIResult	CGIHandler::execute(const std::string &scriptPath, const Request &request,
-					const ServerConfig &server, const std::map<std::string, std::string> &handlers) {
+static bool	isHopByHop(const std::string &name) {
+	static const char	*fields[] = { "connection", "keep-alive", "proxy-connection",
+		"te", "trailer", "transfer-encoding", "upgrade", "expect", "content-length", NULL };
+
+	for (size_t i = 0; fields[i]; i++) {
+		if (name == fields[i])
+			return (true);
+	}
+	return (false);
+}
 
-	CGIResult	result;
-	result.exitCode = -1;
-	result.success = false;
-	result.output = "";
+CGIJob*	CGIHandler::prepareProxy(const Request &request, ServerConfig &server,
+					const std::string &pass, const std::string &uri) {
+	CGIJob	*job = _newJob(request, server);
+	if (!_openBody(request, job)) {
+		delete job;
+		return (NULL);
+	}
+	job->proxyPass = pass;
+	job->proxyMethod = request.getMethod();
+	std::string	&head = job->proxyRequest;
+	head = request.getMethod() + " " + uri + " HTTP/1.1\r\n";
+	for (int i = 0; i < request.getHeaderCount(); i++) {
+		std::string	name = httpToLower(request.getHeaderKey(i));
+		if (!isHopByHop(name))
+			head += request.getHeaderKey(i) + ": " + request.getHeaderValue(i) + "\r\n";
+	}
+	if (request.getHeader("host").empty())
+		head += "Host: " + pass + "\r\n";
+	size_t	bodySize = job->input.size() + job->bodySize;
+	if (bodySize > 0 || request.getMethod() == "POST")
+		head += "Content-Length: " + httpIntToString(bodySize) + "\r\n";
+	head += "Connection: keep-alive\r\n\r\n";
+	// Variables disponibles pour "hash" dans un bloc upstream
+	size_t	query = request.getUri().find('?');
+	job->params["request_uri"] = request.getUri();
+	job->params["uri"] = request.getUri().substr(0, query);
+	job->params["args"] = (query == std::string::npos) ? "" : request.getUri().substr(query + 1);
+	job->params["host"] = request.getHeader("host");
+	job->params["method"] = request.getMethod();
+	return (job);
+}
+
+/*	============================================================================
+		CGI START (fork/execve/pipe)
+		Returns immediately: the pipes are handed to the main event loop
+		instead of being drained here with blocking select() calls.
+	============================================================================ */
+
+static void	closePipes(int pipe_in[2], int pipe_out[2]) {
+	close(pipe_in[0]);
+	close(pipe_in[1]);
+	close(pipe_out[0]);
+	close(pipe_out[1]);
+}
+
+CGIJob*	CGIHandler::start(const std::string &scriptPath, const Request &request,
+					ServerConfig &server, const std::map<std::string, std::string> &handlers) {
 
 	if (!isCGI(scriptPath, handlers))
-		return (result);
+		return (NULL);
 	std::string interpreter = getCGIInterpreter(scriptPath, handlers);
 	if (interpreter.empty())
-		return (result);
+		return (NULL);
 	int pipe_in[2];
 	int pipe_out[2];
-	if (pipe(pipe_in) == -1 || pipe(pipe_out) == -1)
-		return (result);
+	if (pipe(pipe_in) == -1)
+		return (NULL);
+	if (pipe(pipe_out) == -1) {
+		close(pipe_in[0]);
+		close(pipe_in[1]);
+		return (NULL);
+	}
+	// Corps resté sur disque : il devient directement le stdin du script,
+	// sans repasser par la mémoire ni par le pipe. O_CLOEXEC : un autre fork
+	// d'ici la fermeture ne l'hérite pas, le dup2() du fils n'a pas l'indicateur
+	int body_fd = -1;
+	if (!request.getBodyFile().empty()) {
+		body_fd = open(request.getBodyFile().c_str(), O_RDONLY | O_CLOEXEC);
+		if (body_fd == -1) {
+			closePipes(pipe_in, pipe_out);
+			return (NULL);
+		}
+	}
 
 	std::map<std::string, std::string> cgi_env = _buildCGIEnvironment(request, scriptPath, server);
 	std::vector<char*> env_array = _mapToCharArray(cgi_env);
 	pid_t pid = fork();
 	if (pid == -1) {
-		close(pipe_in[0]);
-		close(pipe_in[1]);
-		close(pipe_out[0]);
-		close(pipe_out[1]);
+		closePipes(pipe_in, pipe_out);
+		if (body_fd != -1)
+			close(body_fd);
 		for (size_t i = 0; i < env_array.size() - 1; i++)
 			delete[] env_array[i];
-		return (result);
+		return (NULL);
 	}
 	if (pid == 0) {
 		close(pipe_in[1]);
 		close(pipe_out[0]);
-		dup2(pipe_in[0], STDIN_FILENO);
+		dup2(body_fd != -1 ? body_fd : pipe_in[0], STDIN_FILENO);
 		dup2(pipe_out[1], STDOUT_FILENO);
 		close(pipe_in[0]);
 		close(pipe_out[1]);
+		if (body_fd != -1)
+			close(body_fd);
 
 		// Résoudre le chemin absolu AVANT de chdir, sinon scriptPath relatif
 		// devient invalide après changement de répertoire
-		char        resolvedBuf[4096];
 		std::string absScriptPath = scriptPath;
 		if (scriptPath[0] != '/') {
 			char cwdBuf[4096];
@@ -169,7 +310,6 @@ CGIResult	CGIHandler::execute(const std::string &scriptPath, const Request &requ
 		// Normaliser les doubles slashes
 		while (absScriptPath.find("//") != std::string::npos)
 			absScriptPath.replace(absScriptPath.find("//"), 2, "/");
-		(void)resolvedBuf;
 
 		// Changer vers le répertoire du script (pour les imports relatifs CGI)
 		std::string scriptDir = ".";
@@ -186,58 +326,148 @@ CGIResult	CGIHandler::execute(const std::string &scriptPath, const Request &requ
 		execve(interpreter.c_str(), argv, &env_array[0]);
 		exit(127);
 	}
+	for (size_t i = 0; i < env_array.size() - 1; i++)
+		delete[] env_array[i];
 	close(pipe_in[0]);
 	close(pipe_out[1]);
+	if (body_fd != -1)
+		close(body_fd);
+	// Les extrémités parent ne doivent pas fuir dans les CGI suivants,
+	// sinon l'EOF de ce job dépendrait de la fin des autres
+	fcntl(pipe_in[1], F_SETFD, FD_CLOEXEC);
+	fcntl(pipe_out[0], F_SETFD, FD_CLOEXEC);
 	fcntl(pipe_in[1], F_SETFL, O_NONBLOCK);
 	fcntl(pipe_out[0], F_SETFL, O_NONBLOCK);
-	std::string	body = request.getBody();
-	size_t		written = 0;
-	while (written < body.length()) {
-		fd_set			write_fds;
-		struct timeval	timeout;
-		FD_ZERO(&write_fds);
-		FD_SET(pipe_in[1], &write_fds);
-		timeout.tv_sec = 5;
-		timeout.tv_usec = 0;
-		int ret = select(pipe_in[1] + 1, NULL, &write_fds, NULL, &timeout);
-		if (ret <= 0)
-			break;
-		ssize_t n = write(pipe_in[1], body.c_str() + written, body.length() - written);
-		if (n <= 0)
-			break;
-		written += (size_t)n;
+
+	CGIJob	*job = _newJob(request, server);
+	job->pid = pid;
+	job->stdinFd = pipe_in[1];
+	job->stdoutFd = pipe_out[0];
+	if (job->input.empty()) {
+		close(job->stdinFd);
+		job->stdinFd = -1;
 	}
-	close(pipe_in[1]);
-	char	buffer[4096];
-	bool	timed_out = false;
-	while (!timed_out) {
-		fd_set			read_fds;
-		struct timeval	timeout;
-		FD_ZERO(&read_fds);
-		FD_SET(pipe_out[0], &read_fds);
-		timeout.tv_sec = 5;
-		timeout.tv_usec = 0;
-		int ret = select(pipe_out[0] + 1, &read_fds, NULL, NULL, &timeout);
-		if (ret < 0)
-			break;
-		if (ret == 0) {
-			timed_out = true;
-			kill(pid, SIGKILL);
-			break;
-		}
-		ssize_t bytes = read(pipe_out[0], buffer, sizeof(buffer));
-		if (bytes <= 0)
-			break;
-		result.output.append(buffer, bytes);
+	return (job);
+}
+
+/*	============================================================================
+		CGI I/O (called when the poller reports the pipe ready)
+		The caller closes the fd once writeInput() is done or readOutput()
+		returns <= 0.
+	============================================================================ */
+
+ssize_t	CGIHandler::writeInput(CGIJob &job) {
+	if (job.stdinFd < 0 || job.inputOffset >= job.input.length())
+		return (0);
+	ssize_t n = write(job.stdinFd, job.input.c_str() + job.inputOffset,
+		job.input.length() - job.inputOffset);
+	if (n > 0) {
+		job.inputOffset += (size_t)n;
+		job.lastActivity = time(NULL);
 	}
-	close(pipe_out[0]);
-	int status;
-	waitpid(pid, &status, 0);
-	if (!timed_out && WIFEXITED(status)) {
-		result.exitCode = WEXITSTATUS(status);
-		result.success = (result.exitCode == 0);
+	return (n);
+}
+
+ssize_t	CGIHandler::readOutput(CGIJob &job) {
+	char	buffer[65536];
+
+	if (job.stdoutFd < 0)
+		return (0);
+	ssize_t bytes = read(job.stdoutFd, buffer, sizeof(buffer));
+	if (bytes > 0) {
+		job.result.output.append(buffer, bytes);
+		job.lastActivity = time(NULL);
 	}
-	for (size_t i = 0; i < env_array.size() - 1; i++)
-		delete[] env_array[i];
-	return (result);
+	return (bytes);
+}
+
+/*	============================================================================
+		CHILD LIFECYCLE
+		reap() never blocks: a child still running after EOF is left to the
+		caller's zombie list.
+	============================================================================ */
+
+bool	CGIHandler::reap(CGIJob &job) {
+	int		status;
+
+	if (job.exited || job.pid < 0)
+		return (true);
+	if (waitpid(job.pid, &status, WNOHANG) != job.pid)
+		return (false);
+	job.exited = true;
+	if (!job.timedOut && WIFEXITED(status)) {
+		job.result.exitCode = WEXITSTATUS(status);
+		job.result.success = (job.result.exitCode == 0);
+	}
+	return (true);
+}
+
+void	CGIHandler::kill(CGIJob &job) {
+	if (!job.exited && job.pid > 0)
+		::kill(job.pid, SIGKILL);
+}
+
+/*	============================================================================
+		CGI HEADER BLOCK
+		findHeaderEnd() resumes where the previous call stopped, so a header
+		block trickling in over many reads is scanned only once.
+	============================================================================ */
+
+size_t	CGIHandler::findHeaderEnd(CGIJob &job, size_t &bodyStart) {
+	const std::string	&output = job.result.output;
+	size_t				from = (job.headerScan > 3) ? job.headerScan - 3 : 0;
+	size_t				crlf = output.find("\r\n\r\n", from);
+	size_t				lf = output.find("\n\n", from);
+
+	job.headerScan = output.length();
+	if (crlf != std::string::npos && (lf == std::string::npos || crlf < lf)) {
+		bodyStart = crlf + 4;
+		return (crlf);
+	}
+	if (lf != std::string::npos) {
+		bodyStart = lf + 2;
+		return (lf);
+	}
+	return (std::string::npos);
+}
+
+void	CGIHandler::parseHeaders(const std::string &block, CGIHeaders &headers) {
+	size_t	pos = 0;
+
+	headers.statusCode = 200;
+	headers.contentType = "text/html";
+	headers.contentLength = -1;
+	headers.extra.clear();
+	while (pos < block.size()) {
+		size_t lineEnd = block.find('\n', pos);
+		if (lineEnd == std::string::npos)
+			lineEnd = block.size();
+		std::string line = block.substr(pos, lineEnd - pos);
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line = line.substr(0, line.size() - 1);
+		pos = lineEnd + 1;
+		size_t colonPos = line.find(':');
+		if (line.empty() || colonPos == std::string::npos)
+			continue;
+		std::string key   = line.substr(0, colonPos);
+		std::string value = line.substr(colonPos + 1);
+		size_t valStart = value.find_first_not_of(" \t");
+		value = (valStart != std::string::npos) ? value.substr(valStart) : "";
+		std::string lower = httpToLower(key);
+		if (lower == "status")
+			headers.statusCode = atoi(value.c_str());
+		else if (lower == "content-type")
+			headers.contentType = value;
+		else if (lower == "content-length") {
+			// Longueur invalide ("abc", "12abc") : ignorée, le corps part
+			// alors en chunked (ou jusqu'à la fermeture en HTTP/1.0)
+			if (!httpParseContentLength(value, headers.contentLength))
+				headers.contentLength = -1;
+		}
+		else if (lower != "connection" && lower != "transfer-encoding"
+		         && lower != "keep-alive")
+			headers.extra.push_back(std::make_pair(key, value));
+	}
+	if (headers.statusCode < 100 || headers.statusCode > 599)
+		headers.statusCode = 200;
 }
@@ -11,6 +11,10 @@
 /* ************************************************************************** */
 
 #include "../inc/Config.hpp"
+#include "../inc/Poller.hpp"
+#include <unistd.h>
+#include <netdb.h>
+#include <cstring>
 
 static bool	isValidIPv4(const std::string &ip) {
 	if (ip.empty())
@@ -25,7 +29,16 @@ static bool	isValidIPv4(const std::string &ip) {
 	return (dots == 3);
 }
 
-ConfigParser::ConfigParser() : _position(0), _lineNumber(1) {}
+ConfigParser::ConfigParser() : _position(0), _lineNumber(1) {
+	_global.workerProcesses = 1;
+	_global.openFileCacheMax = 0;
+	_global.openFileCacheValid = 60;
+	_global.contentCacheSize = 0;
+	_global.contentCacheMaxFile = 0;
+	_global.responseCacheSize = 0;
+	_global.responseCacheMaxEntry = 0;
+	_global.responseCacheDiskSize = 0;
+}
 ConfigParser::~ConfigParser() {}
 
 void	ConfigParser::_readFile(const std::string &filepath) {
@@ -76,6 +89,47 @@ int	ConfigParser::_stringToInt(const std::string &str) {
 	return ((int)value);
 }
 
+// Taille en octets avec suffixe optionnel k ou m (comme nginx)
+long	ConfigParser::_stringToSize(const std::string &str) {
+	long	unit = 1;
+	std::string	digits = str;
+
+	if (!digits.empty()) {
+		char	last = std::tolower(digits[digits.length() - 1]);
+		if (last == 'k')
+			unit = 1024;
+		else if (last == 'm')
+			unit = 1024 * 1024;
+		if (unit != 1)
+			digits.erase(digits.length() - 1);
+	}
+	return ((long)_stringToInt(digits) * unit);
+}
+
+// "expires off | epoch | max | N[s|m|h|d]" (comme nginx)
+long	ConfigParser::_parseExpires(const std::string &str) {
+	if (str == "off")
+		return (EXPIRES_OFF);
+	if (str == "epoch")
+		return (EXPIRES_EPOCH);
+	if (str == "max")
+		return (315360000);
+	long		unit = 1;
+	std::string	digits = str;
+	if (!digits.empty()) {
+		char	last = digits[digits.length() - 1];
+		if (last == 'm')
+			unit = 60;
+		else if (last == 'h')
+			unit = 3600;
+		else if (last == 'd')
+			unit = 86400;
+		if (unit != 1 || last == 's')
+			digits.erase(digits.length() - 1);
+	}
+	return ((long)_stringToInt(digits) * unit);
+}
+
 bool ConfigParser::_stringToBool(const std::string &str) {
 	if (str == "on" || str == "true" || str == "yes" || str == "1")
 		return true;
@@ -90,7 +144,7 @@ std::string	ConfigParser::_readToken() {
 		return ("");
 	std::string	token;
 	char		c = _fileContent[_position];
-	if (c == '{' || c == '}' || c == ';' || c == ':') {
+	if (c == '{' || c == '}' || c == ';' || c == ':' || c == '=') {
 		token += c;
 		_position++;
 		return (token);
@@ -107,7 +161,7 @@ std::string	ConfigParser::_readToken() {
 	}
 	while (_position < _fileContent.length()) {
 		char ch = _fileContent[_position];
-		if (std::isalnum(ch) || ch == '_' || ch == '.' || ch == '/' || ch == '-' || ch == ':') {
+		if (std::isalnum(ch) || ch == '_' || ch == '.' || ch == '/' || ch == '-' || ch == ':' || ch == '*' || ch == '+' || ch == '$' || ch == '[' || ch == ']') {
 			token += ch;
 			_position++;
 		} else
@@ -177,11 +231,23 @@ void	ConfigParser::_parseServerDirective(const std::string &key, ServerConfig &c
 			config.serverNames.push_back(token);
 		}
 	} else if (key == "max_body_size") {
-		token = _readToken();
-		config.maxBodySize = _stringToInt(token);
+		config.maxBodySize = _stringToSize(_readToken());
 		token = _readToken();
 		if (token != ";")
 			throw ConfigParserE(_formatErrorMsg("Expected ';' after max_body_size, got: " + token));
+	} else if (key == "client_body_buffer_size") {
+		config.clientBodyBufferSize = _stringToSize(_readToken());
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after client_body_buffer_size, got: " + token));
+	} else if (key == "client_body_temp_path") {
+		token = _readToken();
+		if (token.empty() || token == ";")
+			throw ConfigParserE(_formatErrorMsg("client_body_temp_path requires a directory"));
+		config.clientBodyTempPath = token;
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after client_body_temp_path, got: " + token));
 	} else if (key == "root") {
 		token = _readToken();
 		if (token.empty() || token == ";")
@@ -190,6 +256,40 @@ void	ConfigParser::_parseServerDirective(const std::string &key, ServerConfig &c
 		token = _readToken();
 		if (token != ";")
 			throw ConfigParserE(_formatErrorMsg("Expected ';' after root, got: " + token));
+	} else if (key == "keepalive_timeout") {
+		token = _readToken();
+		config.keepaliveTimeout = _stringToInt(token);
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after keepalive_timeout, got: " + token));
+	} else if (key == "keepalive_requests") {
+		token = _readToken();
+		config.keepaliveRequests = _stringToInt(token);
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after keepalive_requests, got: " + token));
+	} else if (key == "client_header_timeout" || key == "client_body_timeout"
+	           || key == "send_timeout") {
+		int	seconds = _stringToInt(_readToken());
+		if (seconds < 1)
+			throw ConfigParserE(_formatErrorMsg(key + " must be at least 1 second"));
+		if (key == "client_header_timeout")
+			config.clientHeaderTimeout = seconds;
+		else if (key == "client_body_timeout")
+			config.clientBodyTimeout = seconds;
+		else
+			config.sendTimeout = seconds;
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after " + key + ", got: " + token));
+	} else if (key == "send_min_rate") {
+		token = _readToken();
+		config.sendMinRate = _stringToInt(token);
+		if (config.sendMinRate < 0)
+			throw ConfigParserE(_formatErrorMsg("send_min_rate must not be negative"));
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after send_min_rate, got: " + token));
 	} else if (key == "error_page") {
 		int	error_code = _stringToInt(_readToken());
 		std::string	errorPath = _readToken();
@@ -230,6 +330,66 @@ void	ConfigParser::_parseLocationDirective(const std::string &key, LocationConfi
 		token = _readToken();
 		if (token != ";")
 			throw ConfigParserE(_formatErrorMsg("Expected ';' after autoindex, got: " + token));
+	} else if (key == "gzip_static") {
+		token = _readToken();
+		location.gzipStatic = _stringToBool(token);
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after gzip_static, got: " + token));
+	} else if (key == "gzip") {
+		location.gzip = _stringToBool(_readToken());
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after gzip, got: " + token));
+	} else if (key == "gzip_types") {
+		token = _readToken();
+		while (!token.empty() && token != ";") {
+			location.gzipTypes.push_back(token);
+			token = _readToken();
+		}
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after gzip_types"));
+	} else if (key == "cache_valid") {
+		_parseCacheValid(location);
+	} else if (key == "cache_key") {
+		token = _readToken();
+		if (token.empty() || token == ";")
+			throw ConfigParserE(_formatErrorMsg("cache_key requires a value"));
+		location.cacheKey = token;
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after cache_key, got: " + token));
+	} else if (key == "cache_bypass") {
+		token = _readToken();
+		while (!token.empty() && token != ";") {
+			location.cacheBypass.push_back(token);
+			token = _readToken();
+		}
+		if (token != ";" || location.cacheBypass.empty())
+			throw ConfigParserE(_formatErrorMsg("cache_bypass requires at least one value"));
+	} else if (key == "gzip_min_length") {
+		location.gzipMinLength = _stringToSize(_readToken());
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after gzip_min_length, got: " + token));
+	} else if (key == "gzip_level") {
+		location.gzipLevel = _stringToInt(_readToken());
+		if (location.gzipLevel < 1 || location.gzipLevel > 9)
+			throw ConfigParserE(_formatErrorMsg("gzip_level must be between 1 and 9"));
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after gzip_level, got: " + token));
+	} else if (key == "max_body_size") {
+		location.maxBodySize = _stringToSize(_readToken());
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after max_body_size, got: " + token));
+	} else if (key == "proxy_pass") {
+		token = _readToken();
+		_parseProxyPass(token, location);
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after proxy_pass, got: " + token));
 	} else if (key == "redirect_url") {
 		token = _readToken();
 		if (token.empty() || token == ";")
@@ -263,6 +423,29 @@ void	ConfigParser::_parseLocationDirective(const std::string &key, LocationConfi
 		token = _readToken();
 		if (token != ";")
 			throw ConfigParserE(_formatErrorMsg("Expected ';' after cgi_extension, got: " + token));
+	} else if (key == "fastcgi_pass") {
+		token = _readToken();
+		if (token.empty() || token == ";")
+			throw ConfigParserE(_formatErrorMsg("fastcgi_pass requires an address"));
+		if (token.compare(0, 5, "unix:") != 0 && token.find(':') == std::string::npos)
+			throw ConfigParserE(_formatErrorMsg("fastcgi_pass expects unix:/path or host:port, got: " + token));
+		location.fastcgiPass = token;
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after fastcgi_pass, got: " + token));
+	} else if (key == "expires") {
+		location.expires = _parseExpires(_readToken());
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after expires, got: " + token));
+	} else if (key == "cache_control") {
+		token = _readToken();
+		if (token.empty() || token == ";")
+			throw ConfigParserE(_formatErrorMsg("cache_control requires a value"));
+		location.cacheControl = token;
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' after cache_control, got: " + token));
 	} else
 		throw ConfigParserE(_formatErrorMsg("Unknown location directive: " + key));
 }
@@ -272,7 +455,19 @@ LocationConfig	ConfigParser::_parseLocationBlock() {
 	std::string		token;
 	location.autoIndex = false;
 	location.allowUpload = false;
+	location.exactMatch = false;
+	location.expires = EXPIRES_OFF;
+	location.gzipStatic = false;
+	location.gzip = false;
+	location.gzipMinLength = 20;
+	location.gzipLevel = 1;
+	location.maxBodySize = -1;
+	location.cacheKey = "$host$request_uri";
 	token = _readToken();
+	if (token == "=") {
+		location.exactMatch = true;
+		token = _readToken();
+	}
 	if (token.empty() || token == "{")
 		throw ConfigParserE(_formatErrorMsg("Location requires a path"));
 	location.path = token;
@@ -301,6 +496,14 @@ ServerConfig	ConfigParser::_parseServerBlock() {
 	config.port = 0;
 	config.root = "";
 	config.maxBodySize = 0;
+	config.clientBodyBufferSize = 16 * 1024;
+	config.clientBodyTempPath = "/tmp";
+	config.keepaliveTimeout = 65;
+	config.keepaliveRequests = 100;
+	config.clientHeaderTimeout = 60;
+	config.clientBodyTimeout = 60;
+	config.sendTimeout = 60;
+	config.sendMinRate = 0;
 	token = _readToken();
 	if (token != "{")
 		throw ConfigParserE(_formatErrorMsg("Expected '{' after 'server', got: " + token));
@@ -326,6 +529,318 @@ ServerConfig	ConfigParser::_parseServerBlock() {
 	return (config);
 }
 
+void	ConfigParser::_parseEventsBlock() {
+	std::string		token;
+
+	token = _readToken();
+	if (token != "{")
+		throw ConfigParserE(_formatErrorMsg("Expected '{' after 'events', got: " + token));
+	while (true) {
+		token = _readToken();
+		if (token == "}")
+			break ;
+		if (token.empty())
+			throw ConfigParserE(_formatErrorMsg("Unexpected EOF in events block"));
+		if (token == "use") {
+			token = _readToken();
+			if (!APoller::isSupported(token))
+				throw ConfigParserE(_formatErrorMsg("Unsupported event backend: " + token));
+			_global.eventBackend = token;
+			token = _readToken();
+			if (token != ";")
+				throw ConfigParserE(_formatErrorMsg("Expected ';' after use, got: " + token));
+		} else
+			throw ConfigParserE(_formatErrorMsg("Unknown events directive: " + token));
+	}
+}
+
+// "auto" : un worker par cœur en ligne
+void	ConfigParser::_parseWorkerProcesses() {
+	std::string	token = _readToken();
+
+	if (token == "auto") {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		_global.workerProcesses = (cores > 0) ? (int)cores : 1;
+	} else {
+		_global.workerProcesses = _stringToInt(token);
+		if (_global.workerProcesses < 1 || _global.workerProcesses > 256)
+			throw ConfigParserE(_formatErrorMsg("worker_processes must be between 1 and 256 or auto"));
+	}
+	token = _readToken();
+	if (token != ";")
+		throw ConfigParserE(_formatErrorMsg("Expected ';' after worker_processes, got: " + token));
+}
+
+// "open_file_cache off;" ou "open_file_cache max=N [valid=Ns];"
+void	ConfigParser::_parseOpenFileCache() {
+	std::string	token = _readToken();
+
+	if (token == "off") {
+		_global.openFileCacheMax = 0;
+		token = _readToken();
+	}
+	while (token == "max" || token == "valid") {
+		std::string	key = token;
+		token = _readToken();
+		if (token != "=")
+			throw ConfigParserE(_formatErrorMsg("Expected '=' after " + key + ", got: " + token));
+		token = _readToken();
+		if (key == "valid" && !token.empty() && token[token.length() - 1] == 's')
+			token.erase(token.length() - 1);
+		int	value = _stringToInt(token);
+		if (key == "max")
+			_global.openFileCacheMax = value;
+		else if (value < 1)
+			throw ConfigParserE(_formatErrorMsg("open_file_cache valid must be at least 1s"));
+		else
+			_global.openFileCacheValid = value;
+		token = _readToken();
+	}
+	if (token != ";")
+		throw ConfigParserE(_formatErrorMsg("Expected ';' after open_file_cache, got: " + token));
+}
+
+// "content_cache off;" ou "content_cache size=N[k|m] [max_file=N[k|m]];"
+void	ConfigParser::_parseContentCache() {
+	std::string	token = _readToken();
+
+	if (token == "off") {
+		_global.contentCacheSize = 0;
+		token = _readToken();
+	}
+	while (token == "size" || token == "max_file") {
+		std::string	key = token;
+		token = _readToken();
+		if (token != "=")
+			throw ConfigParserE(_formatErrorMsg("Expected '=' after " + key + ", got: " + token));
+		long	value = _stringToSize(_readToken());
+		if (key == "size")
+			_global.contentCacheSize = value;
+		else
+			_global.contentCacheMaxFile = value;
+		token = _readToken();
+	}
+	if (token != ";")
+		throw ConfigParserE(_formatErrorMsg("Expected ';' after content_cache, got: " + token));
+	if (_global.contentCacheSize > 0 && _global.contentCacheMaxFile == 0)
+		_global.contentCacheMaxFile = 64 * 1024;
+}
+
+// "response_cache size=4m [max_entry=256k] [path=/tmp/webserv-cache disk=64m];"
+void	ConfigParser::_parseResponseCache() {
+	std::string	token = _readToken();
+
+	if (token == "off") {
+		_global.responseCacheSize = 0;
+		token = _readToken();
+	}
+	while (token == "size" || token == "max_entry" || token == "path" || token == "disk") {
+		std::string	key = token;
+		token = _readToken();
+		if (token != "=")
+			throw ConfigParserE(_formatErrorMsg("Expected '=' after " + key + ", got: " + token));
+		token = _readToken();
+		if (key == "path")
+			_global.responseCachePath = token;
+		else if (key == "size")
+			_global.responseCacheSize = _stringToSize(token);
+		else if (key == "max_entry")
+			_global.responseCacheMaxEntry = _stringToSize(token);
+		else
+			_global.responseCacheDiskSize = _stringToSize(token);
+		token = _readToken();
+	}
+	if (token != ";")
+		throw ConfigParserE(_formatErrorMsg("Expected ';' after response_cache, got: " + token));
+	if (_global.responseCacheSize > 0 && _global.responseCacheMaxEntry == 0)
+		_global.responseCacheMaxEntry = 256 * 1024;
+	if (!_global.responseCachePath.empty() && _global.responseCacheDiskSize == 0)
+		_global.responseCacheDiskSize = 64 * 1024 * 1024;
+}
+
+// "cache_valid [code ... | any] durée;" sans code : 200 301 302 (comme nginx)
+void	ConfigParser::_parseCacheValid(LocationConfig &location) {
+	std::vector<std::string>	args;
+	std::string					token = _readToken();
+
+	while (!token.empty() && token != ";") {
+		args.push_back(token);
+		token = _readToken();
+	}
+	if (token != ";" || args.empty())
+		throw ConfigParserE(_formatErrorMsg("cache_valid requires a duration"));
+	long	seconds = _parseExpires(args.back());
+	if (seconds <= 0)
+		throw ConfigParserE(_formatErrorMsg("Invalid cache_valid duration: " + args.back()));
+	args.pop_back();
+	if (args.empty()) {
+		location.cacheValid[200] = seconds;
+		location.cacheValid[301] = seconds;
+		location.cacheValid[302] = seconds;
+	}
+	for (size_t i = 0; i < args.size(); i++) {
+		int	code = (args[i] == "any") ? 0 : _stringToInt(args[i]);
+		if (code != 0 && (code < 200 || code > 599))
+			throw ConfigParserE(_formatErrorMsg("Invalid cache_valid status: " + args[i]));
+		location.cacheValid[code] = seconds;
+	}
+}
+
+/*	============================================================================
+	UPSTREAM
+	upstream nom {
+		least_conn;  |  hash $request_uri [consistent];  (défaut : round-robin)
+		server hôte:port [weight=N] [max_fails=N] [fail_timeout=Ns];
+		keepalive N;
+	}
+	============================================================================ */
+
+void	ConfigParser::_parseUpstreamBlock() {
+	UpstreamConfig	upstream;
+	std::string		token;
+
+	upstream.name = _readToken();
+	if (upstream.name.empty() || upstream.name == "{")
+		throw ConfigParserE(_formatErrorMsg("upstream requires a name"));
+	if (_global.upstreams.count(upstream.name))
+		throw ConfigParserE(_formatErrorMsg("Duplicate upstream: " + upstream.name));
+	upstream.balance = UPSTREAM_ROUND_ROBIN;
+	upstream.consistent = false;
+	upstream.keepalive = 8;
+	token = _readToken();
+	if (token != "{")
+		throw ConfigParserE(_formatErrorMsg("Expected '{' after upstream name, got: " + token));
+	while (true) {
+		token = _readToken();
+		if (token == "}")
+			break ;
+		if (token.empty())
+			throw ConfigParserE(_formatErrorMsg("Unexpected EOF in upstream block"));
+		if (token == "server") {
+			_parseUpstreamServer(upstream);
+			continue ;
+		}
+		if (token == "least_conn")
+			upstream.balance = UPSTREAM_LEAST_CONN;
+		else if (token == "hash") {
+			upstream.balance = UPSTREAM_HASH;
+			upstream.hashKey = _readToken();
+			if (upstream.hashKey.empty() || upstream.hashKey == ";")
+				throw ConfigParserE(_formatErrorMsg("hash requires a key"));
+			if (_peekToken() == "consistent") {
+				_readToken();
+				upstream.consistent = true;
+			}
+		}
+		else if (token == "keepalive")
+			upstream.keepalive = _stringToInt(_readToken());
+		else
+			throw ConfigParserE(_formatErrorMsg("Unknown upstream directive: " + token));
+		token = _readToken();
+		if (token != ";")
+			throw ConfigParserE(_formatErrorMsg("Expected ';' in upstream block, got: " + token));
+	}
+	if (upstream.servers.empty())
+		throw ConfigParserE(_formatErrorMsg("upstream " + upstream.name + " has no server"));
+	_global.upstreams[upstream.name] = upstream;
+}
+
+void	ConfigParser::_parseUpstreamServer(UpstreamConfig &upstream) {
+	UpstreamServer	server;
+	std::string		token;
+
+	server.address = _readToken();
+	if (server.address.find(':') == std::string::npos)
+		throw ConfigParserE(_formatErrorMsg("upstream server must be host:port, got: " + server.address));
+	_resolveUpstreamServer(server);
+	server.weight = 1;
+	server.maxFails = 1;
+	server.failTimeout = 10;
+	token = _readToken();
+	while (token == "weight" || token == "max_fails" || token == "fail_timeout") {
+		std::string	key = token;
+		if (_readToken() != "=")
+			throw ConfigParserE(_formatErrorMsg("Expected '=' after " + key));
+		token = _readToken();
+		if (key == "fail_timeout" && !token.empty() && token[token.length() - 1] == 's')
+			token.erase(token.length() - 1);
+		int	value = _stringToInt(token);
+		if (key == "weight" && value < 1)
+			throw ConfigParserE(_formatErrorMsg("weight must be at least 1"));
+		if (key == "weight")
+			server.weight = value;
+		else if (key == "max_fails")
+			server.maxFails = value;
+		else
+			server.failTimeout = value;
+		token = _readToken();
+	}
+	if (token != ";")
+		throw ConfigParserE(_formatErrorMsg("Expected ';' after upstream server, got: " + token));
+	upstream.servers.push_back(server);
+}
+
+// Résolution au chargement : la boucle d'événements ne fait ensuite que
+// socket() et connect(). IPv4 ou IPv6, première adresse retenue
+void	ConfigParser::_resolveUpstreamServer(UpstreamServer &server) {
+	size_t				colon = server.address.rfind(':');
+	std::string			host = server.address.substr(0, colon);
+	std::string			port = server.address.substr(colon + 1);
+	struct addrinfo		hints;
+	struct addrinfo		*res = NULL;
+
+	if (host.size() > 2 && host[0] == '[' && host[host.size() - 1] == ']')
+		host = host.substr(1, host.size() - 2);
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (host.empty() || port.empty() || getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res)
+		throw ConfigParserE(_formatErrorMsg("host not found in upstream: " + server.address));
+	std::memset(&server.sockaddr, 0, sizeof(server.sockaddr));
+	std::memcpy(&server.sockaddr, res->ai_addr, res->ai_addrlen);
+	server.sockaddrLen = res->ai_addrlen;
+	freeaddrinfo(res);
+}
+
+// "http://nom[/uri]" : nom d'un upstream, ou directement "hôte:port"
+void	ConfigParser::_parseProxyPass(const std::string &target, LocationConfig &location) {
+	if (target.compare(0, 7, "http://") != 0)
+		throw ConfigParserE(_formatErrorMsg("proxy_pass must start with http://, got: " + target));
+	std::string	rest = target.substr(7);
+	size_t		slash = rest.find('/');
+	location.proxyPass = rest.substr(0, slash);
+	if (slash != std::string::npos)
+		location.proxyUri = rest.substr(slash);
+	if (location.proxyPass.empty())
+		throw ConfigParserE(_formatErrorMsg("proxy_pass requires a host"));
+}
+
+// Un proxy_pass vers "hôte:port" sans bloc upstream en crée un implicite
+void	ConfigParser::_resolveUpstreams(std::vector<ServerConfig> &servers) {
+	for (size_t i = 0; i < servers.size(); i++) {
+		for (size_t j = 0; j < servers[i].locations.size(); j++) {
+			const std::string	&name = servers[i].locations[j].proxyPass;
+			if (name.empty() || _global.upstreams.count(name))
+				continue ;
+			if (name.find(':') == std::string::npos)
+				throw ConfigParserE("Unknown upstream in proxy_pass: " + name);
+			UpstreamConfig	upstream;
+			UpstreamServer	server;
+			upstream.name = name;
+			upstream.balance = UPSTREAM_ROUND_ROBIN;
+			upstream.consistent = false;
+			upstream.keepalive = 8;
+			server.address = name;
+			_resolveUpstreamServer(server);
+			server.weight = 1;
+			server.maxFails = 1;
+			server.failTimeout = 10;
+			upstream.servers.push_back(server);
+			_global.upstreams[name] = upstream;
+		}
+	}
+}
+
 std::vector<ServerConfig>	ConfigParser::parse(const std::string &filepath) {
 	std::vector<ServerConfig>	servers;
 	std::string					token;
@@ -337,6 +852,36 @@ std::vector<ServerConfig>	ConfigParser::parse(const std::string &filepath) {
 		token = _peekToken();
 		if (token.empty())
 			break ;
+		if (token == "events") {
+			token = _readToken();
+			_parseEventsBlock();
+			continue ;
+		}
+		if (token == "worker_processes") {
+			token = _readToken();
+			_parseWorkerProcesses();
+			continue ;
+		}
+		if (token == "open_file_cache") {
+			token = _readToken();
+			_parseOpenFileCache();
+			continue ;
+		}
+		if (token == "content_cache") {
+			token = _readToken();
+			_parseContentCache();
+			continue ;
+		}
+		if (token == "response_cache") {
+			token = _readToken();
+			_parseResponseCache();
+			continue ;
+		}
+		if (token == "upstream") {
+			token = _readToken();
+			_parseUpstreamBlock();
+			continue ;
+		}
 		if (token != "server")
 			throw ConfigParserE(_formatErrorMsg("Expected 'server' keyword, got: " + token));
 		token = _readToken();
@@ -345,5 +890,10 @@ std::vector<ServerConfig>	ConfigParser::parse(const std::string &filepath) {
 	}
 	if (servers.empty())
 		throw ConfigParserE(_formatErrorMsg("No server blocks found in configuration"));
+	_resolveUpstreams(servers);
 	return (servers);
 }
+
+const GlobalConfig&	ConfigParser::getGlobalConfig() const {
+	return (_global);
+}
@@ -0,0 +1,90 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ContentCache.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 18:40:22 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 18:40:22 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ContentCache.hpp"
+
+ContentCache::EntryList		ContentCache::_lru;
+ContentCache::EntryIndex	ContentCache::_index;
+size_t						ContentCache::_bytes = 0;
+size_t						ContentCache::_maxBytes = 0;
+size_t						ContentCache::_maxFile = 0;
+
+void	ContentCache::_drop(EntryList::iterator it) {
+	_bytes -= it->buffer->data().size();
+	it->buffer->release();
+	_index.erase(it->path);
+	_lru.erase(it);
+}
+
+/*	============================================================================
+		PUBLIC API
+	============================================================================ */
+
+void	ContentCache::configure(size_t maxBytes, size_t maxFile) {
+	clear();
+	_maxBytes = maxBytes;
+	_maxFile = maxFile;
+}
+
+bool	ContentCache::accepts(long size) {
+	return (_maxBytes > 0 && size >= 0 && (size_t)size <= _maxFile);
+}
+
+// The returned buffer is borrowed: retain() it to keep it past the call
+SharedBuffer	*ContentCache::lookup(const std::string &path, const FileInfo &info) {
+	EntryIndex::iterator	found = _index.find(path);
+
+	if (found == _index.end())
+		return (NULL);
+	EntryList::iterator	it = found->second;
+	if (it->info.mtime != info.mtime || it->info.size != info.size
+	    || it->info.inode != info.inode || it->info.device != info.device) {
+		_drop(it);
+		return (NULL);
+	}
+	if (it != _lru.begin())
+		_lru.splice(_lru.begin(), _lru, it);
+	return (it->buffer);
+}
+
+// Takes over the caller's reference to buffer
+void	ContentCache::store(const std::string &path, const FileInfo &info,
+                            SharedBuffer *buffer) {
+	size_t	size = buffer->data().size();
+
+	invalidate(path);
+	if (size > _maxBytes) {
+		buffer->release();
+		return ;
+	}
+	while (_bytes + size > _maxBytes)
+		_drop(--_lru.end());
+	Entry	entry;
+	entry.path = path;
+	entry.info = info;
+	entry.buffer = buffer;
+	_lru.push_front(entry);
+	_index[path] = _lru.begin();
+	_bytes += size;
+}
+
+void	ContentCache::invalidate(const std::string &path) {
+	EntryIndex::iterator	found = _index.find(path);
+
+	if (found != _index.end())
+		_drop(found->second);
+}
+
+void	ContentCache::clear() {
+	while (!_lru.empty())
+		_drop(_lru.begin());
+}
@@ -0,0 +1,500 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   FastCGI.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 14:05:12 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 14:05:12 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/FastCGI.hpp"
+#include "../inc/Poller.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+
+/*	============================================================================
+		OUVERTURE DE LA CONNEXION
+		"unix:/chemin" ou "hôte:port". connect() est non bloquant : un refus
+		apparaît comme une écriture ou une lecture en échec dans la boucle.
+	============================================================================ */
+
+FastCGIConnection::FastCGIConnection(const std::string &address)
+	: _fd(-1), _address(address), _outOffset(0), _maxRequests(1), _paused(0) {
+}
+
+FastCGIConnection::~FastCGIConnection() {
+	if (_fd >= 0)
+		close(_fd);
+}
+
+static int	connectUnix(const std::string &path) {
+	struct sockaddr_un	addr;
+
+	if (path.size() >= sizeof(addr.sun_path))
+		return (-1);
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strcpy(addr.sun_path, path.c_str());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return (-1);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+	    && errno != EINPROGRESS && errno != EAGAIN) {
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+static int	connectInet(const std::string &host, const std::string &port) {
+	struct addrinfo	hints;
+	struct addrinfo	*res = NULL;
+
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res)
+		return (-1);
+	int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (fd >= 0) {
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		if (connect(fd, res->ai_addr, res->ai_addrlen) < 0 && errno != EINPROGRESS) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(res);
+	return (fd);
+}
+
+bool	FastCGIConnection::open() {
+	if (_address.compare(0, 5, "unix:") == 0)
+		_fd = connectUnix(_address.substr(5));
+	else {
+		size_t colon = _address.rfind(':');
+		_fd = connectInet(_address.substr(0, colon), _address.substr(colon + 1));
+	}
+	if (_fd < 0)
+		return (false);
+	// Le backend sait-il multiplexer ? Réponse dans FCGI_GET_VALUES_RESULT
+	std::string query;
+	query += (char)15;
+	query += (char)0;
+	query += "FCGI_MPXS_CONNS";
+	_appendRecord(FCGI_GET_VALUES, 0, query.data(), query.size());
+	return (true);
+}
+
+int	FastCGIConnection::getFd() const {
+	return (_fd);
+}
+
+// Le fd passe à l'appelant (fermeture différée dans la boucle)
+int	FastCGIConnection::releaseFd() {
+	int	fd = _fd;
+	_fd = -1;
+	return (fd);
+}
+
+const std::string	&FastCGIConnection::getAddress() const {
+	return (_address);
+}
+
+size_t	FastCGIConnection::activeCount() const {
+	return (_requests.size());
+}
+
+bool	FastCGIConnection::hasCapacity() const {
+	return (_requests.size() < _maxRequests);
+}
+
+int	FastCGIConnection::interest() const {
+	int	events = 0;
+	if (_paused == 0)
+		events |= POLLER_READ;
+	if (_outOffset < _out.size() || !_bodies.empty())
+		events |= POLLER_WRITE;
+	return (events);
+}
+
+/*	============================================================================
+		ENCODAGE DES RECORDS
+	============================================================================ */
+
+void	FastCGIConnection::_appendRecord(int type, int id, const char *data, size_t len) {
+	char	header[FCGI_HEADER_LEN];
+
+	header[0] = FCGI_VERSION_1;
+	header[1] = (char)type;
+	header[2] = (char)((id >> 8) & 0xff);
+	header[3] = (char)(id & 0xff);
+	header[4] = (char)((len >> 8) & 0xff);
+	header[5] = (char)(len & 0xff);
+	header[6] = 0;
+	header[7] = 0;
+	_out.append(header, FCGI_HEADER_LEN);
+	_out.append(data, len);
+}
+
+// Découpe en records <= 64 KiB, puis un record vide marque la fin du flux
+void	FastCGIConnection::_appendStream(int type, int id, const std::string &data) {
+	for (size_t off = 0; off < data.size(); off += FCGI_MAX_CONTENT) {
+		size_t len = data.size() - off;
+		if (len > FCGI_MAX_CONTENT)
+			len = FCGI_MAX_CONTENT;
+		_appendRecord(type, id, data.data() + off, len);
+	}
+	_appendRecord(type, id, "", 0);
+}
+
+static void	appendLength(std::string &out, size_t len) {
+	if (len < 128) {
+		out += (char)len;
+		return;
+	}
+	out += (char)(((len >> 24) & 0x7f) | 0x80);
+	out += (char)((len >> 16) & 0xff);
+	out += (char)((len >> 8) & 0xff);
+	out += (char)(len & 0xff);
+}
+
+void	FastCGIConnection::_appendParams(int id,
+			const std::map<std::string, std::string> &params) {
+	std::string	block;
+
+	for (std::map<std::string, std::string>::const_iterator it = params.begin();
+	     it != params.end(); ++it) {
+		appendLength(block, it->first.size());
+		appendLength(block, it->second.size());
+		block += it->first;
+		block += it->second;
+	}
+	_appendStream(FCGI_PARAMS, id, block);
+}
+
+int	FastCGIConnection::_nextId() const {
+	int	id = 1;
+	while (_requests.find(id) != _requests.end())
+		id++;
+	return (id);
+}
+
+/*	============================================================================
+		CYCLE DE VIE D'UNE REQUÊTE
+		Paramètres et corps en mémoire sont mis en file d'un coup ; flush()
+		les envoie quand la socket est prête en écriture. Un corps resté sur
+		disque est relu avec pread(), un record à la fois, seulement une fois
+		la file vidée, à tour de rôle entre les requêtes qui en ont un.
+	============================================================================ */
+
+bool	FastCGIConnection::submit(CGIJob *job) {
+	if (_fd < 0 || !hasCapacity())
+		return (false);
+	int		id = _nextId();
+	char	begin[8];
+
+	std::memset(begin, 0, sizeof(begin));
+	begin[1] = FCGI_RESPONDER;
+	begin[2] = FCGI_KEEP_CONN;
+	_appendRecord(FCGI_BEGIN_REQUEST, id, begin, sizeof(begin));
+	_appendParams(id, job->params);
+	if (job->bodyFd >= 0 && job->bodySize > 0) {
+		job->inputOffset = 0;
+		_bodies.push_back(job);
+	} else
+		_appendStream(FCGI_STDIN, id, job->input);
+	job->params.clear();
+	std::string().swap(job->input);
+	job->fcgiConn = this;
+	job->fcgiId = id;
+	_requests[id] = job;
+	return (true);
+}
+
+// Lecture courte : le flux se termine tôt, l'application reçoit moins que CONTENT_LENGTH
+void	FastCGIConnection::_fillBody() {
+	char	buffer[FCGI_MAX_CONTENT];
+	CGIJob	*job = _bodies.front();
+	size_t	want = job->bodySize - job->inputOffset;
+
+	if (want > sizeof(buffer))
+		want = sizeof(buffer);
+	ssize_t	got = pread(job->bodyFd, buffer, want, (off_t)job->inputOffset);
+	_bodies.erase(_bodies.begin());
+	if (got > 0) {
+		_appendRecord(FCGI_STDIN, job->fcgiId, buffer, (size_t)got);
+		job->inputOffset += (size_t)got;
+	}
+	if (got <= 0 || job->inputOffset >= job->bodySize)
+		_appendRecord(FCGI_STDIN, job->fcgiId, "", 0);
+	else
+		_bodies.push_back(job);
+}
+
+void	FastCGIConnection::_dropBody(CGIJob *job) {
+	for (size_t i = 0; i < _bodies.size(); i++) {
+		if (_bodies[i] == job) {
+			_bodies.erase(_bodies.begin() + i);
+			return;
+		}
+	}
+}
+
+// Client parti : l'id reste réservé jusqu'au FCGI_END_REQUEST du backend
+void	FastCGIConnection::abort(CGIJob *job) {
+	std::map<int, CGIJob*>::iterator it = _requests.find(job->fcgiId);
+	if (it == _requests.end() || it->second != job)
+		return;
+	setPaused(job, false);
+	_dropBody(job);
+	it->second = NULL;
+	_appendRecord(FCGI_ABORT_REQUEST, job->fcgiId, "", 0);
+	job->fcgiConn = NULL;
+	job->fcgiId = 0;
+}
+
+// Pas de contrôle de flux par requête en FastCGI : toute la connexion attend
+void	FastCGIConnection::setPaused(CGIJob *job, bool paused) {
+	if (job->paused == paused)
+		return;
+	job->paused = paused;
+	_paused += paused ? 1 : -1;
+}
+
+ssize_t	FastCGIConnection::flush() {
+	if (_outOffset >= _out.size() && !_bodies.empty())
+		_fillBody();
+	if (_outOffset >= _out.size())
+		return (0);
+	ssize_t	sent = send(_fd, _out.data() + _outOffset, _out.size() - _outOffset,
+		MSG_NOSIGNAL);
+	if (sent <= 0)
+		return (-1);
+	_outOffset += (size_t)sent;
+	if (_outOffset == _out.size()) {
+		_out.clear();
+		_outOffset = 0;
+	}
+	return (sent);
+}
+
+/*	============================================================================
+		DÉCODAGE DES RECORDS
+		Une lecture par évènement ; chaque record complet du tampon est
+		traité, un record partiel attend la lecture suivante.
+	============================================================================ */
+
+ssize_t	FastCGIConnection::receive(std::vector<CGIJob*> &touched) {
+	char	buffer[65536];
+
+	ssize_t	bytes = recv(_fd, buffer, sizeof(buffer), 0);
+	if (bytes <= 0)
+		return (bytes);
+	_in.append(buffer, bytes);
+	size_t	pos = 0;
+	while (_in.size() - pos >= FCGI_HEADER_LEN) {
+		const unsigned char *h = (const unsigned char *)_in.data() + pos;
+		int		type = h[1];
+		int		id = (h[2] << 8) | h[3];
+		size_t	len = (h[4] << 8) | h[5];
+		size_t	total = FCGI_HEADER_LEN + len + h[6];
+		if (_in.size() - pos < total)
+			break;
+		_handleRecord(type, id, _in.substr(pos + FCGI_HEADER_LEN, len), touched);
+		pos += total;
+	}
+	_in.erase(0, pos);
+	return (bytes);
+}
+
+static void	addTouched(std::vector<CGIJob*> &touched, CGIJob *job) {
+	for (size_t i = 0; i < touched.size(); i++) {
+		if (touched[i] == job)
+			return;
+	}
+	touched.push_back(job);
+}
+
+void	FastCGIConnection::_handleRecord(int type, int id, const std::string &content,
+			std::vector<CGIJob*> &touched) {
+	if (type == FCGI_GET_VALUES_RESULT) {
+		_handleValues(content);
+		return;
+	}
+	std::map<int, CGIJob*>::iterator it = _requests.find(id);
+	if (it == _requests.end())
+		return;
+	if (type == FCGI_END_REQUEST && content.size() >= 5) {
+		const unsigned char *b = (const unsigned char *)content.data();
+		int appStatus = (b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+		_finish(id, appStatus, b[4], touched);
+	}
+	else if (type == FCGI_STDOUT && it->second && !content.empty()) {
+		it->second->result.output += content;
+		it->second->lastActivity = time(NULL);
+		addTouched(touched, it->second);
+	}
+}
+
+void	FastCGIConnection::_handleValues(const std::string &content) {
+	size_t	pos = 0;
+
+	while (pos < content.size()) {
+		size_t nameLen = (unsigned char)content[pos++];
+		if (pos >= content.size())
+			return;
+		size_t valueLen = (unsigned char)content[pos++];
+		if (nameLen >= 128 || valueLen >= 128 || pos + nameLen + valueLen > content.size())
+			return;
+		std::string name = content.substr(pos, nameLen);
+		std::string value = content.substr(pos + nameLen, valueLen);
+		pos += nameLen + valueLen;
+		if (name == "FCGI_MPXS_CONNS")
+			_maxRequests = (std::atoi(value.c_str()) > 0) ? FASTCGI_MAX_REQUESTS : 1;
+	}
+}
+
+void	FastCGIConnection::_finish(int id, int appStatus, int protocolStatus,
+			std::vector<CGIJob*> &touched) {
+	CGIJob	*job = _requests[id];
+
+	_requests.erase(id);
+	if (!job)
+		return;
+	setPaused(job, false);
+	_dropBody(job);
+	job->exited = true;
+	job->result.exitCode = appStatus;
+	job->result.success = (protocolStatus == FCGI_REQUEST_COMPLETE && appStatus == 0);
+	if (protocolStatus != FCGI_REQUEST_COMPLETE && job->result.exitCode == 0)
+		job->result.exitCode = -1;
+	job->fcgiConn = NULL;
+	job->fcgiId = 0;
+	addTouched(touched, job);
+}
+
+// Connexion perdue : chaque requête en cours se termine en échec
+void	FastCGIConnection::failAll(std::vector<CGIJob*> &touched) {
+	std::vector<int>	ids;
+
+	for (std::map<int, CGIJob*>::iterator it = _requests.begin();
+	     it != _requests.end(); ++it)
+		ids.push_back(it->first);
+	for (size_t i = 0; i < ids.size(); i++)
+		_finish(ids[i], -1, -1, touched);
+}
+
+/*	============================================================================
+		POOL DE CONNEXIONS
+	============================================================================ */
+
+FastCGIPool::FastCGIPool() {
+}
+
+FastCGIPool::~FastCGIPool() {
+	for (std::map<int, FastCGIConnection*>::iterator it = _byFd.begin();
+	     it != _byFd.end(); ++it)
+		delete it->second;
+}
+
+FastCGIConnection	*FastCGIPool::acquire(const std::string &address, bool &created) {
+	std::vector<FastCGIConnection*>	&conns = _backends[address];
+
+	created = false;
+	for (size_t i = 0; i < conns.size(); i++) {
+		if (conns[i]->hasCapacity())
+			return (conns[i]);
+	}
+	if (conns.size() >= FASTCGI_MAX_CONNS)
+		return (NULL);
+	FastCGIConnection	*conn = new FastCGIConnection(address);
+	if (!conn->open()) {
+		delete conn;
+		return (NULL);
+	}
+	conns.push_back(conn);
+	_byFd[conn->getFd()] = conn;
+	created = true;
+	return (conn);
+}
+
+FastCGIConnection	*FastCGIPool::find(int fd) const {
+	std::map<int, FastCGIConnection*>::const_iterator it = _byFd.find(fd);
+	if (it == _byFd.end())
+		return (NULL);
+	return (it->second);
+}
+
+// Retire et détruit la connexion ; l'appelant a déjà repris son fd
+void	FastCGIPool::remove(FastCGIConnection *conn) {
+	std::vector<FastCGIConnection*>	&conns = _backends[conn->getAddress()];
+
+	for (size_t i = 0; i < conns.size(); i++) {
+		if (conns[i] == conn) {
+			conns.erase(conns.begin() + i);
+			break;
+		}
+	}
+	for (std::map<int, FastCGIConnection*>::iterator it = _byFd.begin();
+	     it != _byFd.end(); ++it) {
+		if (it->second == conn) {
+			_byFd.erase(it);
+			break;
+		}
+	}
+	delete conn;
+}
+
+// Toutes les connexions ouvertes et pleines : acquire() ne rendrait rien
+bool	FastCGIPool::saturated(const std::string &address) {
+	std::vector<FastCGIConnection*>	&conns = _backends[address];
+
+	if (conns.size() < FASTCGI_MAX_CONNS)
+		return (false);
+	for (size_t i = 0; i < conns.size(); i++) {
+		if (conns[i]->hasCapacity())
+			return (false);
+	}
+	return (true);
+}
+
+void	FastCGIPool::wait(CGIJob *job) {
+	_waiting[job->fastcgiPass].push_back(job);
+}
+
+// Premier job en attente s'il y a maintenant de la place, sinon NULL
+CGIJob	*FastCGIPool::nextWaiting(const std::string &address) {
+	std::map<std::string, std::deque<CGIJob*> >::iterator it = _waiting.find(address);
+
+	if (it == _waiting.end() || it->second.empty() || saturated(address))
+		return (NULL);
+	CGIJob	*job = it->second.front();
+	it->second.pop_front();
+	return (job);
+}
+
+// Client parti ou délai dépassé avant d'avoir obtenu une place
+void	FastCGIPool::cancelWait(CGIJob *job) {
+	std::map<std::string, std::deque<CGIJob*> >::iterator it = _waiting.find(job->fastcgiPass);
+
+	if (it == _waiting.end())
+		return;
+	for (size_t i = 0; i < it->second.size(); i++) {
+		if (it->second[i] == job) {
+			it->second.erase(it->second.begin() + i);
+			return;
+		}
+	}
+}
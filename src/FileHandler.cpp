@@ -11,28 +11,23 @@
 /* ************************************************************************** */
 
 #include "../inc/FileHandler.hpp"
+#include "../inc/ContentCache.hpp"
+#include <cctype>
 
 /*	============================================================================
 		FILE EXISTENCE & TYPE CHECKING
 	============================================================================ */
 
 bool	FileHandler::exists(const std::string &path) {
-	struct stat	statbuf;
-	return (stat(path.c_str(), &statbuf) == 0);
+	return (OpenFileCache::lookup(path).type != FILE_MISSING);
 }
 
 bool	FileHandler::isDirectory(const std::string &path) {
-	struct stat	statbuf;
-	if (stat(path.c_str(), &statbuf) != 0)
-		return (false);
-	return (S_ISDIR(statbuf.st_mode));
+	return (OpenFileCache::lookup(path).type == FILE_DIRECTORY);
 }
 
 bool	FileHandler::isFile(const std::string &path) {
-	struct stat	statbuf;
-	if (stat(path.c_str(), &statbuf) != 0)
-		return (false);
-	return (S_ISREG(statbuf.st_mode));
+	return (OpenFileCache::lookup(path).type == FILE_REGULAR);
 }
 
 /*	============================================================================
@@ -50,9 +45,16 @@ std::string	FileHandler::getContent(const std::string &path) {
 	return (buffer.str());
 }
 
+// The caller owns the returned fd (a dup of the cached one, if any)
+int	FileHandler::openForReading(const std::string &path, long &size) {
+	return (OpenFileCache::open(path, size));
+}
+
 bool	FileHandler::writeContent(const std::string &path, const std::string &content) {
 	std::ofstream	file(path.c_str(), std::ios::binary);
 
+	OpenFileCache::invalidate(path);
+	ContentCache::invalidate(path);
 	if (!file.is_open())
 		return (false);
 	file.write(content.c_str(), content.length());
@@ -63,18 +65,24 @@ bool	FileHandler::writeContent(const std::string &path, const std::string &conte
 bool	FileHandler::deleteFile(const std::string &path) {
 	if (!isFile(path))
 		return (false);
+	OpenFileCache::invalidate(path);
+	ContentCache::invalidate(path);
 	return (remove(path.c_str()) == 0);
 }
 
+// rename(2) is atomic: readers see the old file or the whole new one
+bool	FileHandler::moveFile(const std::string &from, const std::string &to) {
+	OpenFileCache::invalidate(to);
+	ContentCache::invalidate(to);
+	return (rename(from.c_str(), to.c_str()) == 0);
+}
+
 /*	============================================================================
 		FILE INFORMATION
 	============================================================================ */
 
 long	FileHandler::getFileSize(const std::string &path) {
-	struct stat	statbuf;
-	if (stat(path.c_str(), &statbuf) != 0)
-		return (-1);
-	return (statbuf.st_size);
+	return (OpenFileCache::lookup(path).size);
 }
 
 std::string	FileHandler::getFileExtension(const std::string &path) {
@@ -178,6 +186,22 @@ std::string	FileHandler::extractFileName(const std::string &uri) {
 	return (uri.substr(last_slash + 1));
 }
 
+// Client-supplied name (multipart filename): last path component only,
+// unusual characters replaced, hidden and empty names refused
+std::string	FileHandler::safeFileName(const std::string &name) {
+	size_t		slash = name.find_last_of("/\\");
+	std::string	base = (slash == std::string::npos) ? name : name.substr(slash + 1);
+
+	for (size_t i = 0; i < base.length(); i++) {
+		if (!std::isalnum((unsigned char)base[i]) && base[i] != '.'
+		    && base[i] != '-' && base[i] != '_')
+			base[i] = '_';
+	}
+	if (base.empty() || base[0] == '.')
+		return ("");
+	return (base);
+}
+
 std::string	FileHandler::normalizePath(const std::string &path) {
 	std::string	normalized = path;
 
@@ -0,0 +1,71 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Gzip.cpp                                           :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/18 10:05:13 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/18 10:05:13 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Gzip.hpp"
+
+/*	============================================================================
+		CONSTRUCTOR / DESTRUCTOR
+		windowBits 15 + 16 selects the gzip wrapper instead of raw zlib
+	============================================================================ */
+
+GzipStream::GzipStream(int level) : _open(false) {
+	_zs.zalloc = Z_NULL;
+	_zs.zfree = Z_NULL;
+	_zs.opaque = Z_NULL;
+	if (level < 1 || level > 9)
+		level = Z_DEFAULT_COMPRESSION;
+	_open = (deflateInit2(&_zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+}
+
+GzipStream::~GzipStream() {
+	if (_open)
+		deflateEnd(&_zs);
+}
+
+/*	============================================================================
+		PUBLIC API
+	============================================================================ */
+
+bool	GzipStream::isOpen() const {
+	return (_open);
+}
+
+// Appends the compressed form of in to out; finish writes the gzip trailer
+bool	GzipStream::write(const std::string &in, std::string &out, bool finish) {
+	char	buffer[16384];
+	int		flush = finish ? Z_FINISH : Z_SYNC_FLUSH;
+	int		ret;
+
+	if (!_open)
+		return (false);
+	_zs.next_in = (Bytef *)in.data();
+	_zs.avail_in = in.size();
+	do {
+		_zs.next_out = (Bytef *)buffer;
+		_zs.avail_out = sizeof(buffer);
+		ret = deflate(&_zs, flush);
+		if (ret == Z_STREAM_ERROR)
+			return (false);
+		out.append(buffer, sizeof(buffer) - _zs.avail_out);
+	} while (_zs.avail_out == 0);
+	if (finish) {
+		deflateEnd(&_zs);
+		_open = false;
+		return (ret == Z_STREAM_END);
+	}
+	return (true);
+}
+
+bool	GzipStream::compress(const std::string &in, int level, std::string &out) {
+	GzipStream	stream(level);
+	return (stream.write(in, out, true));
+}
@@ -13,6 +13,7 @@
 #include "../inc/HTTPCommon.hpp"
 #include "RequestHandler.hpp"
 #include "Config.hpp"
+#include <cstring>
 
 /*	============================================================================
 		MIME TYPES MAP (static, private to this file)
@@ -124,6 +125,17 @@ std::string		httpIntToString(long num) {
 	return (result);
 }
 
+// Chunk size line for Transfer-Encoding: chunked
+std::string		httpSizeToHex(size_t num) {
+	const char	*digits = "0123456789abcdef";
+	std::string	result;
+	do {
+		result = digits[num % 16] + result;
+		num /= 16;
+	} while (num > 0);
+	return (result);
+}
+
 std::string	httpToLower(const std::string &str) {
 	std::string	result = str;
 	for (size_t i = 0; i < result.length(); i++) {
@@ -145,6 +157,8 @@ std::string		httpStatusCodeToMessage(int code) {
 			return ("Created");
 		case HTTP_ACCEPTED:
 			return ("Accepted");
+		case HTTP_PARTIAL_CONTENT:
+			return ("Partial Content");
 		case HTTP_NO_CONTENT:
 			return ("No Content");
 
@@ -165,23 +179,172 @@ std::string		httpStatusCodeToMessage(int code) {
 			return ("Not Found");
 		case HTTP_METHOD_NOT_ALLOWED:
 			return ("Method Not Allowed");
+		case HTTP_REQUEST_TIMEOUT:
+			return ("Request Timeout");
 		case HTTP_CONFLICT:
 			return ("Conflict");
 		case HTTP_PAYLOAD_TOO_LARGE:
 			return ("Payload Too Large");
+		case HTTP_RANGE_NOT_SATISFIABLE:
+			return ("Range Not Satisfiable");
 
 		case HTTP_INTERNAL_SERVER_ERROR:
 			return ("Internal Server Error");
 		case HTTP_NOT_IMPLEMENTED:
 			return ("Not Implemented");
+		case HTTP_BAD_GATEWAY:
+			return ("Bad Gateway");
 		case HTTP_SERVICE_UNAVAILABLE:
 			return ("Service Unavailable");
+		case HTTP_GATEWAY_TIMEOUT:
+			return ("Gateway Timeout");
 
 		default:
 			return ("Unknown");
 	}
 }
 
+/*	============================================================================
+		HTTP DATES (RFC 9110: IMF-fixdate out, the three legacy forms in)
+	============================================================================ */
+
+std::string	httpFormatDate(time_t when) {
+	char		buf[64];
+	struct tm	tm;
+
+	gmtime_r(&when, &tm);
+	strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	return (std::string(buf));
+}
+
+// Returns -1 if the date matches none of the accepted formats
+time_t	httpParseDate(const std::string &date) {
+	static const char	*formats[] = {
+		"%a, %d %b %Y %H:%M:%S GMT",	// IMF-fixdate
+		"%A, %d-%b-%y %H:%M:%S GMT",	// RFC 850
+		"%a %b %e %H:%M:%S %Y",			// asctime()
+		NULL
+	};
+	struct tm	tm;
+
+	for (int i = 0; formats[i]; i++) {
+		std::memset(&tm, 0, sizeof(tm));
+		const char	*end = strptime(date.c_str(), formats[i], &tm);
+		if (end && *end == '\0')
+			return (timegm(&tm));
+	}
+	return (-1);
+}
+
+/*	============================================================================
+		CONTENT NEGOTIATION (Accept-Encoding)
+		A coding is acceptable when listed, or covered by "*", with a
+		non-zero q-value; an explicit entry wins over "*".
+	============================================================================ */
+
+bool	httpAcceptsEncoding(const std::string &accept, const std::string &coding) {
+	int		named = -1;
+	int		wildcard = -1;
+	size_t	pos = 0;
+
+	while (pos < accept.length()) {
+		size_t		comma = accept.find(',', pos);
+		if (comma == std::string::npos)
+			comma = accept.length();
+		std::string	item = accept.substr(pos, comma - pos);
+		pos = comma + 1;
+		size_t		semi = item.find(';');
+		std::string	name = item.substr(0, semi);
+		size_t		start = name.find_first_not_of(" \t");
+		if (start == std::string::npos)
+			continue ;
+		name = httpToLower(name.substr(start, name.find_last_not_of(" \t") - start + 1));
+		bool		allowed = true;
+		if (semi != std::string::npos) {
+			std::string	params = item.substr(semi + 1);
+			size_t		q = params.find("q=");
+			if (q != std::string::npos)
+				allowed = std::atof(params.c_str() + q + 2) > 0;
+		}
+		if (name == coding)
+			named = allowed;
+		else if (name == "*")
+			wildcard = allowed;
+	}
+	if (named != -1)
+		return (named == 1);
+	return (wildcard == 1);
+}
+
+/*	============================================================================
+		BYTE RANGES (RFC 9110 §14)
+		Returns HTTP_PARTIAL_CONTENT with the satisfiable ranges clamped to
+		the file, HTTP_RANGE_NOT_SATISFIABLE if none is, or HTTP_OK when the
+		header must be ignored (bad syntax, other unit, too many ranges).
+	============================================================================ */
+
+static bool	parseRangeNumber(const std::string &str, long &value) {
+	if (str.empty() || str.length() > 18)
+		return (false);
+	value = 0;
+	for (size_t i = 0; i < str.length(); i++) {
+		if (str[i] < '0' || str[i] > '9')
+			return (false);
+		value = value * 10 + (str[i] - '0');
+	}
+	return (true);
+}
+
+int		httpParseRange(const std::string &value, long size,
+                       std::vector<HTTPRange> &ranges) {
+	if (value.compare(0, 6, "bytes=") != 0)
+		return (HTTP_OK);
+	size_t	pos = 6;
+	int		specs = 0;
+	while (pos <= value.length()) {
+		size_t		comma = value.find(',', pos);
+		if (comma == std::string::npos)
+			comma = value.length();
+		std::string	spec = value.substr(pos, comma - pos);
+		size_t		start = spec.find_first_not_of(" \t");
+		size_t		end = spec.find_last_not_of(" \t");
+		pos = comma + 1;
+		if (start == std::string::npos)
+			continue ;
+		spec = spec.substr(start, end - start + 1);
+		size_t		dash = spec.find('-');
+		HTTPRange	range;
+		if (dash == std::string::npos || ++specs > HTTP_MAX_RANGES)
+			return (HTTP_OK);
+		if (dash == 0) {
+			long	suffix;
+			if (!parseRangeNumber(spec.substr(1), suffix))
+				return (HTTP_OK);
+			if (suffix == 0 || size == 0)
+				continue ;
+			range.first = suffix >= size ? 0 : size - suffix;
+			range.last = size - 1;
+		}
+		else {
+			if (!parseRangeNumber(spec.substr(0, dash), range.first))
+				return (HTTP_OK);
+			if (dash + 1 == spec.length())
+				range.last = size - 1;
+			else if (!parseRangeNumber(spec.substr(dash + 1), range.last)
+			         || range.last < range.first)
+				return (HTTP_OK);
+			if (range.first >= size)
+				continue ;
+			if (range.last >= size)
+				range.last = size - 1;
+		}
+		ranges.push_back(range);
+	}
+	if (specs == 0)
+		return (HTTP_OK);
+	return (ranges.empty() ? HTTP_RANGE_NOT_SATISFIABLE : HTTP_PARTIAL_CONTENT);
+}
+
 /*	============================================================================
 		HTTP VERSION VALIDATION
 	============================================================================ */
@@ -200,6 +363,27 @@ bool		httpIsValidMethod(const std::string &method) {
 		|| method == "PATCH");
 }
 
+/*	============================================================================
+		CONTENT-LENGTH VALIDATION
+		1*DIGIT only (RFC 9110 §8.6): no sign, no spaces inside, no suffix.
+		Used for requests, CGI output and upstream responses alike, so
+		"12abc" never frames a body as 12 bytes.
+	============================================================================ */
+
+bool		httpParseContentLength(const std::string &value, long &length) {
+	size_t	end = value.find_last_not_of(" \t");
+
+	if (end == std::string::npos || end >= 18)
+		return (false);
+	length = 0;
+	for (size_t i = 0; i <= end; i++) {
+		if (value[i] < '0' || value[i] > '9')
+			return (false);
+		length = length * 10 + (value[i] - '0');
+	}
+	return (true);
+}
+
 /*	============================================================================
 		MIME TYPE RETRIEVAL
 	============================================================================ */
@@ -231,22 +415,106 @@ HTTPServerEngine::~HTTPServerEngine() {
 	delete _handler;
 }
 
-std::string	HTTPServerEngine::processRequest(const std::string &rawData, int clientPort) {
+HTTPOutput	HTTPServerEngine::processRequest(const RawRequest &raw, HTTPConnection &conn) {
+	HTTPOutput	out;
+	conn.keepAlive = false;
 	try {
-		RawRequest raw = HTTPParser::parseRequest(rawData);
 		Request req;
 		req.loadFromRaw(raw);
-		Response resp = _handler->handleRequest(req, rawData, clientPort);
+		Response resp = _handler->handleRequest(req, conn);
+		if (resp.getCGIJob()) {
+			out.cgi = resp.getCGIJob();
+			out.cgi->keepAlive = conn.keepAlive;
+			out.cgi->keepAliveTimeout = conn.keepAliveTimeout;
+			return (out);
+		}
 		RawResponse raw_resp = resp.toRaw();
-		std::string http_response = HTTPSerializer::serializeResponse(raw_resp);
-		return (http_response);
+		if (_fromCache(resp, raw_resp, out))
+			return (out);
+		out.head = HTTPSerializer::serializeHead(raw_resp);
+		out.body.swap(raw_resp.body);
+		out.fileFd = raw_resp.bodyFd;
+		out.fileLength = raw_resp.bodyLength;
+		out.fileRanges.swap(raw_resp.bodyRanges);
 	}
 	catch (const RequestE &e) {
-		RawResponse error = HTTPSerializer::createErrorResponse(400, "Bad Request");
-		return HTTPSerializer::serializeResponse(error);
+		conn.keepAlive = false;
+		out.head = buildErrorResponse(400, "Bad Request");
+	}
+	catch (const std::exception &e) {
+		conn.keepAlive = false;
+		out.head = buildErrorResponse(500, "Internal Server Error");
+	}
+	return (out);
+}
+
+BodyPolicy	HTTPServerEngine::bodyPolicy(const RawRequest &raw, int port) {
+	return (_handler->bodyPolicy(raw, port));
+}
+
+bool	HTTPServerEngine::clientTimeouts(const RawRequest &raw, int port, ClientTimeouts &out) {
+	return (_handler->clientTimeouts(raw, port, out));
+}
+
+// Request abandoned by the parser (malformed, or body over max_body_size):
+// answered with the virtual host's error page, then the connection closes
+HTTPOutput	HTTPServerEngine::rejectRequest(const RawRequest &raw, int port, int code,
+                                            const std::string &message) {
+	HTTPOutput	out;
+	Response	resp = _handler->rejectRequest(raw, port, code, message);
+	RawResponse	raw_resp = resp.toRaw();
+	if (_fromCache(resp, raw_resp, out))
+		return (out);
+	out.head = HTTPSerializer::serializeHead(raw_resp);
+	out.body.swap(raw_resp.body);
+	return (out);
+}
+
+HTTPOutput	HTTPServerEngine::finishCGI(CGIJob &job) {
+	HTTPOutput	out;
+	try {
+		Response resp = _handler->finishCGI(job);
+		RawResponse raw_resp = resp.toRaw();
+		if (_fromCache(resp, raw_resp, out))
+			return (out);
+		out.head = HTTPSerializer::serializeHead(raw_resp);
+		out.body.swap(raw_resp.body);
+	}
+	catch (const std::exception &e) {
+		job.keepAlive = false;
+		out.head = buildErrorResponse(500, "Internal Server Error");
+	}
+	return (out);
+}
+
+// Head of a streamed CGI response: the body follows through the event loop
+HTTPOutput	HTTPServerEngine::startCGIStream(CGIJob &job, size_t headerEnd, size_t bodyStart) {
+	HTTPOutput	out;
+	try {
+		Response resp = _handler->startCGIStream(job, headerEnd, bodyStart);
+		out.head = HTTPSerializer::serializeHead(resp.toRaw());
 	}
 	catch (const std::exception &e) {
-		RawResponse error = HTTPSerializer::createErrorResponse(500, "Internal Server Error");
-		return HTTPSerializer::serializeResponse(error);
+		job.keepAlive = false;
+		job.chunked = false;
+		job.contentLength = 0;
+		out.head = buildErrorResponse(500, "Internal Server Error");
 	}
+	return (out);
+}
+
+// Cached response: only the per-request headers (Connection...) are built here
+bool	HTTPServerEngine::_fromCache(const Response &resp, const RawResponse &raw,
+                                     HTTPOutput &out) {
+	if (!resp.getCached())
+		return (false);
+	out.head = HTTPSerializer::serializeTail(raw);
+	out.shared = resp.getCached()->retain();
+	return (true);
+}
+
+std::string	HTTPServerEngine::buildErrorResponse(int code, const std::string &message) {
+	RawResponse error = HTTPSerializer::createErrorResponse(code, message);
+	error.headers["Connection"] = "close";
+	return HTTPSerializer::serializeResponse(error);
 }
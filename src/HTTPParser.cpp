@@ -40,53 +40,38 @@ std::string	HTTPParser::_split(const std::string &str, char delimiter, size_t &p
 }
 
 /*	============================================================================
-		CHUNKED BODY DECODING (RFC 7230 §4.1)
+		CHUNK SIZE LINE (RFC 7230 §4.1: 1*HEXDIG [ chunk-ext ])
 	============================================================================ */
 
-std::string	HTTPParser::_unchunkBody(const std::string &chunked) {
-	std::string	result;
-	size_t		pos = 0;
-
-	while (pos < chunked.length()) {
-		size_t	line_end = chunked.find("\r\n", pos);
-		if (line_end == std::string::npos)
-			break;
-		std::string	size_str = chunked.substr(pos, line_end - pos);
-		size_t		ext_pos = size_str.find(';');
-		if (ext_pos != std::string::npos)
-			size_str = size_str.substr(0, ext_pos);
-		size_str = _trim(size_str);
-		if (size_str.empty())
-			break;
-		size_t	chunk_size = 0;
-		for (size_t i = 0; i < size_str.length(); i++) {
-			char	c = size_str[i];
-			chunk_size *= 16;
-			if (c >= '0' && c <= '9')
-				chunk_size += (size_t)(c - '0');
-			else if (c >= 'a' && c <= 'f')
-				chunk_size += (size_t)(c - 'a' + 10);
-			else if (c >= 'A' && c <= 'F')
-				chunk_size += (size_t)(c - 'A' + 10);
-			else
-				break;
-		}
-		pos = line_end + 2;
-		if (chunk_size == 0)
-			break;
-		if (pos + chunk_size > chunked.length())
-			break;
-		result.append(chunked, pos, chunk_size);
-		pos += chunk_size + 2;
+bool	HTTPParser::parseChunkSize(const std::string &line, size_t &chunkSize) {
+	std::string	size_str = line;
+	size_t		ext_pos = size_str.find(';');
+	if (ext_pos != std::string::npos)
+		size_str = size_str.substr(0, ext_pos);
+	size_str = _trim(size_str);
+	if (size_str.empty() || size_str.length() > 15)
+		return (false);
+	chunkSize = 0;
+	for (size_t i = 0; i < size_str.length(); i++) {
+		char	c = size_str[i];
+		chunkSize *= 16;
+		if (c >= '0' && c <= '9')
+			chunkSize += (size_t)(c - '0');
+		else if (c >= 'a' && c <= 'f')
+			chunkSize += (size_t)(c - 'a' + 10);
+		else if (c >= 'A' && c <= 'F')
+			chunkSize += (size_t)(c - 'A' + 10);
+		else
+			return (false);
 	}
-	return (result);
+	return (true);
 }
 
 /*	============================================================================
 		REQUEST LINE PARSING (GET /path HTTP/1.1)
 	============================================================================ */
 
-void	HTTPParser::_parseRequestLine(const std::string &line, RawRequest &req) {
+void	HTTPParser::parseRequestLine(const std::string &line, RawRequest &req) {
 	size_t	pos = 0;
 	std::string	trimmed = _trim(line);
 	if (trimmed.empty())
@@ -104,112 +89,30 @@ void	HTTPParser::_parseRequestLine(const std::string &line, RawRequest &req) {
 }
 
 /*	============================================================================
-		HEADERS PARSING (Host: localhost\r\n...)
+		HEADER LINE PARSING (Host: localhost)
 	============================================================================ */
 
-void	HTTPParser::_parseHeaders(const std::string &headerBlock, RawRequest &req) {
-	size_t	pos = 0;
-	std::string	line;
-	std::string	key;
-	std::string	value;
-	size_t	colon_pos;
-	req.headerCount = 0;
-	while (pos < headerBlock.length()) {
-		size_t	line_end = headerBlock.find("\r\n", pos);
-		if (line_end == std::string::npos)
-			line_end = headerBlock.length();
-		line = headerBlock.substr(pos, line_end - pos);
-		pos = line_end + 2;
-		if (line.empty())
-			break ;
-		colon_pos = line.find(':');
-		if (colon_pos == std::string::npos)
-			throw RequestE("Invalid header format (missing colon): " + line);
-		key = _trim(line.substr(0, colon_pos));
-		value = _trim(line.substr(colon_pos + 1));
-		if (key.empty())
-			throw RequestE("Empty header key");
-		key = httpToLower(key);
-		req.headers[key] = value;
+void	HTTPParser::parseHeaderLine(const std::string &line, RawRequest &req) {
+	size_t	colon_pos = line.find(':');
+	if (colon_pos == std::string::npos)
+		throw RequestE("Invalid header format (missing colon): " + line);
+	std::string	key = _trim(line.substr(0, colon_pos));
+	std::string	value = _trim(line.substr(colon_pos + 1));
+	if (key.empty())
+		throw RequestE("Empty header key");
+	key = httpToLower(key);
+	std::map<std::string, std::string>::iterator	it = req.headers.find(key);
+	if (it == req.headers.end()) {
 		req.headerCount++;
+		req.headers[key] = value;
+		return ;
 	}
-}
-
-/*	============================================================================
-		PUBLIC API: FIND BODY START (\r\n\r\n separator)
-	============================================================================ */
-
-size_t	HTTPParser::findBodyStart(const std::string &rawData) {
-	size_t	pos = rawData.find("\r\n\r\n");
-	if (pos == std::string::npos)
-		return (std::string::npos);
-	return (pos + 4);
-}
-
-/*	============================================================================
-		PUBLIC API: PARSE REQUEST (main entry point)
-	============================================================================ */
-
-RawRequest	HTTPParser::parseRequest(const std::string &rawData) {
-	RawRequest	req;
-	size_t		body_start;
-	size_t		first_line_end;
-	std::string	request_line;
-	std::string	headers_block;
-	if (rawData.empty())
-		throw RequestE("Raw request data is empty");
-	first_line_end = rawData.find("\r\n");
-	if (first_line_end == std::string::npos)
-		throw RequestE("Request line not properly terminated");
-	request_line = rawData.substr(0, first_line_end);
-	_parseRequestLine(request_line, req);
-	body_start = findBodyStart(rawData);
-	if (body_start == std::string::npos) {
-		headers_block = rawData.substr(first_line_end + 2);
-		req.body = "";
-	} else {
-		headers_block = rawData.substr(first_line_end + 2, body_start - first_line_end - 6);
-		req.body = rawData.substr(body_start);
-	}
-	_parseHeaders(headers_block, req);
-	std::map<std::string, std::string>::const_iterator te_it = req.headers.find("transfer-encoding");
-	if (te_it != req.headers.end()) {
-		std::string	te_val = httpToLower(te_it->second);
-		if (te_val.find("chunked") != std::string::npos) {
-			req.body = _unchunkBody(req.body);
-			req.headers["content-length"] = httpIntToString((long)req.body.length());
-			req.headerCount++;
-		}
-	}
-	return (req);
-}
-
-/*	============================================================================
-		PUBLIC API: CHECK REQUEST COMPLETE (headers + body)
-	============================================================================ */
-
-bool	HTTPParser::isRequestComplete(const std::string &rawData,
-										const std::map<std::string, std::string> &headers) {
-	size_t	body_start;
-	long	content_length;
-	std::map<std::string, std::string>::const_iterator	it;
-	body_start = findBodyStart(rawData);
-	if (body_start == std::string::npos)
-		return (false);
-	std::map<std::string, std::string>::const_iterator te_it = headers.find("transfer-encoding");
-	if (te_it != headers.end()) {
-		std::string	te_val = httpToLower(te_it->second);
-		if (te_val.find("chunked") != std::string::npos) {
-			std::string	body_part = rawData.substr(body_start);
-			return (body_part.find("0\r\n\r\n") != std::string::npos);
-		}
-	}
-	it = headers.find("content-length");
-	if (it == headers.end())
-		return (true);
-	content_length = atol(it->second.c_str());
-	if (content_length < 0)
-		return (false);
-	size_t	body_size = rawData.length() - body_start;
-	return (body_size >= (size_t)content_length);
+	// RFC 9112 §6.3 : two lengths leave the framing ambiguous (smuggling)
+	if (key == "content-length")
+		throw RequestE("Duplicate Content-Length");
+	// RFC 9110 §5.3 : repeated list fields combine, the last coding stays last
+	if (key == "transfer-encoding")
+		it->second += ", " + value;
+	else
+		it->second = value;
 }
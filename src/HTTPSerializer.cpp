@@ -41,10 +41,13 @@ std::string	HTTPSerializer::_buildHeadersBlock(const RawResponse &response) {
 		headers_block += it->second;
 		headers_block += "\r\n";
 	}
-	if (!response.body.empty()
+	if ((!response.body.empty() || response.bodyFd >= 0)
 	    && response.headers.find("Content-Length") == response.headers.end()) {
 		headers_block += "Content-Length: ";
-		headers_block += httpIntToString(response.body.length());
+		if (response.bodyFd >= 0)
+			headers_block += httpIntToString(response.bodyLength);
+		else
+			headers_block += httpIntToString(response.body.length());
 		headers_block += "\r\n";
 	}
 	return (headers_block);
@@ -52,8 +55,24 @@ std::string	HTTPSerializer::_buildHeadersBlock(const RawResponse &response) {
 
 /*	============================================================================
 		PUBLIC API: Serialize response to HTTP text
+		serializeHead() stops after the blank line: file bodies (bodyFd)
+		are streamed by the event loop instead of being copied here.
+		serializeTail() only emits the headers and the blank line: it
+		completes a pre-serialized head shared through the ContentCache.
 	============================================================================ */
 
+std::string	HTTPSerializer::serializeHead(const RawResponse &response) {
+	std::string	http_head;
+	http_head += _buildStatusLine(response);
+	http_head += _buildHeadersBlock(response);
+	http_head += "\r\n";
+	return (http_head);
+}
+
+std::string	HTTPSerializer::serializeTail(const RawResponse &response) {
+	return (_buildHeadersBlock(response) + "\r\n");
+}
+
 std::string	HTTPSerializer::serializeResponse(const RawResponse &response) {
 	std::string	http_response;
 	http_response += _buildStatusLine(response);
@@ -94,6 +113,5 @@ RawResponse	HTTPSerializer::createErrorResponse(int code, const std::string &mes
 	html_body += "</html>\r\n";
 	response.body = html_body;
 	response.headers["Content-Type"] = "text/html";
-	response.headers["Connection"] = "close";
 	return (response);
 }
@@ -0,0 +1,123 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationRouter.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 16:05:12 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 16:05:12 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/LocationRouter.hpp"
+
+LocationRouter::Node::Node(const std::string &fragment)
+	: edge(fragment), prefix(-1), exact(-1) {}
+
+LocationRouter::LocationRouter() : _nodes(1, Node("")) {}
+
+LocationRouter::~LocationRouter() {}
+
+/*	============================================================================
+	CHILDREN (kept sorted by first character of their edge)
+	============================================================================ */
+
+long	LocationRouter::_child(size_t node, char c) const {
+	const std::vector<std::pair<char, size_t> >	&children = _nodes[node].children;
+	size_t										lo = 0;
+	size_t										hi = children.size();
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (children[mid].first == c)
+			return ((long)children[mid].second);
+		if (children[mid].first < c)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (-1);
+}
+
+void	LocationRouter::_setChild(size_t node, char c, size_t child) {
+	std::vector<std::pair<char, size_t> >	&children = _nodes[node].children;
+	size_t									i = 0;
+
+	while (i < children.size() && children[i].first < c)
+		i++;
+	if (i < children.size() && children[i].first == c)
+		children[i].second = child;
+	else
+		children.insert(children.begin() + i, std::make_pair(c, child));
+}
+
+/*	============================================================================
+	INSERT: follow matching edges, splitting one when the path diverges
+	in its middle
+	============================================================================ */
+
+// The first location inserted for a path wins (declaration order)
+void	LocationRouter::insert(const std::string &path, bool exact, int location) {
+	size_t				node = 0;
+	size_t				pos = 0;
+
+	while (pos < path.length()) {
+		long	child = _child(node, path[pos]);
+		if (child < 0) {
+			_nodes.push_back(Node(path.substr(pos)));
+			_setChild(node, path[pos], _nodes.size() - 1);
+			node = _nodes.size() - 1;
+			pos = path.length();
+			break ;
+		}
+		std::string	edge = _nodes[child].edge;
+		size_t		common = 0;
+		while (common < edge.length() && pos + common < path.length()
+		       && edge[common] == path[pos + common])
+			common++;
+		if (common < edge.length()) {
+			_nodes.push_back(Node(edge.substr(0, common)));
+			size_t	split = _nodes.size() - 1;
+			_nodes[child].edge = edge.substr(common);
+			_setChild(split, edge[common], (size_t)child);
+			_setChild(node, path[pos], split);
+			child = (long)split;
+		}
+		node = (size_t)child;
+		pos += common;
+	}
+	int	&slot = exact ? _nodes[node].exact : _nodes[node].prefix;
+	if (slot < 0)
+		slot = location;
+}
+
+/*	============================================================================
+	LOOKUP: longest prefix seen along the walk, unless an exact location
+	ends precisely where the path does
+	============================================================================ */
+
+int	LocationRouter::lookup(const std::string &uri) const {
+	size_t	end = uri.find('?');
+	size_t	node = 0;
+	size_t	pos = 0;
+	int		best = _nodes[0].prefix;
+
+	if (end == std::string::npos)
+		end = uri.length();
+	while (pos < end) {
+		long	child = _child(node, uri[pos]);
+		if (child < 0)
+			return (best);
+		const std::string	&edge = _nodes[child].edge;
+		if (end - pos < edge.length() || uri.compare(pos, edge.length(), edge) != 0)
+			return (best);
+		pos += edge.length();
+		node = (size_t)child;
+		if (_nodes[node].prefix >= 0)
+			best = _nodes[node].prefix;
+	}
+	if (_nodes[node].exact >= 0)
+		return (_nodes[node].exact);
+	return (best);
+}
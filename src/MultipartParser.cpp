@@ -0,0 +1,315 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MultipartParser.cpp                                :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 10:02:17 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 10:02:17 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/MultipartParser.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*	============================================================================
+		CONSTRUCTOR / RESET
+	============================================================================ */
+
+MultipartParser::MultipartParser() : _state(MP_PREAMBLE), _active(false), _fd(-1),
+	_errorStatus(400) {}
+
+MultipartParser::~MultipartParser() {
+	reset();
+}
+
+// Temp files still listed here were not claimed by the request handler
+void	MultipartParser::reset() {
+	_closePart();
+	for (size_t i = 0; i < _parts.size(); i++) {
+		if (!_parts[i].path.empty())
+			unlink(_parts[i].path.c_str());
+	}
+	_parts.clear();
+	_buffer.clear();
+	_delimiter.clear();
+	_directory.clear();
+	_error.clear();
+	_errorStatus = 400;
+	_state = MP_PREAMBLE;
+	_active = false;
+}
+
+/*	============================================================================
+		ACCESSORS
+	============================================================================ */
+
+bool	MultipartParser::isActive() const { return (_active); }
+const std::vector<UploadPart>&	MultipartParser::getParts() const { return (_parts); }
+const std::string&	MultipartParser::getError() const { return (_error); }
+int		MultipartParser::getErrorStatus() const { return (_errorStatus); }
+
+bool	MultipartParser::_fail(const std::string &msg, int status) {
+	_closePart();
+	_state = MP_ERROR;
+	_error = msg;
+	_errorStatus = status;
+	return (false);
+}
+
+/*	============================================================================
+		BOUNDARY
+	============================================================================ */
+
+// "multipart/form-data; boundary=xyz" (possibly quoted), "" if not multipart
+std::string	MultipartParser::boundaryOf(const std::string &contentType) {
+	std::string	lower = httpToLower(contentType);
+
+	if (lower.compare(0, 19, "multipart/form-data") != 0)
+		return ("");
+	size_t	pos = lower.find("boundary=");
+	if (pos == std::string::npos)
+		return ("");
+	std::string	boundary = contentType.substr(pos + 9);
+	if (!boundary.empty() && boundary[0] == '"')
+		boundary = boundary.substr(1, boundary.find('"', 1) - 1);
+	else
+		boundary = boundary.substr(0, boundary.find_first_of("; \t"));
+	if (boundary.length() > MULTIPART_MAX_BOUNDARY)
+		return ("");
+	return (boundary);
+}
+
+// The body is scanned as if it started with a CRLF, so the first
+// "--boundary" matches the same delimiter as all the following ones
+void	MultipartParser::start(const std::string &boundary, const std::string &directory) {
+	reset();
+	_active = true;
+	_directory = directory.empty() ? "/tmp" : directory;
+	_delimiter = "\r\n--" + boundary;
+	_buffer = "\r\n";
+	size_t	m = _delimiter.length();
+	for (size_t i = 0; i < 256; i++)
+		_skip[i] = m;
+	for (size_t i = 0; i + 1 < m; i++)
+		_skip[(unsigned char)_delimiter[i]] = m - 1 - i;
+}
+
+/*	============================================================================
+		BOYER-MOORE-HORSPOOL
+		Compares from the end of the pattern and shifts by the table entry
+		of the window's last byte: most of a part's content is skipped
+		delimiter-length bytes at a time.
+	============================================================================ */
+
+size_t	MultipartParser::_search(const char *data, size_t len) const {
+	size_t		m = _delimiter.length();
+	const char	*pattern = _delimiter.data();
+
+	if (len < m)
+		return (std::string::npos);
+	for (size_t i = 0; i <= len - m; i += _skip[(unsigned char)data[i + m - 1]]) {
+		size_t	j = m - 1;
+		while (data[i + j] == pattern[j]) {
+			if (j == 0)
+				return (i);
+			j--;
+		}
+	}
+	return (std::string::npos);
+}
+
+/*	============================================================================
+		PUBLIC API: FEED / FINISH
+	============================================================================ */
+
+bool	MultipartParser::feed(const char *data, size_t len) {
+	if (_state == MP_ERROR)
+		return (false);
+	if (_state == MP_EPILOGUE)
+		return (true);
+	_buffer.append(data, len);
+	while (true) {
+		bool	progress;
+		if (_state == MP_PREAMBLE || _state == MP_BODY)
+			progress = _scan();
+		else if (_state == MP_DELIMITER)
+			progress = _readDelimiter();
+		else if (_state == MP_HEADERS)
+			progress = _readHeaders();
+		else {
+			_buffer.clear();
+			progress = false;
+		}
+		if (_state == MP_ERROR)
+			return (false);
+		if (!progress)
+			return (true);
+	}
+}
+
+bool	MultipartParser::finish() {
+	if (_state == MP_ERROR)
+		return (false);
+	if (_state != MP_EPILOGUE)
+		return (_fail("Truncated multipart body"));
+	return (true);
+}
+
+/*	============================================================================
+		STATES
+		Each step returns true when it moved to another state, false when
+		it needs more bytes (or failed).
+	============================================================================ */
+
+// Preamble or part content up to the next delimiter; a tail that could
+// still be the start of a delimiter stays in the buffer
+bool	MultipartParser::_scan() {
+	size_t	at = _search(_buffer.data(), _buffer.length());
+
+	if (at == std::string::npos) {
+		size_t	keep = _delimiter.length() - 1;
+		size_t	emit = _buffer.length() > keep ? _buffer.length() - keep : 0;
+		if (_state == MP_BODY && !_write(_buffer.data(), emit))
+			return (false);
+		_buffer.erase(0, emit);
+		return (false);
+	}
+	if (_state == MP_BODY) {
+		if (!_write(_buffer.data(), at))
+			return (false);
+		_closePart();
+	}
+	_buffer.erase(0, at + _delimiter.length());
+	_state = MP_DELIMITER;
+	return (true);
+}
+
+// After a delimiter: "--" closes the body, otherwise optional padding
+// then CRLF opens the next part
+bool	MultipartParser::_readDelimiter() {
+	if (_buffer.length() < 2)
+		return (false);
+	if (_buffer.compare(0, 2, "--") == 0) {
+		_buffer.clear();
+		_state = MP_EPILOGUE;
+		return (true);
+	}
+	size_t	eol = _buffer.find("\r\n");
+	if (eol == std::string::npos)
+		return (_buffer.length() > 256 ? _fail("Malformed multipart delimiter") : false);
+	if (_buffer.find_first_not_of(" \t") < eol)
+		return (_fail("Malformed multipart delimiter"));
+	_buffer.erase(0, eol + 2);
+	_state = MP_HEADERS;
+	return (true);
+}
+
+bool	MultipartParser::_readHeaders() {
+	size_t	end;
+
+	if (_buffer.compare(0, 2, "\r\n") == 0)
+		end = 0;
+	else if ((end = _buffer.find("\r\n\r\n")) == std::string::npos)
+		return (_buffer.length() > MULTIPART_MAX_HEADERS
+		        ? _fail("Multipart part headers too large") : false);
+	else
+		end += 2;
+	if (!_openPart(_buffer.substr(0, end)))
+		return (false);
+	_buffer.erase(0, end + 2);
+	_state = MP_BODY;
+	return (true);
+}
+
+/*	============================================================================
+		PARTS
+	============================================================================ */
+
+// Parameter of a Content-Disposition value, quoted-string or token
+static std::string	dispositionParam(const std::string &value, const std::string &key) {
+	size_t	pos = 0;
+
+	while ((pos = value.find(';', pos)) != std::string::npos) {
+		pos = value.find_first_not_of(" \t", pos + 1);
+		if (pos == std::string::npos)
+			break ;
+		size_t	eq = value.find('=', pos);
+		if (eq == std::string::npos)
+			break ;
+		std::string	name = httpToLower(value.substr(pos, eq - pos));
+		std::string	param;
+		pos = eq + 1;
+		if (pos < value.length() && value[pos] == '"') {
+			for (pos++; pos < value.length() && value[pos] != '"'; pos++) {
+				if (value[pos] == '\\' && pos + 1 < value.length())
+					pos++;
+				param += value[pos];
+			}
+		}
+		else {
+			size_t	stop = value.find(';', pos);
+			param = value.substr(pos, stop == std::string::npos ? std::string::npos : stop - pos);
+			pos = stop == std::string::npos ? value.length() : stop;
+		}
+		if (name == key)
+			return (param);
+	}
+	return ("");
+}
+
+// Plain form fields are skipped: only file parts are stored
+bool	MultipartParser::_openPart(const std::string &headers) {
+	UploadPart	part;
+	size_t		pos = 0;
+
+	while (pos < headers.length()) {
+		size_t		eol = headers.find("\r\n", pos);
+		std::string	line = headers.substr(pos, eol - pos);
+		pos = (eol == std::string::npos) ? headers.length() : eol + 2;
+		size_t		colon = line.find(':');
+		if (colon == std::string::npos)
+			return (_fail("Invalid multipart header: " + line));
+		if (httpToLower(line.substr(0, colon)) != "content-disposition")
+			continue ;
+		std::string	value = line.substr(colon + 1);
+		part.name = dispositionParam(value, "name");
+		part.filename = dispositionParam(value, "filename");
+	}
+	if (!part.filename.empty()) {
+		std::string	path = _directory;
+		if (path[path.length() - 1] != '/')
+			path += '/';
+		path += ".webserv-part-XXXXXX";
+		std::vector<char>	name(path.begin(), path.end());
+		name.push_back('\0');
+		_fd = mkstemp(&name[0]);
+		if (_fd < 0)
+			return (_fail("Cannot create upload file", 500));
+		fcntl(_fd, F_SETFD, FD_CLOEXEC);
+		fchmod(_fd, 0644);
+		part.path = &name[0];
+	}
+	_parts.push_back(part);
+	return (true);
+}
+
+bool	MultipartParser::_write(const char *data, size_t len) {
+	while (_fd >= 0 && len > 0) {
+		ssize_t	written = write(_fd, data, len);
+		if (written <= 0)
+			return (_fail("Cannot write upload file", 500));
+		data += written;
+		len -= (size_t)written;
+	}
+	return (true);
+}
+
+void	MultipartParser::_closePart() {
+	if (_fd >= 0)
+		close(_fd);
+	_fd = -1;
+}
@@ -0,0 +1,161 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OpenFileCache.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 17:58:41 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 17:58:41 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/OpenFileCache.hpp"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+OpenFileCache::EntryList	OpenFileCache::_lru;
+OpenFileCache::EntryIndex	OpenFileCache::_index;
+size_t						OpenFileCache::_max = 0;
+int							OpenFileCache::_valid = 60;
+
+/*	============================================================================
+		FILESYSTEM ACCESS
+	============================================================================ */
+
+FileInfo	OpenFileCache::_stat(const std::string &path) {
+	struct stat	st;
+	FileInfo	info;
+
+	info.type = FILE_MISSING;
+	info.size = -1;
+	info.mtime = 0;
+	info.inode = 0;
+	info.device = 0;
+	if (stat(path.c_str(), &st) != 0)
+		return (info);
+	if (S_ISREG(st.st_mode))
+		info.type = FILE_REGULAR;
+	else if (S_ISDIR(st.st_mode))
+		info.type = FILE_DIRECTORY;
+	else
+		info.type = FILE_OTHER;
+	info.size = (long)st.st_size;
+	info.mtime = st.st_mtime;
+	info.inode = st.st_ino;
+	info.device = st.st_dev;
+	return (info);
+}
+
+static bool	sameFile(const FileInfo &a, const FileInfo &b) {
+	return (a.type == b.type && a.size == b.size && a.mtime == b.mtime
+	        && a.inode == b.inode && a.device == b.device);
+}
+
+/*	============================================================================
+		LRU
+	============================================================================ */
+
+void	OpenFileCache::_drop(EntryList::iterator it) {
+	if (it->fd >= 0)
+		close(it->fd);
+	_index.erase(it->path);
+	_lru.erase(it);
+}
+
+// Fresh entry for path, moved to the front; expired ones are re-stat'ed
+OpenFileCache::Entry&	OpenFileCache::_entry(const std::string &path) {
+	time_t					now = time(NULL);
+	EntryIndex::iterator	found = _index.find(path);
+
+	if (found != _index.end()) {
+		EntryList::iterator	it = found->second;
+		if (it != _lru.begin())
+			_lru.splice(_lru.begin(), _lru, it);
+		if (now - it->checked >= _valid) {
+			FileInfo	info = _stat(path);
+			if (!sameFile(info, it->info) && it->fd >= 0) {
+				close(it->fd);
+				it->fd = -1;
+			}
+			it->info = info;
+			it->checked = now;
+		}
+		return (*it);
+	}
+	if (_lru.size() >= _max)
+		_drop(--_lru.end());
+	Entry	entry;
+	entry.path = path;
+	entry.info = _stat(path);
+	entry.fd = -1;
+	entry.checked = now;
+	_lru.push_front(entry);
+	_index[path] = _lru.begin();
+	return (_lru.front());
+}
+
+/*	============================================================================
+		PUBLIC API
+	============================================================================ */
+
+void	OpenFileCache::configure(size_t maxEntries, int validSeconds) {
+	clear();
+	_max = maxEntries;
+	_valid = validSeconds;
+}
+
+FileInfo	OpenFileCache::lookup(const std::string &path) {
+	if (_max == 0)
+		return (_stat(path));
+	return (_entry(path).info);
+}
+
+// Returns a descriptor owned by the caller, or -1 if path is not a regular file
+int	OpenFileCache::open(const std::string &path, long &size) {
+	if (_max == 0) {
+		int	fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return (-1);
+		struct stat	st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			close(fd);
+			return (-1);
+		}
+		size = (long)st.st_size;
+		return (fd);
+	}
+	Entry	&entry = _entry(path);
+	if (entry.info.type != FILE_REGULAR)
+		return (-1);
+	if (entry.fd < 0) {
+		entry.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (entry.fd < 0)
+			return (-1);
+		// The file may have been replaced between stat() and open()
+		struct stat	st;
+		if (fstat(entry.fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			invalidate(path);
+			return (-1);
+		}
+		entry.info.size = (long)st.st_size;
+		entry.info.mtime = st.st_mtime;
+		entry.info.inode = st.st_ino;
+		entry.info.device = st.st_dev;
+	}
+	size = entry.info.size;
+	return (fcntl(entry.fd, F_DUPFD_CLOEXEC, 0));
+}
+
+void	OpenFileCache::invalidate(const std::string &path) {
+	EntryIndex::iterator	found = _index.find(path);
+
+	if (found != _index.end())
+		_drop(found->second);
+}
+
+void	OpenFileCache::clear() {
+	while (!_lru.empty())
+		_drop(_lru.begin());
+}
@@ -0,0 +1,232 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutputQueue.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 11:20:03 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 11:20:03 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/OutputQueue.hpp"
+#include <unistd.h>
+#include <sys/socket.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
+
+#define OUTPUT_MAX_IOV		64
+#define SENDFILE_SLICE		1048576
+
+/*	============================================================================
+	SHARED BUFFER
+	============================================================================ */
+
+SharedBuffer::SharedBuffer() : _split(0), _refs(1) {}
+SharedBuffer::~SharedBuffer() {}
+
+// Prend possession du contenu de data (vidé), une référence pour l'appelant
+SharedBuffer	*SharedBuffer::adopt(std::string &data, size_t split) {
+	SharedBuffer	*buffer = new SharedBuffer();
+	buffer->_data.swap(data);
+	buffer->_split = split;
+	return (buffer);
+}
+
+SharedBuffer	*SharedBuffer::retain() {
+	_refs++;
+	return (this);
+}
+
+void	SharedBuffer::release() {
+	if (--_refs == 0)
+		delete this;
+}
+
+const std::string	&SharedBuffer::data() const {
+	return (_data);
+}
+
+size_t	SharedBuffer::split() const {
+	return (_split);
+}
+
+/*	============================================================================
+	CONSTRUCTEUR / DESTRUCTEUR
+	============================================================================ */
+
+OutputQueue::OutputQueue() : _memoryBytes(0) {}
+
+OutputQueue::~OutputQueue() {
+	clear();
+}
+
+/*	============================================================================
+	AJOUT DE SEGMENTS
+	============================================================================ */
+
+void	OutputQueue::append(const std::string &data) {
+	std::string	copy(data);
+	appendSwap(copy);
+}
+
+// Prend possession du contenu de data sans le recopier (data est vidé)
+void	OutputQueue::appendSwap(std::string &data) {
+	if (data.empty())
+		return ;
+	_segments.push_back(Segment());
+	Segment	&seg = _segments.back();
+	seg.type = SEGMENT_MEMORY;
+	seg.data.swap(data);
+	seg.shared = NULL;
+	seg.end = 0;
+	seg.consumed = 0;
+	seg.fd = -1;
+	seg.fileOffset = 0;
+	seg.remaining = 0;
+	_memoryBytes += seg.data.size();
+}
+
+// La file prend sa propre référence sur le bloc, rendue une fois envoyé
+void	OutputQueue::appendShared(SharedBuffer *buffer, size_t start, size_t end) {
+	if (start >= end)
+		return ;
+	_segments.push_back(Segment());
+	Segment	&seg = _segments.back();
+	seg.type = SEGMENT_SHARED;
+	seg.shared = buffer->retain();
+	seg.end = end;
+	seg.consumed = start;
+	seg.fd = -1;
+	seg.fileOffset = 0;
+	seg.remaining = 0;
+}
+
+// Le fd appartient désormais à la file : il est fermé une fois envoyé
+void	OutputQueue::appendFile(int fd, off_t offset, long length) {
+	if (fd < 0)
+		return ;
+	if (length <= 0) {
+		close(fd);
+		return ;
+	}
+	_segments.push_back(Segment());
+	Segment	&seg = _segments.back();
+	seg.type = SEGMENT_FILE;
+	seg.shared = NULL;
+	seg.end = 0;
+	seg.consumed = 0;
+	seg.fd = fd;
+	seg.fileOffset = offset;
+	seg.remaining = length;
+}
+
+void	OutputQueue::_popFront() {
+	Segment	&seg = _segments.front();
+	if (seg.type == SEGMENT_FILE && seg.fd >= 0)
+		close(seg.fd);
+	if (seg.type == SEGMENT_MEMORY)
+		_memoryBytes -= seg.data.size() - seg.consumed;
+	if (seg.type == SEGMENT_SHARED)
+		seg.shared->release();
+	_segments.pop_front();
+}
+
+void	OutputQueue::clear() {
+	while (!_segments.empty())
+		_popFront();
+	_memoryBytes = 0;
+}
+
+/*	============================================================================
+	ENVOI
+	Un seul appel système par évènement d'écriture : writev() pour les
+	segments mémoire en tête de file, sendfile() pour un segment fichier.
+	============================================================================ */
+
+const std::string	&OutputQueue::_bytes(const Segment &seg) {
+	return (seg.type == SEGMENT_SHARED ? seg.shared->data() : seg.data);
+}
+
+size_t	OutputQueue::_end(const Segment &seg) {
+	return (seg.type == SEGMENT_SHARED ? seg.end : seg.data.size());
+}
+
+ssize_t	OutputQueue::_flushMemory(int sockFd) {
+	struct iovec	iov[OUTPUT_MAX_IOV];
+	int				count = 0;
+
+	for (std::deque<Segment>::iterator it = _segments.begin();
+	     it != _segments.end() && count < OUTPUT_MAX_IOV
+	     && it->type != SEGMENT_FILE; ++it) {
+		const std::string	&bytes = _bytes(*it);
+		iov[count].iov_base = const_cast<char *>(bytes.data()) + it->consumed;
+		iov[count].iov_len = _end(*it) - it->consumed;
+		count++;
+	}
+	ssize_t	sent = writev(sockFd, iov, count);
+	if (sent <= 0)
+		return (sent);
+	size_t	left = (size_t)sent;
+	while (left > 0) {
+		Segment	&seg = _segments.front();
+		size_t	avail = _end(seg) - seg.consumed;
+		if (left < avail) {
+			seg.consumed += left;
+			if (seg.type == SEGMENT_MEMORY)
+				_memoryBytes -= left;
+			break ;
+		}
+		left -= avail;
+		_popFront();
+	}
+	return (sent);
+}
+
+ssize_t	OutputQueue::_flushFile(int sockFd, Segment &seg) {
+	size_t	len = seg.remaining < SENDFILE_SLICE ? (size_t)seg.remaining : SENDFILE_SLICE;
+#ifdef __linux__
+	ssize_t	sent = sendfile(sockFd, seg.fd, &seg.fileOffset, len);
+#else
+	char	buf[65536];
+	if (len > sizeof(buf))
+		len = sizeof(buf);
+	ssize_t	got = pread(seg.fd, buf, len, seg.fileOffset);
+	if (got <= 0)
+		return (-1);
+	ssize_t	sent = send(sockFd, buf, (size_t)got, 0);
+	if (sent > 0)
+		seg.fileOffset += sent;
+#endif
+	// 0 octet : fichier tronqué depuis l'ouverture, la réponse est fausse
+	if (sent == 0)
+		return (-1);
+	if (sent > 0) {
+		seg.remaining -= sent;
+		if (seg.remaining <= 0)
+			_popFront();
+	}
+	return (sent);
+}
+
+ssize_t	OutputQueue::flush(int sockFd) {
+	if (_segments.empty())
+		return (0);
+	if (_segments.front().type == SEGMENT_FILE)
+		return (_flushFile(sockFd, _segments.front()));
+	return (_flushMemory(sockFd));
+}
+
+/*	============================================================================
+	ETAT
+	============================================================================ */
+
+bool	OutputQueue::empty() const {
+	return (_segments.empty());
+}
+
+size_t	OutputQueue::memoryBytes() const {
+	return (_memoryBytes);
+}
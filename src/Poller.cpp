@@ -0,0 +1,224 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Poller.cpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 09:12:41 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 09:12:41 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Poller.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+/*	============================================================================
+	FABRIQUE
+	============================================================================ */
+
+APoller::~APoller() {}
+
+bool	APoller::isSupported(const std::string &backend) {
+#ifdef __linux__
+	if (backend == "epoll")
+		return (true);
+#endif
+	return (backend == "select");
+}
+
+APoller*	APoller::create(const std::string &backend) {
+#ifdef __linux__
+	if (backend.empty() || backend == "epoll")
+		return (new EpollPoller());
+#else
+	if (backend.empty())
+		return (new SelectPoller());
+#endif
+	if (backend == "select")
+		return (new SelectPoller());
+	throw pollerException("Unsupported event backend: " + backend);
+}
+
+/*	============================================================================
+	SELECT
+	============================================================================ */
+
+SelectPoller::SelectPoller() {
+	FD_ZERO(&_readSet);
+	FD_ZERO(&_writeSet);
+}
+
+SelectPoller::~SelectPoller() {}
+
+bool	SelectPoller::add(int fd, int events) {
+	if (fd < 0 || fd >= FD_SETSIZE)
+		return (false);
+	_interest[fd] = 0;
+	return (modify(fd, events));
+}
+
+bool	SelectPoller::modify(int fd, int events) {
+	std::map<int, int>::iterator it = _interest.find(fd);
+	if (it == _interest.end())
+		return (false);
+	FD_CLR(fd, &_readSet);
+	FD_CLR(fd, &_writeSet);
+	// select ne distingue pas la fermeture : lecture surveillée, à sonder
+	if (events & (POLLER_READ | POLLER_HANGUP))
+		FD_SET(fd, &_readSet);
+	if (events & POLLER_WRITE)
+		FD_SET(fd, &_writeSet);
+	it->second = events;
+	return (true);
+}
+
+void	SelectPoller::remove(int fd) {
+	std::map<int, int>::iterator it = _interest.find(fd);
+	if (it == _interest.end())
+		return ;
+	FD_CLR(fd, &_readSet);
+	FD_CLR(fd, &_writeSet);
+	_interest.erase(it);
+}
+
+int	SelectPoller::wait(std::vector<PollEvent> &events, int timeoutMs) {
+	fd_set			readFds = _readSet;
+	fd_set			writeFds = _writeSet;
+	struct timeval	tv;
+	struct timeval*	tvp = NULL;
+	int				maxFd = _interest.empty() ? -1 : _interest.rbegin()->first;
+
+	events.clear();
+	if (timeoutMs >= 0) {
+		tv.tv_sec = timeoutMs / 1000;
+		tv.tv_usec = (timeoutMs % 1000) * 1000;
+		tvp = &tv;
+	}
+	int ret = select(maxFd + 1, &readFds, &writeFds, NULL, tvp);
+	if (ret <= 0)
+		return (ret);
+	for (std::map<int, int>::iterator it = _interest.begin();
+	     it != _interest.end() && (int)events.size() < ret; ++it) {
+		PollEvent ev;
+		ev.fd = it->first;
+		ev.events = 0;
+		if (FD_ISSET(ev.fd, &readFds))
+			ev.events |= POLLER_READ;
+		if (FD_ISSET(ev.fd, &writeFds))
+			ev.events |= POLLER_WRITE;
+		if (ev.events)
+			events.push_back(ev);
+	}
+	return ((int)events.size());
+}
+
+const char*	SelectPoller::name() const {
+	return ("select");
+}
+
+/*	============================================================================
+	EPOLL (Linux)
+	Level-triggered : meme semantique que select(), un fd non vide reste pret
+	============================================================================ */
+
+#ifdef __linux__
+
+static uint32_t	toEpollMask(int events) {
+	uint32_t	mask = 0;
+	if (events & POLLER_READ)
+		mask |= EPOLLIN | EPOLLRDHUP;
+	if (events & POLLER_WRITE)
+		mask |= EPOLLOUT;
+	if (events & POLLER_HANGUP)
+		mask |= EPOLLRDHUP;
+#ifdef EPOLLEXCLUSIVE
+	// EPOLLEXCLUSIVE refuse EPOLLRDHUP (EINVAL) : inutile sur un listener
+	if (events & POLLER_EXCLUSIVE)
+		mask = (mask & ~EPOLLRDHUP) | EPOLLEXCLUSIVE;
+#endif
+	return (mask);
+}
+
+EpollPoller::EpollPoller() : _epfd(-1), _registered(0), _ready(64) {
+	_epfd = epoll_create(1024);
+	if (_epfd < 0)
+		throw pollerException("epoll_create failed");
+	fcntl(_epfd, F_SETFD, FD_CLOEXEC);
+}
+
+EpollPoller::~EpollPoller() {
+	if (_epfd >= 0)
+		close(_epfd);
+}
+
+bool	EpollPoller::add(int fd, int events) {
+	struct epoll_event	ev;
+	ev.events = toEpollMask(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		return (false);
+	_registered++;
+	return (true);
+}
+
+bool	EpollPoller::modify(int fd, int events) {
+	struct epoll_event	ev;
+	ev.events = toEpollMask(events);
+	ev.data.fd = fd;
+	return (epoll_ctl(_epfd, EPOLL_CTL_MOD, fd, &ev) == 0);
+}
+
+void	EpollPoller::remove(int fd) {
+	struct epoll_event	ev;
+	if (epoll_ctl(_epfd, EPOLL_CTL_DEL, fd, &ev) == 0 && _registered > 0)
+		_registered--;
+}
+
+int	EpollPoller::wait(std::vector<PollEvent> &events, int timeoutMs) {
+	events.clear();
+	if (_ready.size() < _registered && _ready.size() < 4096)
+		_ready.resize(_registered < 4096 ? _registered : 4096);
+	int ret = epoll_wait(_epfd, &_ready[0], (int)_ready.size(), timeoutMs);
+	if (ret <= 0)
+		return (ret);
+	for (int i = 0; i < ret; i++) {
+		PollEvent ev;
+		ev.fd = _ready[i].data.fd;
+		ev.events = 0;
+		if (_ready[i].events & (EPOLLIN | EPOLLRDHUP))
+			ev.events |= POLLER_READ;
+		if (_ready[i].events & EPOLLOUT)
+			ev.events |= POLLER_WRITE;
+		if (_ready[i].events & (EPOLLERR | EPOLLHUP))
+			ev.events |= POLLER_ERROR;
+		events.push_back(ev);
+	}
+	return (ret);
+}
+
+const char*	EpollPoller::name() const {
+	return ("epoll");
+}
+
+#endif
+
+/*	============================================================================
+	EXCEPTION
+	============================================================================ */
+
+APoller::pollerException::pollerException() {
+	_msg = "Poller Exception";
+}
+
+APoller::pollerException::pollerException(const std::string &msg) {
+	_msg = msg;
+}
+
+const char*	APoller::pollerException::what() const throw() {
+	return (_msg.c_str());
+}
+
+APoller::pollerException::~pollerException() throw() {}
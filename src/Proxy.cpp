@@ -0,0 +1,682 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Proxy.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 16:20:41 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 16:20:41 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Proxy.hpp"
+#include "../inc/Poller.hpp"
+#include "../inc/HTTPParser.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <zlib.h>
+
+// États du décodage de la réponse
+enum	ProxyState {
+	PX_STATUS,
+	PX_HEADERS,
+	PX_INTERIM,			// en-têtes d'une réponse 1xx, ignorés
+	PX_BODY,
+	PX_CHUNK_SIZE,
+	PX_CHUNK_DATA,
+	PX_CHUNK_END,
+	PX_TRAILERS,
+	PX_UNTIL_CLOSE,
+	PX_DONE,
+	PX_ERROR
+};
+
+/*	============================================================================
+		OUVERTURE DE LA CONNEXION
+		Adresse résolue une fois au chargement de la config ; connect() est
+		non bloquant : la première notification d'écriture dit s'il a
+		réussi, une connexion refusée fait échouer le premier envoi.
+	============================================================================ */
+
+ProxyConnection::ProxyConnection(Upstream *upstream, size_t peer)
+	: _fd(-1), _upstream(upstream), _peer(peer), _job(NULL), _reused(false),
+	  _paused(false), _sent(0), _chunkPos(0), _state(PX_STATUS), _remaining(0),
+	  _headerBytes(0), _chunked(false), _responded(false), _keepAlive(false) {
+}
+
+ProxyConnection::~ProxyConnection() {
+	detach();
+	if (_fd >= 0)
+		close(_fd);
+}
+
+bool	ProxyConnection::open() {
+	const UpstreamServer	&server = _upstream->peer(_peer).config;
+
+	_fd = socket(server.sockaddr.ss_family, SOCK_STREAM, 0);
+	if (_fd < 0)
+		return (false);
+	fcntl(_fd, F_SETFD, FD_CLOEXEC);
+	fcntl(_fd, F_SETFL, O_NONBLOCK);
+	if (connect(_fd, (const struct sockaddr *)&server.sockaddr, server.sockaddrLen) < 0
+	    && errno != EINPROGRESS) {
+		close(_fd);
+		_fd = -1;
+	}
+	return (_fd >= 0);
+}
+
+int	ProxyConnection::getFd() const {
+	return (_fd);
+}
+
+// Le fd passe à l'appelant (fermeture différée dans la boucle)
+int	ProxyConnection::releaseFd() {
+	int	fd = _fd;
+	_fd = -1;
+	return (fd);
+}
+
+Upstream	*ProxyConnection::getUpstream() const {
+	return (_upstream);
+}
+
+size_t	ProxyConnection::getPeer() const {
+	return (_peer);
+}
+
+CGIJob	*ProxyConnection::getJob() const {
+	return (_job);
+}
+
+bool	ProxyConnection::isReused() const {
+	return (_reused);
+}
+
+// Rien n'est encore revenu du backend : un autre serveur peut reprendre
+// la requête si elle n'est pas partie, ou si la rejouer est sans effet
+// (méthode idempotente, RFC 9110 §9.2.2). Un POST ou un PATCH déjà
+// envoyé n'est jamais rejoué, même sur une connexion keep-alive
+bool	ProxyConnection::retriable() const {
+	static const char	*idempotent[] = {"GET", "HEAD", "PUT", "DELETE", "OPTIONS", "TRACE", NULL};
+
+	if (_responded || !_job)
+		return (false);
+	if (_sent == 0)
+		return (true);
+	for (size_t i = 0; idempotent[i]; i++)
+		if (_job->proxyMethod == idempotent[i])
+			return (true);
+	return (false);
+}
+
+bool	ProxyConnection::reusable() const {
+	return (_state == PX_DONE && _keepAlive && _in.empty()
+	        && _job && _sent == _requestSize());
+}
+
+int	ProxyConnection::interest() const {
+	int	events = 0;
+	// Inactive : seule une fermeture du backend est attendue
+	if (!_job || !_paused)
+		events |= POLLER_READ;
+	if (_job && _sent < _requestSize())
+		events |= POLLER_WRITE;
+	return (events);
+}
+
+/*	============================================================================
+		CYCLE DE VIE D'UNE REQUÊTE
+	============================================================================ */
+
+void	ProxyConnection::submit(CGIJob *job, bool reused) {
+	_job = job;
+	_reused = reused;
+	_paused = false;
+	_sent = 0;
+	_chunk.clear();
+	_chunkPos = 0;
+	_in.clear();
+	_state = PX_STATUS;
+	_remaining = 0;
+	_headerBytes = 0;
+	_responded = false;
+	_keepAlive = true;
+	job->proxyConn = this;
+	_upstream->peer(_peer).active++;
+}
+
+void	ProxyConnection::detach() {
+	if (!_job)
+		return;
+	if (_job->proxyConn == this)
+		_job->proxyConn = NULL;
+	_job->paused = false;
+	_job = NULL;
+	_upstream->peer(_peer).active--;
+}
+
+// Backend pas de contrôle de flux propre : on arrête simplement de lire
+void	ProxyConnection::setPaused(bool paused) {
+	_paused = paused;
+	if (_job)
+		_job->paused = paused;
+}
+
+size_t	ProxyConnection::_requestSize() const {
+	return (_job->proxyRequest.size() + _job->input.size() + _job->bodySize);
+}
+
+// Corps mis sur disque : relu par morceaux de PROXY_BUFFER avec pread()
+ssize_t	ProxyConnection::_sendBody(size_t offset) {
+	if (_chunkPos >= _chunk.size()) {
+		char	buffer[PROXY_BUFFER];
+		size_t	want = _job->bodySize - offset;
+		if (want > sizeof(buffer))
+			want = sizeof(buffer);
+		ssize_t	got = pread(_job->bodyFd, buffer, want, (off_t)offset);
+		if (got <= 0)
+			return (-1);
+		_chunk.assign(buffer, got);
+		_chunkPos = 0;
+	}
+	ssize_t	sent = send(_fd, _chunk.data() + _chunkPos, _chunk.size() - _chunkPos,
+		MSG_NOSIGNAL);
+	if (sent > 0)
+		_chunkPos += (size_t)sent;
+	return (sent);
+}
+
+int	ProxyConnection::handle(int events) {
+	if (!_job)
+		return (PROXY_FAILED);
+	if ((events & POLLER_WRITE) && _sent < _requestSize()) {
+		const std::string	&head = _job->proxyRequest;
+		const std::string	&body = _job->input;
+		ssize_t				sent;
+
+		if (_sent < head.size())
+			sent = send(_fd, head.data() + _sent, head.size() - _sent, MSG_NOSIGNAL);
+		else if (_sent < head.size() + body.size())
+			sent = send(_fd, body.data() + (_sent - head.size()),
+				head.size() + body.size() - _sent, MSG_NOSIGNAL);
+		else
+			sent = _sendBody(_sent - head.size() - body.size());
+		if (sent <= 0)
+			return (PROXY_FAILED);
+		_sent += (size_t)sent;
+		_job->lastActivity = time(NULL);
+	}
+	if (!(events & (POLLER_READ | POLLER_ERROR)) || (_paused && !(events & POLLER_ERROR)))
+		return (PROXY_PENDING);
+	char	buffer[PROXY_BUFFER];
+	ssize_t	bytes = recv(_fd, buffer, sizeof(buffer), 0);
+	if (bytes < 0 || (bytes == 0 && _state != PX_UNTIL_CLOSE))
+		return (PROXY_FAILED);
+	_job->lastActivity = time(NULL);
+	if (bytes == 0) {
+		_keepAlive = false;
+		return (_finish());
+	}
+	_responded = true;
+	_in.append(buffer, bytes);
+	return (_parse());
+}
+
+/*	============================================================================
+		DÉCODAGE DE LA RÉPONSE
+		La ligne de statut et les en-têtes du backend deviennent un bloc
+		d'en-têtes CGI ("Status: ..." en tête, en-têtes hop-by-hop retirés) ;
+		le corps est décodé (chunked) et la boucle le recadre pour le client.
+	============================================================================ */
+
+bool	ProxyConnection::_takeLine(std::string &line) {
+	size_t	end = _in.find('\n');
+	if (end == std::string::npos)
+		return (false);
+	line = _in.substr(0, end);
+	if (!line.empty() && line[line.size() - 1] == '\r')
+		line.erase(line.size() - 1);
+	_in.erase(0, end + 1);
+	return (true);
+}
+
+bool	ProxyConnection::_parseStatus(const std::string &line) {
+	if (line.compare(0, 7, "HTTP/1.") != 0 || line.size() < 12 || line[8] != ' ')
+		return (false);
+	int	status = std::atoi(line.c_str() + 9);
+	if (status < 100 || status > 599)
+		return (false);
+	_keepAlive = (line[7] == '1');
+	_remaining = (size_t)-1;
+	if (status < 200) {
+		_state = PX_INTERIM;
+		return (true);
+	}
+	_chunked = false;
+	_job->result.output = "Status: " + line.substr(9) + "\r\n";
+	// Pas de corps après HEAD, 204 et 304, quels que soient les en-têtes
+	if (_job->proxyMethod == "HEAD" || status == 204 || status == 304)
+		_remaining = 0;
+	_state = PX_HEADERS;
+	return (true);
+}
+
+bool	ProxyConnection::_parseHeader(const std::string &line) {
+	size_t	colon = line.find(':');
+	if (colon == std::string::npos)
+		return (true);
+	std::string	name = httpToLower(line.substr(0, colon));
+	std::string	value = line.substr(colon + 1);
+	size_t		start = value.find_first_not_of(" \t");
+	value = (start == std::string::npos) ? "" : value.substr(start);
+	std::string	lower = httpToLower(value);
+
+	if (name == "connection") {
+		if (lower.find("close") != std::string::npos)
+			_keepAlive = false;
+		else if (lower.find("keep-alive") != std::string::npos)
+			_keepAlive = true;
+		return (true);
+	}
+	if (name == "transfer-encoding") {
+		_chunked = (lower.find("chunked") != std::string::npos);
+		return (true);
+	}
+	if (name == "content-length" && _remaining == (size_t)-1) {
+		long	length;
+		// Cadrage du corps inconnu : réponse inutilisable (502)
+		if (!httpParseContentLength(value, length))
+			return (false);
+		_remaining = (size_t)length;
+	}
+	if (name == "keep-alive" || name == "proxy-connection" || name == "te"
+	    || name == "trailer" || name == "upgrade")
+		return (true);
+	_job->result.output += line.substr(0, colon) + ": " + value + "\r\n";
+	return (true);
+}
+
+// Fin des en-têtes : le mode de lecture du corps est maintenant connu
+int	ProxyConnection::_endHeaders() {
+	_job->result.output += "\r\n";
+	if (_remaining == 0)
+		return (PX_DONE);
+	if (_chunked)
+		return (PX_CHUNK_SIZE);
+	if (_remaining == (size_t)-1) {
+		_keepAlive = false;
+		return (PX_UNTIL_CLOSE);
+	}
+	return (PX_BODY);
+}
+
+int	ProxyConnection::_parse() {
+	std::string	line;
+
+	while (_state != PX_DONE && _state != PX_ERROR) {
+		if (_state == PX_BODY || _state == PX_CHUNK_DATA || _state == PX_UNTIL_CLOSE) {
+			if (_in.empty())
+				break;
+			size_t	take = _in.size();
+			if (_state != PX_UNTIL_CLOSE && take > _remaining)
+				take = _remaining;
+			_job->result.output.append(_in, 0, take);
+			_in.erase(0, take);
+			if (_state == PX_UNTIL_CLOSE)
+				break;
+			_remaining -= take;
+			if (_remaining == 0)
+				_state = (_state == PX_BODY) ? PX_DONE : PX_CHUNK_END;
+			continue;
+		}
+		size_t	before = _in.size();
+		if (!_takeLine(line)) {
+			if (_in.size() > CGI_MAX_HEADER)
+				_state = PX_ERROR;
+			break;
+		}
+		if (_state == PX_STATUS || _state == PX_HEADERS
+		    || _state == PX_INTERIM || _state == PX_TRAILERS) {
+			_headerBytes += before - _in.size();
+			if (_headerBytes > CGI_MAX_HEADER) {
+				_state = PX_ERROR;
+				break;
+			}
+		}
+		if (_state == PX_STATUS) {
+			if (!_parseStatus(line))
+				_state = PX_ERROR;
+		}
+		else if (_state == PX_INTERIM) {
+			if (line.empty()) {
+				_state = PX_STATUS;
+				_headerBytes = 0;
+			}
+		}
+		else if (_state == PX_HEADERS) {
+			if (line.empty())
+				_state = _endHeaders();
+			else if (!_parseHeader(line))
+				_state = PX_ERROR;
+		}
+		else if (_state == PX_CHUNK_SIZE) {
+			if (!HTTPParser::parseChunkSize(line, _remaining))
+				_state = PX_ERROR;
+			else
+				_state = (_remaining == 0) ? PX_TRAILERS : PX_CHUNK_DATA;
+		}
+		else if (_state == PX_CHUNK_END)
+			_state = line.empty() ? PX_CHUNK_SIZE : PX_ERROR;
+		else if (_state == PX_TRAILERS && line.empty())
+			_state = PX_DONE;
+	}
+	if (_state == PX_ERROR)
+		return (PROXY_FAILED);
+	if (_state == PX_DONE)
+		return (_finish());
+	return (PROXY_PENDING);
+}
+
+int	ProxyConnection::_finish() {
+	_state = PX_DONE;
+	_job->exited = true;
+	_job->result.exitCode = 0;
+	_job->result.success = true;
+	_upstream->markSuccess(_peer);
+	return (PROXY_DONE);
+}
+
+/*	============================================================================
+		UPSTREAM : CHOIX DU SERVEUR
+	============================================================================ */
+
+Upstream::Upstream(const UpstreamConfig &config) : _config(config), _cursor(0) {
+	for (size_t i = 0; i < config.servers.size(); i++) {
+		UpstreamPeer	peer;
+		peer.config = config.servers[i];
+		peer.currentWeight = 0;
+		peer.active = 0;
+		peer.fails = 0;
+		peer.failedAt = 0;
+		_peers.push_back(peer);
+	}
+	if (config.balance != UPSTREAM_HASH || !config.consistent)
+		return;
+	// Anneau ketama : ajouter un serveur ne déplace qu'une part des clés
+	for (size_t i = 0; i < _peers.size(); i++) {
+		int	points = PROXY_RING_POINTS * _peers[i].config.weight;
+		for (int p = 0; p < points; p++) {
+			std::string	seed = _peers[i].config.address + "-" + httpIntToString(p);
+			unsigned long	point = crc32(0L, (const Bytef *)seed.data(), seed.size());
+			_ring.push_back(std::make_pair(point, i));
+		}
+	}
+	std::sort(_ring.begin(), _ring.end());
+}
+
+const std::string	&Upstream::getName() const {
+	return (_config.name);
+}
+
+size_t	Upstream::size() const {
+	return (_peers.size());
+}
+
+UpstreamPeer	&Upstream::peer(size_t index) {
+	return (_peers[index]);
+}
+
+// Un serveur seul n'est jamais écarté : il n'y a personne d'autre à essayer
+bool	Upstream::_usable(size_t peer, const std::vector<size_t> &tried, time_t now) const {
+	if (std::find(tried.begin(), tried.end(), peer) != tried.end())
+		return (false);
+	const UpstreamPeer	&p = _peers[peer];
+	if (_peers.size() == 1 || p.config.maxFails == 0 || p.fails < p.config.maxFails)
+		return (true);
+	return (now - p.failedAt >= p.config.failTimeout);
+}
+
+// Round-robin pondéré lissé : 5/1/1 donne a a b a c a a, pas a a a a a b c
+int	Upstream::_roundRobin(const std::vector<size_t> &tried, time_t now) {
+	int	best = -1;
+	int	total = 0;
+
+	for (size_t i = 0; i < _peers.size(); i++) {
+		if (!_usable(i, tried, now))
+			continue;
+		_peers[i].currentWeight += _peers[i].config.weight;
+		total += _peers[i].config.weight;
+		if (best < 0 || _peers[i].currentWeight > _peers[best].currentWeight)
+			best = (int)i;
+	}
+	if (best >= 0)
+		_peers[best].currentWeight -= total;
+	return (best);
+}
+
+// Moins de requêtes en cours rapporté au poids ; départ tournant à égalité
+int	Upstream::_leastConn(const std::vector<size_t> &tried, time_t now) {
+	int	best = -1;
+
+	for (size_t n = 0; n < _peers.size(); n++) {
+		size_t	i = (_cursor + n) % _peers.size();
+		if (!_usable(i, tried, now))
+			continue;
+		if (best < 0 || (long)_peers[i].active * _peers[best].config.weight
+		                < (long)_peers[best].active * _peers[i].config.weight)
+			best = (int)i;
+	}
+	_cursor++;
+	return (best);
+}
+
+// Serveur indisponible : la clé passe au suivant sur l'anneau (ou dans la liste)
+int	Upstream::_hash(const std::string &key, const std::vector<size_t> &tried, time_t now) {
+	unsigned long	hash = crc32(0L, (const Bytef *)key.data(), key.size());
+
+	if (_ring.empty()) {
+		for (size_t n = 0; n < _peers.size(); n++) {
+			size_t	i = (hash + n) % _peers.size();
+			if (_usable(i, tried, now))
+				return ((int)i);
+		}
+		return (-1);
+	}
+	std::vector<std::pair<unsigned long, size_t> >::const_iterator	it;
+	it = std::lower_bound(_ring.begin(), _ring.end(), std::make_pair(hash, (size_t)0));
+	for (size_t n = 0; n < _ring.size(); n++, ++it) {
+		if (it == _ring.end())
+			it = _ring.begin();
+		if (_usable(it->second, tried, now))
+			return ((int)it->second);
+	}
+	return (-1);
+}
+
+// "$host$request_uri" : chaque $nom est remplacé par sa valeur dans la requête
+std::string	Upstream::_hashKey(const std::map<std::string, std::string> &vars) const {
+	const std::string	&pattern = _config.hashKey;
+	std::string			key;
+
+	for (size_t i = 0; i < pattern.size(); ) {
+		if (pattern[i] != '$') {
+			key += pattern[i++];
+			continue;
+		}
+		size_t	end = i + 1;
+		while (end < pattern.size() && (std::isalnum(pattern[end]) || pattern[end] == '_'))
+			end++;
+		std::map<std::string, std::string>::const_iterator	var
+			= vars.find(pattern.substr(i + 1, end - i - 1));
+		if (var != vars.end())
+			key += var->second;
+		i = end;
+	}
+	return (key);
+}
+
+int	Upstream::_pick(const CGIJob &job, time_t now) {
+	if (_config.balance == UPSTREAM_LEAST_CONN)
+		return (_leastConn(job.proxyTried, now));
+	if (_config.balance == UPSTREAM_HASH)
+		return (_hash(_hashKey(job.params), job.proxyTried, now));
+	return (_roundRobin(job.proxyTried, now));
+}
+
+// Tous écartés par le contrôle passif : plutôt que des 502 jusqu'à la fin
+// de fail_timeout, on les remet à l'essai (un retour rapide est probable)
+int	Upstream::select(const CGIJob &job) {
+	time_t	now = time(NULL);
+	int		peer = _pick(job, now);
+
+	if (peer >= 0 || job.proxyTried.size() >= _peers.size())
+		return (peer);
+	for (size_t i = 0; i < _peers.size(); i++)
+		_peers[i].fails = 0;
+	return (_pick(job, now));
+}
+
+/*	============================================================================
+		UPSTREAM : CONTRÔLE PASSIF ET CONNEXIONS INACTIVES
+	============================================================================ */
+
+void	Upstream::markFailure(size_t peer) {
+	_peers[peer].fails++;
+	_peers[peer].failedAt = time(NULL);
+}
+
+void	Upstream::markSuccess(size_t peer) {
+	_peers[peer].fails = 0;
+}
+
+bool	Upstream::keepIdle(ProxyConnection *conn) {
+	std::vector<ProxyConnection*>	&idle = _peers[conn->getPeer()].idle;
+
+	if ((int)idle.size() >= _config.keepalive)
+		return (false);
+	idle.push_back(conn);
+	return (true);
+}
+
+void	Upstream::dropIdle(ProxyConnection *conn) {
+	std::vector<ProxyConnection*>	&idle = _peers[conn->getPeer()].idle;
+
+	for (size_t i = 0; i < idle.size(); i++) {
+		if (idle[i] == conn) {
+			idle.erase(idle.begin() + i);
+			return;
+		}
+	}
+}
+
+void	Upstream::takeIdle(size_t peer, std::vector<ProxyConnection*> &out) {
+	out.insert(out.end(), _peers[peer].idle.begin(), _peers[peer].idle.end());
+	_peers[peer].idle.clear();
+}
+
+/*	============================================================================
+		POOL DE CONNEXIONS
+	============================================================================ */
+
+ProxyPool::ProxyPool() {
+}
+
+ProxyPool::~ProxyPool() {
+	for (std::map<int, ProxyConnection*>::iterator it = _byFd.begin();
+	     it != _byFd.end(); ++it)
+		delete it->second;
+	for (std::map<std::string, Upstream*>::iterator it = _upstreams.begin();
+	     it != _upstreams.end(); ++it)
+		delete it->second;
+}
+
+void	ProxyPool::configure(const std::map<std::string, UpstreamConfig> &upstreams) {
+	for (std::map<std::string, UpstreamConfig>::const_iterator it = upstreams.begin();
+	     it != upstreams.end(); ++it)
+		_upstreams[it->first] = new Upstream(it->second);
+}
+
+// Le plus récent des keep-alive inactifs d'abord : le moins susceptible
+// d'avoir été fermé par le backend. Un connect() refusé tout de suite
+// compte comme un échec et passe au serveur suivant.
+ProxyConnection	*ProxyPool::acquire(CGIJob *job, bool &created) {
+	std::map<std::string, Upstream*>::iterator	it = _upstreams.find(job->proxyPass);
+
+	created = false;
+	if (it == _upstreams.end())
+		return (NULL);
+	Upstream	*upstream = it->second;
+	int			peer;
+	while ((peer = upstream->select(*job)) >= 0) {
+		std::vector<ProxyConnection*>	&idle = upstream->peer(peer).idle;
+		if (!idle.empty()) {
+			ProxyConnection	*conn = idle.back();
+			idle.pop_back();
+			conn->submit(job, true);
+			return (conn);
+		}
+		ProxyConnection	*conn = new ProxyConnection(upstream, peer);
+		if (conn->open()) {
+			_byFd[conn->getFd()] = conn;
+			conn->submit(job, false);
+			created = true;
+			return (conn);
+		}
+		delete conn;
+		upstream->markFailure(peer);
+		job->proxyTried.push_back(peer);
+	}
+	return (NULL);
+}
+
+ProxyConnection	*ProxyPool::find(int fd) const {
+	std::map<int, ProxyConnection*>::const_iterator it = _byFd.find(fd);
+	if (it == _byFd.end())
+		return (NULL);
+	return (it->second);
+}
+
+// Réponse complète : la connexion rejoint les inactives si possible
+bool	ProxyPool::release(ProxyConnection *conn) {
+	bool	keep = conn->reusable();
+
+	conn->detach();
+	return (keep && conn->getUpstream()->keepIdle(conn));
+}
+
+// Keep-alive réutilisé mort avant toute réponse : le backend a fermé ses
+// connexions inactives (redémarrage, timeout), les autres sont suspectes
+// aussi et le serveur n'est pas compté en échec
+void	ProxyPool::fail(ProxyConnection *conn, std::vector<ProxyConnection*> &stale) {
+	CGIJob	*job = conn->getJob();
+
+	if (conn->isReused() && conn->retriable()) {
+		conn->getUpstream()->takeIdle(conn->getPeer(), stale);
+		return;
+	}
+	conn->getUpstream()->markFailure(conn->getPeer());
+	if (job)
+		job->proxyTried.push_back(conn->getPeer());
+}
+
+// Retire et détruit la connexion ; l'appelant a déjà repris son fd
+void	ProxyPool::remove(ProxyConnection *conn) {
+	conn->getUpstream()->dropIdle(conn);
+	for (std::map<int, ProxyConnection*>::iterator it = _byFd.begin();
+	     it != _byFd.end(); ++it) {
+		if (it->second == conn) {
+			_byFd.erase(it);
+			break;
+		}
+	}
+	delete conn;
+}
@@ -13,14 +13,18 @@
 #include "Request.hpp"
 
 // ============ CONSTRUCTEUR/DESTRUCTEUR ============
-Request::Request() : _headerCount(0) {}
+Request::Request() : _headerCount(0), _bodySize(0), _closeAfter(false) {}
 Request::~Request() {}
 
 // ============ GETTERS ============
 std::string	Request::getMethod() const { return (_method); }
 std::string	Request::getUri() const { return (_uri); }
 std::string	Request::getVersion() const { return (_version); }
-std::string	Request::getBody() const { return (_body); }
+const std::string&	Request::getBody() const { return (_body); }
+const std::string&	Request::getBodyFile() const { return (_bodyFile); }
+size_t		Request::getBodySize() const { return (_bodySize); }
+const std::vector<UploadPart>&	Request::getParts() const { return (_parts); }
+bool		Request::mustClose() const { return (_closeAfter); }
 int			Request::getHeaderCount() const { return (_headerCount); }
 
 std::string Request::getHeader(const std::string &key) const {
@@ -50,6 +54,10 @@ void	Request::loadFromRaw(const RawRequest &raw) {
 	_uri = raw.uri;
 	_version = raw.version;
 	_body = raw.body;
+	_bodyFile = raw.bodyFile;
+	_bodySize = raw.bodySize;
+	_parts = raw.parts;
+	_closeAfter = raw.closeAfter;
 	_headerCount = 0;
 	for (std::map<std::string, std::string>::const_iterator it = raw.headers.begin();
 		it != raw.headers.end() && _headerCount < MAX_HEADERS; ++it) {
@@ -12,102 +12,100 @@
 
 #include "RequestHandler.hpp"
 #include "../inc/ResponseBuilder.hpp"
+#include "../inc/ContentCache.hpp"
 
-RequestHandler::RequestHandler(const std::vector<ServerConfig> &servers) : _servers(servers) {}
-RequestHandler::~RequestHandler() {}
+// Les tables d'exécution pointent dans _servers : compilées une fois la copie en place
+RequestHandler::RequestHandler(const std::vector<ServerConfig> &servers) : _servers(servers) {
+	for (size_t i = 0; i < _servers.size(); i++)
+		_runtime.push_back(RuntimeConfig::compile(_servers[i]));
+	_vhosts.build(_servers);
+}
+RequestHandler::~RequestHandler() {
+	for (size_t i = 0; i < _runtime.size(); i++)
+		RuntimeConfig::release(_runtime[i]);
+}
 
 /*	============================================================================
 	CONFIGURATION ROUTING
 	============================================================================ */
 
-ServerConfig*	RequestHandler::_findServerConfig(int port, const std::string &host) {
-	ServerConfig*	fallback = NULL;
-
-	for (size_t i = 0; i < _servers.size(); i++) {
-		if (_servers[i].port != port)
-			continue;
-		if (fallback == NULL)
-			fallback = &_servers[i];
-		for (size_t j = 0; j < _servers[i].serverNames.size(); j++) {
-			if (_servers[i].serverNames[j] == host)
-				return (&_servers[i]);
-		}
-	}
-	return (fallback);
+// host peut encore porter son suffixe ":port", l'index l'ignore
+const RuntimeServer*	RequestHandler::_findServer(int port, const std::string &host) {
+	return (_runtimeFor(_vhosts.lookup(port, host)));
 }
 
-LocationConfig*	RequestHandler::_findLocation(ServerConfig* server, const std::string &uri) {
-	if (!server)
+const RuntimeServer*	RequestHandler::_findServer(int port, const RawRequest &raw) {
+	std::map<std::string, std::string>::const_iterator	host = raw.headers.find("host");
+	return (_findServer(port, host == raw.headers.end() ? "" : host->second));
+}
+
+const RuntimeServer*	RequestHandler::_runtimeFor(const ServerConfig* config) const {
+	if (!config)
 		return (NULL);
-	std::string uriPath = uri;
-	size_t qPos = uriPath.find('?');
-	if (qPos != std::string::npos)
-		uriPath = uriPath.substr(0, qPos);
-	LocationConfig*	best_match = NULL;
-	size_t			best_length = 0;
-	for (size_t i = 0; i < server->locations.size(); i++) {
-		const std::string &loc_path = server->locations[i].path;
-		if (uriPath.substr(0, loc_path.length()) == loc_path) {
-			if (loc_path.length() > best_length) {
-				best_match = &server->locations[i];
-				best_length = loc_path.length();
-			}
-		}
-	}
-	return (best_match);
+	return (&_runtime[config - &_servers[0]]);
 }
 
-bool	RequestHandler::_isMethodAllowed(LocationConfig* loc, const std::string &method) {
-	if (!loc)
+// max_body_size de la location, sinon celui du serveur (0 : illimité)
+bool	RequestHandler::_isBodyTooLarge(long bodySize, const RuntimeLocation* loc) {
+	if (!loc || loc->maxBodySize <= 0)
 		return (false);
-	for (size_t i = 0; i < loc->allowedMethods.size(); i++) {
-		if (loc->allowedMethods[i] == method)
-			return (true);
-	}
-	return (false);
+	return (bodySize > loc->maxBodySize);
 }
 
-bool	RequestHandler::_isBodyComplete(const std::string &rawData, const Request &request) {
-	std::string	contentLengthStr = request.getHeader("Content-Length");
-	if (contentLengthStr.empty())
-		return (true);
-	size_t	bodyStart = rawData.find("\r\n\r\n");
-	if (bodyStart == std::string::npos)
-		return (false);
-	bodyStart += 4;
-	long	bodySize = rawData.length() - bodyStart;
-	long	expectedLength = atol(contentLengthStr.c_str());
-	return (bodySize >= expectedLength);
+/*	============================================================================
+	HELPER: Connexions persistantes (RFC 7230 §6.3)
+	HTTP/1.1 garde la connexion sauf "Connection: close", HTTP/1.0 la ferme
+	sauf "Connection: keep-alive". 400 et 413 ferment toujours : le flux
+	restant n'est plus fiable. Idem pour une requête qui portait à la fois
+	Transfer-Encoding et Content-Length (RFC 9112 §6.1).
+	============================================================================ */
+
+void	RequestHandler::_applyKeepAlive(const Request &request, const RuntimeServer* server,
+                                        Response &resp, HTTPConnection &conn) {
+	std::string	connection = httpToLower(request.getHeader("Connection"));
+	bool		keepAlive;
+
+	if (request.getVersion() == "HTTP/1.0")
+		keepAlive = (connection.find("keep-alive") != std::string::npos);
+	else
+		keepAlive = (connection.find("close") == std::string::npos);
+	if (!server || server->config->keepaliveTimeout <= 0
+	    || conn.requestCount + 1 >= server->config->keepaliveRequests)
+		keepAlive = false;
+	if (resp.getStatusCode() == HTTP_BAD_REQUEST
+	    || resp.getStatusCode() == HTTP_PAYLOAD_TOO_LARGE || request.mustClose())
+		keepAlive = false;
+	conn.keepAlive = keepAlive;
+	conn.keepAliveTimeout = keepAlive ? server->config->keepaliveTimeout : 0;
+	_setConnectionHeader(resp, conn.keepAlive, conn.keepAliveTimeout);
 }
 
-bool	RequestHandler::_isBodyTooLarge(long bodySize, ServerConfig* server) {
-	if (!server || server->maxBodySize <= 0)
-		return (false);
-	return (bodySize > server->maxBodySize);
+void	RequestHandler::_setConnectionHeader(Response &resp, bool keepAlive, int timeout) {
+	if (keepAlive) {
+		resp.setHeader("Connection", "keep-alive");
+		resp.setHeader("Keep-Alive", "timeout=" + httpIntToString(timeout));
+	} else
+		resp.setHeader("Connection", "close");
 }
 
 /*	============================================================================
 	HELPER: Construit le chemin fichier (alias-style comme décrit dans le sujet)
 	Exemple sujet : URL /kapouet rooté à /tmp/www → /kapouet/foo → /tmp/www/foo
+	La racine est déjà absolue et terminée par '/' (RuntimeConfig).
 	============================================================================ */
 
-std::string	RequestHandler::_buildFilePath(const std::string &uri,
-                                            ServerConfig* server, LocationConfig* loc) {
-	std::string root = (loc->root.empty() && server) ? server->root : loc->root;
-	std::string path = uri;
-	size_t qPos = path.find('?');
-	if (qPos != std::string::npos)
-		path = path.substr(0, qPos);
-	if (!loc->path.empty() && path.length() >= loc->path.length()
-	    && path.substr(0, loc->path.length()) == loc->path) {
-		path = path.substr(loc->path.length());
-	}
-	if (!path.empty() && path[0] == '/')
-		path = path.substr(1);
-	std::string filePath = root;
-	if (!filePath.empty() && filePath[filePath.length() - 1] != '/')
-		filePath += '/';
-	filePath += path;
+std::string	RequestHandler::_buildFilePath(const std::string &uri, const RuntimeLocation* loc) {
+	size_t end = uri.find('?');
+	if (end == std::string::npos)
+		end = uri.length();
+	size_t start = 0;
+	if (!loc->path.empty() && end >= loc->path.length()
+	    && uri.compare(0, loc->path.length(), loc->path) == 0)
+		start = loc->path.length();
+	if (start < end && uri[start] == '/')
+		start++;
+	std::string filePath = loc->root;
+	filePath.append(uri, start, end - start);
 	std::string normalized = FileHandler::normalizePath(filePath);
 	if (normalized.empty())
 		return ("");
@@ -115,64 +113,385 @@ std::string	RequestHandler::_buildFilePath(const std::string &uri,
 }
 
 /*	============================================================================
-	HELPER: Construit une Response à partir de la sortie CGI
-	Parse les éventuels headers CGI (Status:, Content-Type:) dans stdout
+	HELPER: Lance un CGI asynchrone ; la Response ne porte que le job,
+	la boucle principale appelle finishCGI() quand stdout atteint EOF
+	============================================================================ */
+
+Response	RequestHandler::_startCGI(const std::string &scriptPath, const Request &request,
+                                      const RuntimeServer* server, const RuntimeLocation* loc,
+                                      ResponseBuilder &builder) {
+	CGIJob*	job = CGIHandler::start(scriptPath, request, *server->config,
+	                                loc->source->cgiHandlers);
+	if (!job)
+		return (builder.buildError(HTTP_BAD_GATEWAY, "Bad Gateway"));
+	job->location = loc;
+	job->acceptsGzip = httpAcceptsEncoding(request.getHeader("Accept-Encoding"), "gzip");
+	Response	resp;
+	resp.setCGIJob(job);
+	return (resp);
+}
+
+/*	============================================================================
+	HELPER: Location "fastcgi_pass" : toute requête part au serveur
+	applicatif, qui décide lui-même de l'existence du script
+	============================================================================ */
+
+Response	RequestHandler::_startFastCGI(const Request &request, const RuntimeServer* server,
+                                          const RuntimeLocation* loc, ResponseBuilder &builder) {
+	if (_isBodyTooLarge((long)request.getBodySize(), loc))
+		return (builder.buildError(413, "Payload Too Large"));
+	std::string	scriptPath = _buildFilePath(request.getUri(), loc);
+	if (scriptPath.empty())
+		return (builder.buildError(403, "Forbidden"));
+	CGIJob*		job = CGIHandler::prepareFastCGI(scriptPath, request, *server->config,
+	                                             loc->fastcgiPass);
+	if (!job)
+		return (builder.buildError(500, "Internal Server Error"));
+	job->location = loc;
+	job->acceptsGzip = httpAcceptsEncoding(request.getHeader("Accept-Encoding"), "gzip");
+	Response	resp;
+	resp.setCGIJob(job);
+	return (resp);
+}
+
+/*	============================================================================
+	HELPER: Location "proxy_pass" : la requête part à un serveur de
+	l'upstream, le préfixe de la location remplacé par l'URI de proxy_pass
+	s'il y en a une ("/api/" -> "http://app/v1/" : /api/x -> /v1/x)
+	============================================================================ */
+
+Response	RequestHandler::_startProxy(const Request &request, const RuntimeServer* server,
+                                        const RuntimeLocation* loc, ResponseBuilder &builder) {
+	if (_isBodyTooLarge((long)request.getBodySize(), loc))
+		return (builder.buildError(413, "Payload Too Large"));
+	std::string	uri = request.getUri();
+	if (!loc->proxyUri.empty() && uri.compare(0, loc->path.length(), loc->path) == 0)
+		uri = loc->proxyUri + uri.substr(loc->path.length());
+	CGIJob*		job = CGIHandler::prepareProxy(request, *server->config, loc->proxyPass, uri);
+	if (!job)
+		return (builder.buildError(500, "Internal Server Error"));
+	job->location = loc;
+	job->acceptsGzip = httpAcceptsEncoding(request.getHeader("Accept-Encoding"), "gzip");
+	Response	resp;
+	resp.setCGIJob(job);
+	return (resp);
+}
+
+Response	RequestHandler::finishCGI(CGIJob &job) {
+	ResponseBuilder	builder(_runtimeFor(job.server));
+	Response		resp;
+	if (job.timedOut)
+		resp = builder.buildError(HTTP_GATEWAY_TIMEOUT, "Gateway Timeout");
+	else {
+		resp = _buildCGIResponse(job.result, builder);
+		_gzipBody(job.location, job.acceptsGzip, resp);
+		if (!job.cache.key.empty() && job.result.success
+		    && ResponseCache::prepare(job.cache, resp, job.location->source->cacheValid)) {
+			job.cache.body = resp.getBody();
+			ResponseCache::store(job.cache);
+		}
+	}
+	if (!job.cache.key.empty())
+		resp.setHeader("X-Cache-Status", ResponseCache::statusName(job.cache.status));
+	_setConnectionHeader(resp, job.keepAlive, job.keepAliveTimeout);
+	return (resp);
+}
+
+/*	============================================================================
+	Début du streaming CGI : seule la tête de réponse est construite ici,
+	le corps est relayé par la boucle au fur et à mesure. Sans longueur
+	annoncée : chunked en HTTP/1.1, fin de connexion en HTTP/1.0. Avec
+	gzip, chaque lecture est compressée et part en chunk.
+	============================================================================ */
+
+Response	RequestHandler::startCGIStream(CGIJob &job, size_t headerEnd, size_t bodyStart) {
+	CGIHeaders	headers;
+	Response	resp;
+
+	CGIHandler::parseHeaders(job.result.output.substr(0, headerEnd), headers);
+	job.result.output.erase(0, bodyStart);
+	resp.setVersion("HTTP/1.1");
+	resp.setStatus(headers.statusCode, httpStatusCodeToMessage(headers.statusCode));
+	resp.setHeader("Content-Type", headers.contentType);
+	for (size_t i = 0; i < headers.extra.size(); i++)
+		resp.setHeader(headers.extra[i].first, headers.extra[i].second);
+	if (job.location && headers.statusCode == HTTP_OK && resp.getHeader("Content-Encoding").empty()
+	    && job.location->compresses(headers.contentType, headers.contentLength)) {
+		resp.setHeader("Vary", "Accept-Encoding");
+		if (job.acceptsGzip && job.httpVersion == "HTTP/1.1")
+			job.gzip = new GzipStream(job.location->gzipLevel);
+	}
+	if (headers.statusCode == 204 || headers.statusCode == 304)
+		job.contentLength = 0;
+	else if (job.gzip && job.gzip->isOpen()) {
+		// Corps compressé au fil des lectures : longueur finale inconnue
+		job.contentLength = headers.contentLength;
+		job.chunked = true;
+		resp.setHeader("Content-Encoding", "gzip");
+		resp.setHeader("Transfer-Encoding", "chunked");
+	}
+	else if (headers.contentLength >= 0) {
+		job.contentLength = headers.contentLength;
+		resp.setHeader("Content-Length", httpIntToString(headers.contentLength));
+	}
+	else if (job.httpVersion == "HTTP/1.1") {
+		job.chunked = true;
+		resp.setHeader("Transfer-Encoding", "chunked");
+	}
+	else
+		job.keepAlive = false;
+	// Le corps sera collecté par la boucle au fil de l'envoi
+	if (!job.cache.key.empty()) {
+		ResponseCache::prepare(job.cache, resp, job.location->source->cacheValid);
+		resp.setHeader("X-Cache-Status", ResponseCache::statusName(job.cache.status));
+	}
+	_setConnectionHeader(resp, job.keepAlive, job.keepAliveTimeout);
+	return (resp);
+}
+
+/*	============================================================================
+	HELPER: Construit une Response à partir de la sortie CGI complète
+	(script terminé avant la fin de son bloc d'en-têtes)
 	============================================================================ */
 
 Response	RequestHandler::_buildCGIResponse(const CGIResult &result,
                                                ResponseBuilder &builder) {
 	if (!result.success && result.exitCode != 0)
 		return (builder.buildError(502, "Bad Gateway"));
-	std::string output = result.output;
-	size_t headerEnd = output.find("\r\n\r\n");
-	if (headerEnd == std::string::npos)
+	const std::string	&output = result.output;
+	size_t				headerEnd = output.find("\r\n\r\n");
+	size_t				bodyStart = headerEnd + 4;
+	if (headerEnd == std::string::npos) {
 		headerEnd = output.find("\n\n");
+		bodyStart = headerEnd + 2;
+	}
 	if (headerEnd == std::string::npos)
 		return (builder.buildSuccess(200, output, "text/html"));
-	std::string cgiHeaders = output.substr(0, headerEnd);
-	size_t      bodyStart  = headerEnd + ((output[headerEnd] == '\r') ? 4 : 2);
-	std::string body       = output.substr(bodyStart);
-	int         statusCode  = 200;
-	std::string contentType = "text/html";
-	size_t pos = 0;
-	while (pos < cgiHeaders.size()) {
-		size_t lineEnd = cgiHeaders.find('\n', pos);
-		if (lineEnd == std::string::npos)
-			lineEnd = cgiHeaders.size();
-		std::string line = cgiHeaders.substr(pos, lineEnd - pos);
-		if (!line.empty() && line[line.size() - 1] == '\r')
-			line = line.substr(0, line.size() - 1);
-		pos = lineEnd + 1;
-		if (line.empty())
-			continue;
-		size_t colonPos = line.find(':');
-		if (colonPos == std::string::npos)
-			continue;
-		std::string key   = line.substr(0, colonPos);
-		std::string value = line.substr(colonPos + 1);
-		size_t valStart = value.find_first_not_of(" \t");
-		if (valStart != std::string::npos)
-			value = value.substr(valStart);
-		for (size_t i = 0; i < key.size(); i++) {
-			if (key[i] >= 'A' && key[i] <= 'Z')
-				key[i] += 32;
+	CGIHeaders	headers;
+	CGIHandler::parseHeaders(output.substr(0, headerEnd), headers);
+	Response	resp = builder.buildSuccess(headers.statusCode,
+	                                        output.substr(bodyStart), headers.contentType);
+	for (size_t i = 0; i < headers.extra.size(); i++)
+		resp.setHeader(headers.extra[i].first, headers.extra[i].second);
+	return (resp);
+}
+
+/*	============================================================================
+	HELPER: Fichier statique servi depuis un fd ouvert (sendfile côté boucle)
+	Les petits fichiers passent par le ContentCache : la réponse entière est
+	sérialisée une fois puis partagée entre les connexions.
+	============================================================================ */
+
+// En-têtes propres au fichier : figés dans le bloc du ContentCache.
+// Une version compressée à la volée est une autre entité : ETag faible
+void	RequestHandler::_setFileHeaders(Response &resp, const StaticFile &file,
+                                        bool compressed) {
+	ResponseBuilder::setValidators(resp, file.info);
+	if (compressed) {
+		resp.setHeader("ETag", "W/" + ResponseBuilder::etag(file.info));
+		resp.setHeader("Content-Encoding", "gzip");
+		return ;
+	}
+	resp.setHeader("Accept-Ranges", "bytes");
+	if (!file.encoding.empty())
+		resp.setHeader("Content-Encoding", file.encoding);
+}
+
+Response	RequestHandler::_serveFile(const StaticFile &file, ResponseBuilder &builder) {
+	if (file.info.type == FILE_REGULAR && ContentCache::accepts(file.info.size)) {
+		SharedBuffer	*cached = ContentCache::lookup(file.cacheKey, file.info);
+		if (cached)
+			return (builder.buildCached(200, cached));
+		std::string	body = FileHandler::getContent(file.path);
+		std::string	zipped;
+		if ((long)body.length() == file.info.size
+		    && (!file.gzipLevel || GzipStream::compress(body, file.gzipLevel, zipped))) {
+			if (file.gzipLevel)
+				body.swap(zipped);
+			Response	resp = builder.buildSuccess(200, body, file.mimeType);
+			_setFileHeaders(resp, file, file.gzipLevel > 0);
+			ContentCache::store(file.cacheKey, file.info, ResponseBuilder::serialize(resp, body));
+			cached = ContentCache::lookup(file.cacheKey, file.info);
+			return (cached ? builder.buildCached(200, cached) : resp);
+		}
+	}
+	long	size = 0;
+	int		fd = FileHandler::openForReading(file.path, size);
+	if (fd < 0)
+		return (builder.buildError(403, "Forbidden"));
+	Response	resp = builder.buildFile(200, fd, size, file.mimeType);
+	_setFileHeaders(resp, file, false);
+	return (resp);
+}
+
+// Plages servies depuis le fd : jamais de copie complète en mémoire
+Response	RequestHandler::_serveRanges(const std::string &rangeHeader, const StaticFile &file,
+                                         ResponseBuilder &builder) {
+	std::vector<HTTPRange>	ranges;
+	int						status = httpParseRange(rangeHeader, file.info.size, ranges);
+	if (status == HTTP_OK)
+		return (_serveFile(file, builder));
+	if (status == HTTP_RANGE_NOT_SATISFIABLE) {
+		Response	resp = builder.buildError(HTTP_RANGE_NOT_SATISFIABLE, "Range Not Satisfiable");
+		resp.setHeader("Content-Range", "bytes */" + httpIntToString(file.info.size));
+		return (resp);
+	}
+	long	size = 0;
+	int		fd = FileHandler::openForReading(file.path, size);
+	if (fd < 0)
+		return (builder.buildError(403, "Forbidden"));
+	Response	resp = builder.buildRanges(fd, ranges, file.info.size, file.mimeType);
+	_setFileHeaders(resp, file, false);
+	return (resp);
+}
+
+// gzip_static : "fichier.gz" remplace le fichier si le client accepte gzip
+// et qu'il n'est pas plus ancien ; le stat passe par l'OpenFileCache.
+// Sinon, gzip : compression à la volée, limitée aux fichiers que le
+// ContentCache garde (le résultat y est mémorisé, clé distincte)
+StaticFile	RequestHandler::_selectVariant(const Request &request, const std::string &filePath,
+                                           const RuntimeLocation* loc) {
+	StaticFile	file;
+	file.path = filePath;
+	file.info = OpenFileCache::lookup(filePath);
+	file.mimeType = httpGetMimeType(filePath);
+	file.gzipLevel = 0;
+	file.cacheKey = filePath;
+	if (file.info.type != FILE_REGULAR
+	    || !httpAcceptsEncoding(request.getHeader("Accept-Encoding"), "gzip"))
+		return (file);
+	if (loc->gzipStatic) {
+		std::string	gzPath = filePath + ".gz";
+		FileInfo	gzInfo = OpenFileCache::lookup(gzPath);
+		if (gzInfo.type == FILE_REGULAR && gzInfo.mtime >= file.info.mtime) {
+			file.path = gzPath;
+			file.info = gzInfo;
+			file.encoding = "gzip";
+			file.cacheKey = gzPath;
+			return (file);
 		}
-		if (key == "status")
-			statusCode = atoi(value.c_str());
-		else if (key == "content-type")
-			contentType = value;
 	}
-	return (builder.buildSuccess(statusCode, body, contentType));
+	if (loc->compresses(file.mimeType, file.info.size) && ContentCache::accepts(file.info.size)) {
+		file.gzipLevel = loc->gzipLevel;
+		file.cacheKey = filePath + std::string(1, '\0') + "gzip";
+	}
+	return (file);
+}
+
+Response	RequestHandler::_serveStatic(const Request &request, const std::string &filePath,
+                                         const RuntimeLocation* loc, ResponseBuilder &builder) {
+	StaticFile	file = _selectVariant(request, filePath, loc);
+	Response	resp;
+	if (file.info.type == FILE_REGULAR && _isNotModified(request, file.info)) {
+		resp = builder.buildNotModified(file.info);
+		if (file.gzipLevel)
+			resp.setHeader("ETag", "W/" + ResponseBuilder::etag(file.info));
+	}
+	else if (file.info.type == FILE_REGULAR && _rangeApplies(request, file.info))
+		resp = _serveRanges(request.getHeader("Range"), file, builder);
+	else
+		resp = _serveFile(file, builder);
+	if (resp.getStatusCode() == HTTP_OK || resp.getStatusCode() == HTTP_PARTIAL_CONTENT
+	    || resp.getStatusCode() == HTTP_NOT_MODIFIED) {
+		_applyExpires(resp, loc);
+		if (loc->gzipStatic || loc->compresses(file.mimeType, file.info.size))
+			resp.setHeader("Vary", "Accept-Encoding");
+	}
+	return (resp);
+}
+
+/*	============================================================================
+	HELPER: Compression gzip d'un corps déjà en mémoire (autoindex, CGI
+	terminé) ; les réponses déjà encodées ou sur fichier ne sont pas touchées
+	============================================================================ */
+
+void	RequestHandler::_gzipBody(const RuntimeLocation* loc, bool accepted, Response &resp) {
+	if (!loc || resp.getStatusCode() != HTTP_OK || resp.getBodyFd() >= 0 || resp.getCached()
+	    || !resp.getHeader("Content-Encoding").empty()
+	    || !loc->compresses(resp.getHeader("Content-Type"), resp.getBody().length()))
+		return ;
+	resp.setHeader("Vary", "Accept-Encoding");
+	std::string	zipped;
+	if (!accepted || !GzipStream::compress(resp.getBody(), loc->gzipLevel, zipped))
+		return ;
+	resp.setHeader("Content-Encoding", "gzip");
+	resp.setHeader("Content-Length", httpIntToString(zipped.length()));
+	resp.setBody(zipped);
+}
+
+/*	============================================================================
+	HELPER: Requêtes conditionnelles (RFC 9110 §13)
+	If-None-Match l'emporte sur If-Modified-Since ; comparaison faible
+	des ETags, "*" correspond à tout fichier existant.
+	============================================================================ */
+
+bool	RequestHandler::_isNotModified(const Request &request, const FileInfo &info) {
+	std::string	ifNoneMatch = request.getHeader("If-None-Match");
+	if (!ifNoneMatch.empty()) {
+		std::string	etag = ResponseBuilder::etag(info);
+		size_t		pos = 0;
+		while (pos < ifNoneMatch.length()) {
+			size_t		comma = ifNoneMatch.find(',', pos);
+			if (comma == std::string::npos)
+				comma = ifNoneMatch.length();
+			std::string	tag = ifNoneMatch.substr(pos, comma - pos);
+			size_t		start = tag.find_first_not_of(" \t");
+			size_t		end = tag.find_last_not_of(" \t");
+			if (start != std::string::npos) {
+				tag = tag.substr(start, end - start + 1);
+				if (tag.compare(0, 2, "W/") == 0)
+					tag.erase(0, 2);
+				if (tag == "*" || tag == etag)
+					return (true);
+			}
+			pos = comma + 1;
+		}
+		return (false);
+	}
+	std::string	ifModifiedSince = request.getHeader("If-Modified-Since");
+	if (ifModifiedSince.empty())
+		return (false);
+	time_t	since = httpParseDate(ifModifiedSince);
+	return (since != -1 && info.mtime <= since);
+}
+
+// If-Range : la plage n'est servie que si le fichier n'a pas changé
+// (ETag fort identique, ou date égale au Last-Modified)
+bool	RequestHandler::_rangeApplies(const Request &request, const FileInfo &info) {
+	if (request.getHeader("Range").empty())
+		return (false);
+	std::string	ifRange = request.getHeader("If-Range");
+	if (ifRange.empty())
+		return (true);
+	if (ifRange[0] == '"')
+		return (ifRange == ResponseBuilder::etag(info));
+	if (ifRange.compare(0, 2, "W/") == 0)
+		return (false);
+	return (httpParseDate(ifRange) == info.mtime);
+}
+
+// Directives "expires" et "cache_control" de la location
+void	RequestHandler::_applyExpires(Response &resp, const RuntimeLocation* loc) {
+	if (loc->expires == EXPIRES_EPOCH) {
+		resp.setHeader("Expires", httpFormatDate(1));
+		resp.setHeader("Cache-Control", "no-cache");
+	}
+	else if (loc->expires >= 0) {
+		resp.setHeader("Expires", httpFormatDate(time(NULL) + loc->expires));
+		resp.setHeader("Cache-Control", "max-age=" + httpIntToString(loc->expires));
+	}
+	if (!loc->cacheControl.empty())
+		resp.setHeader("Cache-Control", loc->cacheControl);
 }
 
 /*	============================================================================
 	GET HANDLER — fichiers statiques + CGI
 	============================================================================ */
 
-Response	RequestHandler::_handleGET(const Request &request, ServerConfig* server,
-                                       LocationConfig* loc) {
+Response	RequestHandler::_handleGET(const Request &request, const RuntimeServer* server,
+                                       const RuntimeLocation* loc) {
 	ResponseBuilder	builder(server);
-	std::string     filePath = _buildFilePath(request.getUri(), server, loc);
+	std::string     filePath = _buildFilePath(request.getUri(), loc);
 	if (filePath.empty())
 		return (builder.buildError(403, "Forbidden"));
 	if (FileHandler::isDirectory(filePath)) {
@@ -182,80 +501,102 @@ Response	RequestHandler::_handleGET(const Request &request, ServerConfig* server
 				indexPath += '/';
 			indexPath += loc->index;
 			if (FileHandler::exists(indexPath)) {
-				if (!loc->cgiHandlers.empty()
-				    && CGIHandler::isCGI(indexPath, loc->cgiHandlers)) {
-					CGIResult result = CGIHandler::execute(
-						indexPath, request, *server, loc->cgiHandlers);
-					return (_buildCGIResponse(result, builder));
+				if (loc->hasCGI()
+				    && CGIHandler::isCGI(indexPath, loc->source->cgiHandlers)) {
+					return (_startCGI(indexPath, request, server, loc, builder));
 				}
-				std::string content  = FileHandler::getContent(indexPath);
-				std::string mimeType = httpGetMimeType(indexPath);
-				return (builder.buildSuccess(200, content, mimeType));
+				return (_serveStatic(request, indexPath, loc, builder));
 			}
 		}
 		if (loc->autoIndex) {
 			std::string listing = FileHandler::generateDirectoryListing(
 				filePath, request.getUri());
-			return (builder.buildSuccess(200, listing, "text/html"));
+			Response	resp = builder.buildSuccess(200, listing, "text/html");
+			_gzipBody(loc, httpAcceptsEncoding(request.getHeader("Accept-Encoding"), "gzip"), resp);
+			return (resp);
 		}
 		return (builder.buildError(403, "Forbidden"));
 	}
 	if (!FileHandler::exists(filePath))
 		return (builder.buildError(404, "Not Found"));
-	if (!loc->cgiHandlers.empty() && CGIHandler::isCGI(filePath, loc->cgiHandlers)) {
-		CGIResult result = CGIHandler::execute(
-			filePath, request, *server, loc->cgiHandlers);
-		return (_buildCGIResponse(result, builder));
+	if (loc->hasCGI() && CGIHandler::isCGI(filePath, loc->source->cgiHandlers)) {
+		return (_startCGI(filePath, request, server, loc, builder));
 	}
-	std::string content  = FileHandler::getContent(filePath);
-	std::string mimeType = httpGetMimeType(filePath);
-	return (builder.buildSuccess(200, content, mimeType));
+	return (_serveStatic(request, filePath, loc, builder));
 }
 
 /*	============================================================================
 	POST HANDLER — CGI d'abord, puis upload de fichier
 	============================================================================ */
 
-Response	RequestHandler::_handlePOST(const Request &request, ServerConfig* server,
-                                        LocationConfig* loc) {
+Response	RequestHandler::_handlePOST(const Request &request, const RuntimeServer* server,
+                                        const RuntimeLocation* loc) {
 	ResponseBuilder	builder(server);
-	long            bodySize = (long)request.getBody().length();
-	if (_isBodyTooLarge(bodySize, server))
+	long            bodySize = (long)request.getBodySize();
+	if (_isBodyTooLarge(bodySize, loc))
 		return (builder.buildError(413, "Payload Too Large"));
-	if (!loc->cgiHandlers.empty()) {
-		std::string filePath = _buildFilePath(request.getUri(), server, loc);
-		if (CGIHandler::isCGI(filePath, loc->cgiHandlers)
+	if (loc->hasCGI()) {
+		std::string filePath = _buildFilePath(request.getUri(), loc);
+		if (CGIHandler::isCGI(filePath, loc->source->cgiHandlers)
 		    && FileHandler::exists(filePath)) {
-			CGIResult result = CGIHandler::execute(
-				filePath, request, *server, loc->cgiHandlers);
-			return (_buildCGIResponse(result, builder));
+			return (_startCGI(filePath, request, server, loc, builder));
 		}
 	}
 	if (!loc->allowUpload)
 		return (builder.buildError(405, "Method Not Allowed"));
 	if (loc->uploadStore.empty())
 		return (builder.buildError(500, "Internal Server Error"));
+	if (!request.getParts().empty())
+		return (_storeParts(request, loc, builder));
 	std::string uploadPath = loc->uploadStore;
-	if (!uploadPath.empty() && uploadPath[uploadPath.length() - 1] != '/')
-		uploadPath += '/';
 	std::string filename = FileHandler::extractFileName(request.getUri());
 	if (filename.empty())
 		filename = "upload";
 	uploadPath += filename;
-	if (!FileHandler::writeContent(uploadPath, request.getBody()))
+	if (!request.getBodyFile().empty()) {
+		if (!FileHandler::moveFile(request.getBodyFile(), uploadPath))
+			return (builder.buildError(500, "Internal Server Error"));
+	}
+	else if (!FileHandler::writeContent(uploadPath, request.getBody()))
 		return (builder.buildError(500, "Internal Server Error"));
 	std::string resp = "<html><body><h1>File uploaded successfully</h1></body></html>";
 	return (builder.buildSuccess(201, resp, "text/html"));
 }
 
+/*	============================================================================
+	HELPER: Upload multipart/form-data — les fichiers sont déjà sur disque
+	(voir MultipartParser), il ne reste qu'à les renommer sous leur nom
+	d'origine, réduit à un nom de fichier sûr
+	============================================================================ */
+
+Response	RequestHandler::_storeParts(const Request &request, const RuntimeLocation* loc,
+                                        ResponseBuilder &builder) {
+	const std::vector<UploadPart>	&parts = request.getParts();
+	std::string						list;
+
+	for (size_t i = 0; i < parts.size(); i++) {
+		std::string	name = FileHandler::safeFileName(parts[i].filename);
+		if (parts[i].path.empty() || name.empty())
+			continue ;
+		if (!FileHandler::moveFile(parts[i].path, loc->uploadStore + name))
+			return (builder.buildError(500, "Internal Server Error"));
+		list += "<li>" + name + "</li>";
+	}
+	if (list.empty())
+		return (builder.buildError(400, "Bad Request"));
+	std::string resp = "<html><body><h1>File uploaded successfully</h1><ul>"
+	                   + list + "</ul></body></html>";
+	return (builder.buildSuccess(201, resp, "text/html"));
+}
+
 /*	============================================================================
 	DELETE HANDLER
 	============================================================================ */
 
-Response	RequestHandler::_handleDELETE(const Request &request, ServerConfig* server,
-                                          LocationConfig* loc) {
+Response	RequestHandler::_handleDELETE(const Request &request, const RuntimeServer* server,
+                                          const RuntimeLocation* loc) {
 	ResponseBuilder	builder(server);
-	std::string     filePath = _buildFilePath(request.getUri(), server, loc);
+	std::string     filePath = _buildFilePath(request.getUri(), loc);
 	if (filePath.empty())
 		return (builder.buildError(403, "Forbidden"));
 	if (!FileHandler::exists(filePath))
@@ -271,20 +612,74 @@ Response	RequestHandler::_handleDELETE(const Request &request, ServerConfig* ser
 	POINT D'ENTRÉE PRINCIPAL
 	============================================================================ */
 
-Response	RequestHandler::handleRequest(const Request &request,
-                                          const std::string &rawData, int port) {
-	ResponseBuilder	builder(NULL);
-	if (!_isBodyComplete(rawData, request))
-		return (builder.buildError(400, "Bad Request"));
-	std::string hostHeader = request.getHeader("host");
-	size_t colonPos = hostHeader.find(':');
-	if (colonPos != std::string::npos)
-		hostHeader = hostHeader.substr(0, colonPos);
-	ServerConfig* server = _findServerConfig(port, hostHeader);
+Response	RequestHandler::handleRequest(const Request &request, HTTPConnection &conn) {
+	const RuntimeServer* server = _findServer(conn.port, request.getHeader("host"));
+	Response resp = _dispatch(request, server);
+	_applyKeepAlive(request, server, resp, conn);
+	return (resp);
+}
+
+/*	============================================================================
+	Appelé dès la fin des en-têtes, avant le premier octet du corps :
+	max_body_size de la route (refus immédiat d'un Content-Length trop
+	grand), taille gardée en mémoire, puis répertoire du fichier
+	temporaire. Pour un upload c'est upload_store lui-même, le rename()
+	final reste ainsi sur le même système de fichiers.
+	============================================================================ */
+
+BodyPolicy	RequestHandler::bodyPolicy(const RawRequest &raw, int port) {
+	const RuntimeServer*	server = _findServer(port, raw);
+	BodyPolicy				policy;
+
+	policy.maxSize = 0;
+	policy.memoryLimit = 16 * 1024;
+	if (!server)
+		return (policy);
+	policy.memoryLimit = (size_t)server->config->clientBodyBufferSize;
+	policy.directory = server->config->clientBodyTempPath;
+	const RuntimeLocation*	loc = server->findLocation(raw.uri);
+	if (!loc)
+		return (policy);
+	if (loc->maxBodySize > 0)
+		policy.maxSize = (size_t)loc->maxBodySize;
+	if (!loc->allowUpload || loc->uploadStore.empty() || !loc->fastcgiPass.empty()
+	    || !loc->proxyPass.empty())
+		return (policy);
+	policy.directory = loc->uploadStore;
+	// Formulaire envoyé à une location d'upload pure : chaque fichier est
+	// écrit à part pendant la lecture (un CGI recevrait le corps brut)
+	std::map<std::string, std::string>::const_iterator	type = raw.headers.find("content-type");
+	if (type != raw.headers.end() && !loc->hasCGI()
+	    && httpStringToMethod(raw.method) == HTTP_METHOD_POST)
+		policy.boundary = MultipartParser::boundaryOf(type->second);
+	return (policy);
+}
+
+// Délais du vhost résolu d'après Host ; l'en-tête garde celui du port
+bool	RequestHandler::clientTimeouts(const RawRequest &raw, int port, ClientTimeouts &out) {
+	const RuntimeServer*	server = _findServer(port, raw);
+
+	if (!server)
+		return (false);
+	out.body = server->config->clientBodyTimeout;
+	out.send = server->config->sendTimeout;
+	out.minRate = server->config->sendMinRate;
+	return (true);
+}
+
+Response	RequestHandler::rejectRequest(const RawRequest &raw, int port, int code,
+                                          const std::string &message) {
+	ResponseBuilder	builder(_findServer(port, raw));
+	Response		resp = builder.buildError(code, message);
+	_setConnectionHeader(resp, false, 0);
+	return (resp);
+}
+
+Response	RequestHandler::_dispatch(const Request &request, const RuntimeServer* server) {
+	ResponseBuilder	builder(server);
 	if (!server)
 		return (builder.buildError(500, "Internal Server Error"));
-	builder = ResponseBuilder(server);
-	LocationConfig* loc = _findLocation(server, request.getUri());
+	const RuntimeLocation* loc = server->findLocation(request.getUri());
 	if (!loc)
 		return (builder.buildError(404, "Not Found"));
 	if (!loc->redirectUrl.empty()) {
@@ -297,14 +692,63 @@ Response	RequestHandler::handleRequest(const Request &request,
 		resp.setBody("");
 		return (resp);
 	}
-	std::string method = request.getMethod();
-	if (!_isMethodAllowed(loc, method))
+	int method = httpStringToMethod(request.getMethod());
+	if (!loc->allows(method))
 		return (builder.buildError(405, "Method Not Allowed"));
-	if (method == "GET")
+	if (!loc->caches() || method != HTTP_METHOD_GET || !ResponseCache::enabled())
+		return (_route(request, server, loc, method));
+	return (_serveCached(request, server, loc));
+}
+
+/*	============================================================================
+	Microcache (cache_valid) : une réponse fraîche, ou périmée pendant
+	qu'une autre requête la renouvelle, part du bloc partagé sans lancer
+	le script. Sinon le ticket suit le job jusqu'à finishCGI() ou la fin
+	du streaming, où la réponse est rangée si ses en-têtes le permettent.
+	============================================================================ */
+
+Response	RequestHandler::_serveCached(const Request &request, const RuntimeServer* server,
+                                         const RuntimeLocation* loc) {
+	CacheTicket	ticket;
+	ticket.key = ResponseCache::expand(loc->source->cacheKey, request);
+	for (int i = 0; i < request.getHeaderCount(); i++)
+		ticket.request[httpToLower(request.getHeaderKey(i))] = request.getHeaderValue(i);
+	for (size_t i = 0; i < loc->source->cacheBypass.size(); i++) {
+		std::string	value = ResponseCache::expand(loc->source->cacheBypass[i], request);
+		if (!value.empty() && value != "0")
+			ticket.status = CACHE_BYPASS;
+	}
+	if (ticket.status != CACHE_BYPASS) {
+		SharedBuffer	*cached = NULL;
+		int				code = 200;
+		ResponseCache::lookup(ticket, cached, code);
+		if (cached) {
+			ResponseBuilder	builder(server);
+			Response		resp = builder.buildCached(code, cached);
+			resp.setHeader("X-Cache-Status", ResponseCache::statusName(ticket.status));
+			return (resp);
+		}
+	}
+	Response	resp = _route(request, server, loc, HTTP_METHOD_GET);
+	if (resp.getCGIJob())
+		resp.getCGIJob()->cache = ticket;
+	else
+		ResponseCache::release(ticket);
+	return (resp);
+}
+
+Response	RequestHandler::_route(const Request &request, const RuntimeServer* server,
+                                   const RuntimeLocation* loc, int method) {
+	ResponseBuilder	builder(server);
+	if (!loc->fastcgiPass.empty())
+		return (_startFastCGI(request, server, loc, builder));
+	if (!loc->proxyPass.empty())
+		return (_startProxy(request, server, loc, builder));
+	if (method == HTTP_METHOD_GET)
 		return (_handleGET(request, server, loc));
-	else if (method == "POST")
+	else if (method == HTTP_METHOD_POST)
 		return (_handlePOST(request, server, loc));
-	else if (method == "DELETE")
+	else if (method == HTTP_METHOD_DELETE)
 		return (_handleDELETE(request, server, loc));
 	else
 		return (builder.buildError(405, "Method Not Allowed"));
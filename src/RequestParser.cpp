@@ -0,0 +1,410 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RequestParser.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 10:02:17 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 10:02:17 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/RequestParser.hpp"
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*	============================================================================
+		CONSTRUCTOR / RESET
+	============================================================================ */
+
+RequestParser::RequestParser() : _spoolFd(-1) {
+	reset();
+}
+
+RequestParser::~RequestParser() {
+	_discardSpool();
+}
+
+void	RequestParser::reset() {
+	_discardSpool();
+	_multipart.reset();
+	_state = PARSE_REQUEST_LINE;
+	_request = RawRequest();
+	_request.bodySize = 0;
+	_request.headerCount = 0;
+	_request.closeAfter = false;
+	_line.clear();
+	_remaining = 0;
+	_headerBytes = 0;
+	_started = false;
+	_error.clear();
+	_errorStatus = 400;
+	_policyReady = false;
+	_policy = BodyPolicy();
+	_policy.maxSize = 0;
+	_policy.memoryLimit = 0;
+}
+
+/*	============================================================================
+		ACCESSORS
+	============================================================================ */
+
+RequestParser::State	RequestParser::getState() const { return (_state); }
+bool	RequestParser::isComplete() const { return (_state == PARSE_COMPLETE); }
+bool	RequestParser::hasError() const { return (_state == PARSE_ERROR); }
+bool	RequestParser::hasStarted() const { return (_started); }
+bool	RequestParser::isReadingBody() const {
+	return (_state >= PARSE_BODY && _state <= PARSE_TRAILERS);
+}
+bool	RequestParser::needsBodyPolicy() const {
+	return (isReadingBody() && !_policyReady);
+}
+
+// RFC 7231 §5.1.1 : only HTTP/1.1 clients wait for the interim response
+bool	RequestParser::expectsContinue() const {
+	std::map<std::string, std::string>::const_iterator	it = _request.headers.find("expect");
+
+	return (it != _request.headers.end() && _request.version == "HTTP/1.1"
+	        && httpToLower(it->second) == "100-continue");
+}
+int	RequestParser::getErrorStatus() const { return (_errorStatus); }
+const std::string&	RequestParser::getError() const { return (_error); }
+RawRequest&	RequestParser::getRequest() { return (_request); }
+
+void	RequestParser::_fail(const std::string &msg, int status) {
+	_state = PARSE_ERROR;
+	_error = msg;
+	_errorStatus = status;
+}
+
+/*	============================================================================
+		LINE ACCUMULATION
+		Only the new slice is searched for '\n'; a partial line is kept in
+		_line until the next recv() completes it.
+	============================================================================ */
+
+size_t	RequestParser::_consumeLine(const char *data, size_t len, bool &lineReady) {
+	const char	*nl = static_cast<const char *>(std::memchr(data, '\n', len));
+	size_t		used = nl ? (size_t)(nl - data) + 1 : len;
+
+	lineReady = (nl != NULL);
+	_line.append(data, nl ? used - 1 : used);
+	if (_line.length() > PARSER_MAX_LINE) {
+		_fail("Line too long");
+		return (used);
+	}
+	if (lineReady && !_line.empty() && _line[_line.length() - 1] == '\r')
+		_line.erase(_line.length() - 1);
+	return (used);
+}
+
+void	RequestParser::_processLine() {
+	try {
+		switch (_state) {
+			case PARSE_REQUEST_LINE:
+				if (_line.empty())
+					return ;
+				HTTPParser::parseRequestLine(_line, _request);
+				_state = PARSE_HEADERS;
+				break ;
+			case PARSE_HEADERS:
+				_headerBytes += _line.length() + 2;
+				if (_line.empty()) {
+					_onHeadersComplete();
+					break ;
+				}
+				if (_request.headerCount >= PARSER_MAX_HEADERS)
+					return (_fail("Too many headers"));
+				HTTPParser::parseHeaderLine(_line, _request);
+				break ;
+			case PARSE_CHUNK_SIZE:
+				if (!HTTPParser::parseChunkSize(_line, _remaining))
+					return (_fail("Invalid chunk size: " + _line));
+				if (!_checkBodySize(_request.bodySize + _remaining))
+					return ;
+				_state = (_remaining == 0) ? PARSE_TRAILERS : PARSE_CHUNK_DATA;
+				break ;
+			case PARSE_CHUNK_CRLF:
+				if (!_line.empty())
+					return (_fail("Missing CRLF after chunk data"));
+				_state = PARSE_CHUNK_SIZE;
+				break ;
+			case PARSE_TRAILERS:
+				_headerBytes += _line.length() + 2;
+				if (!_line.empty())
+					return (_addTrailer());
+				// RFC 7230 §4.1.3 : the decoded body now has a known length
+				_request.headers.erase("transfer-encoding");
+				_request.headers["content-length"] = httpIntToString((long)_request.bodySize);
+				_request.headerCount = (int)_request.headers.size();
+				_finishBody();
+				break ;
+			default:
+				break ;
+		}
+	} catch (const RequestE &e) {
+		_fail(e.what());
+	}
+}
+
+/*	============================================================================
+		CHUNKED TRAILERS (RFC 7230 §4.1.2)
+		Merged into the headers without overriding them; fields that frame,
+		route or authenticate the message are dropped.
+	============================================================================ */
+
+static bool	isForbiddenTrailer(const std::string &name) {
+	static const char	*forbidden[] = {
+		"transfer-encoding", "content-length", "content-encoding", "content-type",
+		"content-range", "trailer", "host", "expect", "te", "range",
+		"authorization", "cookie", "cache-control", "max-forwards", NULL
+	};
+
+	for (size_t i = 0; forbidden[i]; i++) {
+		if (name == forbidden[i])
+			return (true);
+	}
+	return (false);
+}
+
+void	RequestParser::_addTrailer() {
+	RawRequest	trailer;
+
+	trailer.headerCount = 0;
+	trailer.closeAfter = false;
+	HTTPParser::parseHeaderLine(_line, trailer);
+	const std::pair<const std::string, std::string>	&field = *trailer.headers.begin();
+	if (isForbiddenTrailer(field.first) || _request.headers.count(field.first))
+		return ;
+	if (_request.headerCount >= PARSER_MAX_HEADERS)
+		return (_fail("Too many headers"));
+	_request.headers.insert(field);
+	_request.headerCount++;
+}
+
+/*	============================================================================
+		END OF HEADERS: choose body framing (RFC 9112 §6.1, §6.3)
+		A Transfer-Encoding must end with exactly "chunked" (400 otherwise:
+		the body length would be unknown) and carry no other coding, since
+		none is decoded here (501). It overrides Content-Length, but a
+		message carrying both may be a smuggling attempt, so the connection
+		is closed after the response.
+	============================================================================ */
+
+static std::string	trimCoding(const std::string &coding) {
+	size_t	start = coding.find_first_not_of(" \t");
+	size_t	end = coding.find_last_not_of(" \t");
+
+	if (start == std::string::npos)
+		return ("");
+	return (coding.substr(start, end - start + 1));
+}
+
+bool	RequestParser::_checkCodings(const std::string &value) {
+	std::string	codings = httpToLower(value);
+	size_t		pos = 0;
+	bool		unsupported = false;
+
+	while (true) {
+		size_t		comma = codings.find(',', pos);
+		std::string	coding = trimCoding(codings.substr(pos,
+		                         comma == std::string::npos ? std::string::npos : comma - pos));
+		if (comma == std::string::npos) {
+			if (coding != "chunked")
+				_fail("Transfer-Encoding does not end with chunked: " + value);
+			else if (unsupported)
+				_fail("Unsupported transfer coding: " + value, 501);
+			return (!hasError());
+		}
+		if (coding == "chunked") {
+			_fail("Transfer-Encoding applies chunked twice: " + value);
+			return (false);
+		}
+		if (!coding.empty())
+			unsupported = true;
+		pos = comma + 1;
+	}
+}
+
+void	RequestParser::_onHeadersComplete() {
+	std::map<std::string, std::string>::const_iterator	it;
+
+	it = _request.headers.find("transfer-encoding");
+	if (it != _request.headers.end()) {
+		if (!_checkCodings(it->second))
+			return ;
+		if (_request.headers.erase("content-length") || _request.version == "HTTP/1.0")
+			_request.closeAfter = true;
+		_state = PARSE_CHUNK_SIZE;
+		return ;
+	}
+	it = _request.headers.find("content-length");
+	if (it == _request.headers.end() || it->second.empty()) {
+		_state = PARSE_COMPLETE;
+		return ;
+	}
+	long	length;
+	if (!httpParseContentLength(it->second, length))
+		return (_fail("Invalid Content-Length: " + it->second));
+	_remaining = (size_t)length;
+	if (_remaining == 0) {
+		_state = PARSE_COMPLETE;
+		return ;
+	}
+	_state = PARSE_BODY;
+}
+
+/*	============================================================================
+		BODY POLICY AND SPOOLING
+		The caller picks the limits and the directory once the request line
+		and headers are known (an upload store keeps its temp file on the
+		same filesystem, so the final rename is atomic). A Content-Length
+		over max_body_size is refused before any body byte is read, one over
+		the memory limit skips memory altogether.
+	============================================================================ */
+
+void	RequestParser::setBodyPolicy(const BodyPolicy &policy) {
+	_policyReady = true;
+	_policy = policy;
+	if (_state == PARSE_BODY && !_checkBodySize(_remaining))
+		return ;
+	if (!_policy.boundary.empty()) {
+		_multipart.start(_policy.boundary, _policy.directory);
+		return ;
+	}
+	if (_state != PARSE_BODY)
+		return ;
+	if (_remaining > _policy.memoryLimit)
+		_openSpool();
+	else
+		_request.body.reserve(_remaining);
+}
+
+bool	RequestParser::_checkBodySize(size_t announced) {
+	if (_policy.maxSize == 0 || announced <= _policy.maxSize)
+		return (true);
+	_fail("Payload Too Large", 413);
+	return (false);
+}
+
+void	RequestParser::_appendBody(const char *data, size_t len) {
+	_request.bodySize += len;
+	if (_multipart.isActive()) {
+		if (!_multipart.feed(data, len))
+			_fail(_multipart.getError(), _multipart.getErrorStatus());
+		return ;
+	}
+	if (_spoolFd < 0 && _request.body.length() + len > _policy.memoryLimit && !_openSpool())
+		return ;
+	if (_spoolFd < 0)
+		_request.body.append(data, len);
+	else
+		_writeSpool(data, len);
+}
+
+// The bytes already buffered move to the file, memory is given back
+bool	RequestParser::_openSpool() {
+	std::string	path = _policy.directory.empty() ? "/tmp" : _policy.directory;
+
+	if (path[path.length() - 1] != '/')
+		path += '/';
+	path += ".webserv-body-XXXXXX";
+	std::vector<char>	name(path.begin(), path.end());
+	name.push_back('\0');
+	_spoolFd = mkstemp(&name[0]);
+	if (_spoolFd < 0) {
+		_fail("Cannot create request body file", 500);
+		return (false);
+	}
+	_spoolPath = &name[0];
+	fcntl(_spoolFd, F_SETFD, FD_CLOEXEC);
+	fchmod(_spoolFd, 0644);
+	if (!_writeSpool(_request.body.data(), _request.body.length()))
+		return (false);
+	std::string().swap(_request.body);
+	return (true);
+}
+
+bool	RequestParser::_writeSpool(const char *data, size_t len) {
+	while (len > 0) {
+		ssize_t	written = write(_spoolFd, data, len);
+		if (written <= 0) {
+			_fail("Cannot write request body file", 500);
+			return (false);
+		}
+		data += written;
+		len -= (size_t)written;
+	}
+	return (true);
+}
+
+// The parts are copied out but stay listed in _multipart: reset() removes
+// whatever temp file the handler did not move away
+void	RequestParser::_finishBody() {
+	if (_multipart.isActive()) {
+		if (!_multipart.finish())
+			return (_fail(_multipart.getError(), _multipart.getErrorStatus()));
+		_request.parts = _multipart.getParts();
+	}
+	_state = PARSE_COMPLETE;
+	if (_spoolFd < 0)
+		return ;
+	close(_spoolFd);
+	_spoolFd = -1;
+	_request.bodyFile = _spoolPath;
+}
+
+// No-op once the consumer has renamed the file away
+void	RequestParser::_discardSpool() {
+	if (_spoolFd >= 0)
+		close(_spoolFd);
+	_spoolFd = -1;
+	if (!_spoolPath.empty())
+		unlink(_spoolPath.c_str());
+	_spoolPath.clear();
+}
+
+/*	============================================================================
+		PUBLIC API: FEED
+		Returns the number of bytes consumed. Parsing stops right after a
+		complete request so pipelined bytes are left to the caller, and
+		before the first body byte until setBodyPolicy() has been called.
+	============================================================================ */
+
+size_t	RequestParser::feed(const char *data, size_t len) {
+	size_t	pos = 0;
+
+	if (len > 0)
+		_started = true;
+	while (pos < len && _state != PARSE_COMPLETE && _state != PARSE_ERROR) {
+		if (needsBodyPolicy())
+			break ;
+		if (_state == PARSE_BODY || _state == PARSE_CHUNK_DATA) {
+			size_t	n = len - pos;
+			if (n > _remaining)
+				n = _remaining;
+			_appendBody(data + pos, n);
+			_remaining -= n;
+			pos += n;
+			if (_state == PARSE_ERROR)
+				break ;
+			if (_remaining == 0 && _state == PARSE_BODY)
+				_finishBody();
+			else if (_remaining == 0)
+				_state = PARSE_CHUNK_CRLF;
+			continue ;
+		}
+		bool	lineReady;
+		pos += _consumeLine(data + pos, len - pos, lineReady);
+		if (_state == PARSE_ERROR || !lineReady)
+			break ;
+		_processLine();
+		_line.clear();
+		if (_headerBytes > PARSER_MAX_LINE * 4)
+			_fail("Header section too large");
+	}
+	return (pos);
+}
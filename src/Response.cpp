@@ -12,7 +12,9 @@
 
 #include "Response.hpp"
 
-Response::Response() : _version("HTTP/1.1"), _statusCode(0), _headerCount(0) {}
+Response::Response()
+	: _version("HTTP/1.1"), _statusCode(0), _headerCount(0), _bodyFd(-1), _bodyLength(0),
+	  _cgiJob(NULL), _cached(NULL) {}
 Response::~Response() {}
 
 void	Response::setVersion(const std::string &version) {
@@ -36,12 +38,30 @@ void	Response::setBody(const std::string &body) {
 	_body = body;
 }
 
+void	Response::setFileBody(int fd, long length) {
+	_body.clear();
+	_bodyFd = fd;
+	_bodyLength = length;
+}
+
+// Once a range is added, only the listed slices of the file are sent
+void	Response::addFileRange(const std::string &prefix, off_t offset, long length) {
+	FileRange	range;
+	range.prefix = prefix;
+	range.offset = offset;
+	range.length = length;
+	_bodyRanges.push_back(range);
+}
+
 RawResponse	Response::toRaw() const {
 	RawResponse	raw;
 	raw.version = _version;
 	raw.statusCode = _statusCode;
 	raw.statusMessage = _statusMessage;
 	raw.body = _body;
+	raw.bodyFd = _bodyFd;
+	raw.bodyLength = _bodyLength;
+	raw.bodyRanges = _bodyRanges;
 	for (int i = 0; i < _headerCount; i++) {
 		raw.headers[_headerKeys[i]] = _headerValues[i];
 	}
@@ -53,6 +73,36 @@ int	Response::getStatusCode() const {
 	return (_statusCode);
 }
 
+// Last value set wins, as in toRaw(); case-insensitive like Request::getHeader
+std::string	Response::getHeader(const std::string &key) const {
+	std::string	lowerKey = httpToLower(key);
+	for (int i = _headerCount - 1; i >= 0; i--) {
+		if (httpToLower(_headerKeys[i]) == lowerKey)
+			return (_headerValues[i]);
+	}
+	return ("");
+}
+
 std::string	Response::getBody() const {
 	return (_body);
 }
+
+int	Response::getBodyFd() const {
+	return (_bodyFd);
+}
+
+void	Response::setCGIJob(CGIJob *job) {
+	_cgiJob = job;
+}
+
+CGIJob*	Response::getCGIJob() const {
+	return (_cgiJob);
+}
+
+void	Response::setCached(SharedBuffer *cached) {
+	_cached = cached;
+}
+
+SharedBuffer*	Response::getCached() const {
+	return (_cached);
+}
@@ -16,57 +16,94 @@
 		CONSTRUCTEUR / DESTRUCTEUR
 	============================================================================ */
 
-ResponseBuilder::ResponseBuilder(ServerConfig* server) : _server(server) {}
+ResponseBuilder::ResponseBuilder(const RuntimeServer* server) : _server(server) {}
 ResponseBuilder::~ResponseBuilder() {}
 
 /*	============================================================================
-		HELPER: Charger page d'erreur personnalisée
+		PUBLIC API: Construire réponse de succès
 	============================================================================ */
 
-std::string	ResponseBuilder::_loadErrorPage(int code) {
-	if (!_server)
-		return ("");
-	if (_server->errorPages.find(code) != _server->errorPages.end()) {
-		std::string	errorPagePath = _server->errorPages[code];
-		std::string	fullPath = _server->root;
-		if (!fullPath.empty() && fullPath[fullPath.length() - 1] != '/')
-			fullPath += '/';
-		fullPath += errorPagePath;
-		if (FileHandler::exists(fullPath)) {
-			try {
-				return (FileHandler::getContent(fullPath));
-			} catch (...) {
-				// Fallback si erreur de lecture
-				return ("");
-			}
-		}
-	}
-	return ("");
+Response	ResponseBuilder::buildSuccess(int code, const std::string &body,
+										const std::string &mimeType) {
+	Response	resp;
+	resp.setVersion("HTTP/1.1");
+	resp.setStatus(code, httpStatusCodeToMessage(code));
+	resp.setHeader("Content-Type", mimeType);
+	resp.setHeader("Content-Length", httpIntToString(body.length()));
+	resp.setBody(body);
+	return (resp);
 }
 
 /*	============================================================================
-		PUBLIC API: Construire réponse de succès
+		PUBLIC API: Construire réponse dont le body est un fichier ouvert
+		Le fd est envoyé par la boucle principale (sendfile), pas copié ici
 	============================================================================ */
 
-Response	ResponseBuilder::buildSuccess(int code, const std::string &body,
+Response	ResponseBuilder::buildFile(int code, int fd, long size,
 										const std::string &mimeType) {
 	Response	resp;
 	resp.setVersion("HTTP/1.1");
 	resp.setStatus(code, httpStatusCodeToMessage(code));
 	resp.setHeader("Content-Type", mimeType);
-	resp.setHeader("Content-Length", httpIntToString(body.length()));
-	resp.setBody(body);
+	resp.setHeader("Content-Length", httpIntToString(size));
+	resp.setFileBody(fd, size);
+	return (resp);
+}
+
+/*	============================================================================
+		PUBLIC API: Réponse 206 : tranches du fichier envoyées depuis leur
+		offset. Une seule plage : Content-Range ; plusieurs : un corps
+		multipart/byteranges dont seules les en-têtes de parties sont en mémoire
+	============================================================================ */
+
+static std::string	contentRange(const HTTPRange &range, long size) {
+	return ("bytes " + httpIntToString(range.first) + "-" + httpIntToString(range.last)
+		+ "/" + httpIntToString(size));
+}
+
+Response	ResponseBuilder::buildRanges(int fd, const std::vector<HTTPRange> &ranges,
+										long size, const std::string &mimeType) {
+	static unsigned long	sequence = 0;
+	Response				resp;
+	resp.setVersion("HTTP/1.1");
+	resp.setStatus(HTTP_PARTIAL_CONTENT, httpStatusCodeToMessage(HTTP_PARTIAL_CONTENT));
+	if (ranges.size() == 1) {
+		long	length = ranges[0].last - ranges[0].first + 1;
+		resp.setHeader("Content-Type", mimeType);
+		resp.setHeader("Content-Range", contentRange(ranges[0], size));
+		resp.setHeader("Content-Length", httpIntToString(length));
+		resp.setFileBody(fd, length);
+		resp.addFileRange("", ranges[0].first, length);
+		return (resp);
+	}
+	std::string	boundary = "webserv" + httpSizeToHex((size_t)time(NULL))
+		+ httpSizeToHex(++sequence);
+	long		total = 0;
+	for (size_t i = 0; i < ranges.size(); i++) {
+		std::string	prefix = "\r\n--" + boundary + "\r\nContent-Type: " + mimeType
+			+ "\r\nContent-Range: " + contentRange(ranges[i], size) + "\r\n\r\n";
+		long		length = ranges[i].last - ranges[i].first + 1;
+		resp.addFileRange(prefix, ranges[i].first, length);
+		total += prefix.length() + length;
+	}
+	std::string	closing = "\r\n--" + boundary + "--\r\n";
+	resp.addFileRange(closing, 0, 0);
+	total += closing.length();
+	resp.setHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+	resp.setHeader("Content-Length", httpIntToString(total));
+	resp.setFileBody(fd, total);
 	return (resp);
 }
 
 /*	============================================================================
 		PUBLIC API: Construire réponse d'erreur
+		Les pages personnalisées sont chargées une fois au démarrage
 	============================================================================ */
 
 Response	ResponseBuilder::buildError(int code, const std::string &message) {
-	std::string	customBody = _loadErrorPage(code);
-	if (!customBody.empty())
-		return (buildSuccess(code, customBody, "text/html"));
+	SharedBuffer	*customPage = _server ? _server->errorPage(code) : NULL;
+	if (customPage)
+		return (buildCached(code, customPage));
 	RawResponse	raw = HTTPSerializer::createErrorResponse(code, message);
 	Response	resp;
 	resp.setVersion(raw.version);
@@ -78,3 +115,50 @@ Response	ResponseBuilder::buildError(int code, const std::string &message) {
 	resp.setBody(raw.body);
 	return (resp);
 }
+
+/*	============================================================================
+		PUBLIC API: Réponses pré-sérialisées (ContentCache, pages d'erreur)
+		Le bloc contient la tête sans les lignes Connection ni la ligne
+		vide finale, puis le corps : la boucle complète la tête par requête.
+	============================================================================ */
+
+SharedBuffer	*ResponseBuilder::serialize(const Response &head, const std::string &body) {
+	Response	resp = head;
+	resp.setHeader("Content-Length", httpIntToString(body.length()));
+	std::string	block = HTTPSerializer::serializeHead(resp.toRaw());
+	block.erase(block.length() - 2);
+	size_t		split = block.length();
+	block += body;
+	return (SharedBuffer::adopt(block, split));
+}
+
+Response	ResponseBuilder::buildCached(int code, SharedBuffer *cached) {
+	Response	resp;
+	resp.setVersion("HTTP/1.1");
+	resp.setStatus(code, httpStatusCodeToMessage(code));
+	resp.setCached(cached);
+	return (resp);
+}
+
+/*	============================================================================
+		PUBLIC API: Validateurs de cache (ETag, Last-Modified) et 304
+		L'ETag dérive du stat() : inode, taille et date de modification
+	============================================================================ */
+
+std::string	ResponseBuilder::etag(const FileInfo &info) {
+	return ("\"" + httpSizeToHex((size_t)info.inode) + "-" + httpSizeToHex((size_t)info.size)
+		+ "-" + httpSizeToHex((size_t)info.mtime) + "\"");
+}
+
+void	ResponseBuilder::setValidators(Response &resp, const FileInfo &info) {
+	resp.setHeader("ETag", etag(info));
+	resp.setHeader("Last-Modified", httpFormatDate(info.mtime));
+}
+
+Response	ResponseBuilder::buildNotModified(const FileInfo &info) {
+	Response	resp;
+	resp.setVersion("HTTP/1.1");
+	resp.setStatus(HTTP_NOT_MODIFIED, httpStatusCodeToMessage(HTTP_NOT_MODIFIED));
+	setValidators(resp, info);
+	return (resp);
+}
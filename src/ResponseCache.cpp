@@ -0,0 +1,386 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ResponseCache.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 17:42:08 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 17:42:08 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ResponseCache.hpp"
+#include "../inc/HTTPCommon.hpp"
+#include "../inc/HTTPSerializer.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdlib>
+#include <cctype>
+#include <sys/stat.h>
+
+ResponseCache::EntryList	ResponseCache::_memory;
+ResponseCache::EntryList	ResponseCache::_disk;
+ResponseCache::EntryIndex	ResponseCache::_index;
+std::map<std::string, std::vector<std::string> >	ResponseCache::_vary;
+std::map<std::string, time_t>						ResponseCache::_updating;
+size_t						ResponseCache::_bytes = 0;
+size_t						ResponseCache::_maxBytes = 0;
+size_t						ResponseCache::_maxEntry = 0;
+std::string					ResponseCache::_path;
+size_t						ResponseCache::_diskBytes = 0;
+size_t						ResponseCache::_maxDisk = 0;
+unsigned long				ResponseCache::_fileCounter = 0;
+
+CacheTicket::CacheTicket()
+	: status(CACHE_MISS), storing(false), code(0), expires(0), staleUntil(0) {
+}
+
+/*	============================================================================
+		KEYS AND VARIABLES
+		cache_key and cache_bypass use nginx-style variables: $host,
+		$request_uri, $uri, $args, $request_method, $http_<header>,
+		$arg_<name> and $cookie_<name>. Unknown ones expand to "".
+	============================================================================ */
+
+// "a=1&b=2" or "a=1; b=2": value of name, "" if absent
+static std::string	findPair(const std::string &list, const std::string &name, char separator) {
+	size_t	pos = 0;
+
+	while (pos <= list.length()) {
+		size_t	end = list.find(separator, pos);
+		if (end == std::string::npos)
+			end = list.length();
+		size_t	start = list.find_first_not_of(' ', pos);
+		size_t	equal = list.find('=', start);
+		if (start < end && equal < end && list.compare(start, equal - start, name) == 0
+		    && equal - start == name.length())
+			return (list.substr(equal + 1, end - equal - 1));
+		pos = end + 1;
+	}
+	return ("");
+}
+
+std::string	ResponseCache::_variable(const std::string &name, const Request &request) {
+	std::string	uri = request.getUri();
+	size_t		query = uri.find('?');
+	std::string	args = (query == std::string::npos) ? "" : uri.substr(query + 1);
+
+	if (name == "host")
+		return (httpToLower(request.getHeader("host")));
+	if (name == "request_uri")
+		return (uri);
+	if (name == "uri")
+		return (uri.substr(0, query));
+	if (name == "args")
+		return (args);
+	if (name == "request_method")
+		return (request.getMethod());
+	if (name.compare(0, 4, "arg_") == 0)
+		return (findPair(args, name.substr(4), '&'));
+	if (name.compare(0, 7, "cookie_") == 0)
+		return (findPair(request.getHeader("cookie"), name.substr(7), ';'));
+	if (name.compare(0, 5, "http_") == 0) {
+		std::string	header = name.substr(5);
+		for (size_t i = 0; i < header.length(); i++) {
+			if (header[i] == '_')
+				header[i] = '-';
+		}
+		return (request.getHeader(header));
+	}
+	return ("");
+}
+
+std::string	ResponseCache::expand(const std::string &pattern, const Request &request) {
+	std::string	out;
+
+	for (size_t i = 0; i < pattern.length(); ) {
+		if (pattern[i] != '$') {
+			out += pattern[i++];
+			continue ;
+		}
+		size_t	end = i + 1;
+		while (end < pattern.length() && (std::isalnum(pattern[end]) || pattern[end] == '_'))
+			end++;
+		out += _variable(pattern.substr(i + 1, end - i - 1), request);
+		i = end;
+	}
+	return (out);
+}
+
+// Accept-Encoding only matters as "gzip or not": one variant each, not
+// one per spelling of the header
+std::string	ResponseCache::_variantKey(const std::string &key,
+                                       const std::map<std::string, std::string> &request) {
+	std::map<std::string, std::vector<std::string> >::const_iterator	vary = _vary.find(key);
+
+	if (vary == _vary.end())
+		return (key);
+	std::string	variant = key;
+	for (size_t i = 0; i < vary->second.size(); i++) {
+		const std::string	&name = vary->second[i];
+		std::map<std::string, std::string>::const_iterator	value = request.find(name);
+		std::string	text = (value == request.end()) ? "" : value->second;
+		if (name == "accept-encoding")
+			text = httpAcceptsEncoding(text, "gzip") ? "gzip" : "";
+		variant += "\n" + name + ":" + text;
+	}
+	return (variant);
+}
+
+/*	============================================================================
+		STORAGE TIERS
+		_memory and _disk are both most-recent-first; entries move between
+		them with splice(), so _index iterators stay valid. Disk files are
+		named after the worker's pid: workers never share a file.
+	============================================================================ */
+
+void	ResponseCache::_drop(EntryList::iterator it) {
+	_index.erase(it->key);
+	if (it->buffer) {
+		_bytes -= it->size;
+		it->buffer->release();
+		_memory.erase(it);
+		return ;
+	}
+	_diskBytes -= it->size;
+	unlink(it->file.c_str());
+	_disk.erase(it);
+}
+
+bool	ResponseCache::_spill(EntryList::iterator it) {
+	if (_path.empty() || it->size > _maxDisk)
+		return (false);
+	std::string	file = _path + "/webserv-" + httpIntToString(getpid()) + "-"
+		+ httpIntToString(++_fileCounter);
+	int			fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return (false);
+	const std::string	&data = it->buffer->data();
+	bool				written = (write(fd, data.data(), data.size()) == (ssize_t)data.size());
+	close(fd);
+	if (!written) {
+		unlink(file.c_str());
+		return (false);
+	}
+	while (_diskBytes + it->size > _maxDisk)
+		_drop(--_disk.end());
+	_bytes -= it->size;
+	it->buffer->release();
+	it->buffer = NULL;
+	it->file = file;
+	_diskBytes += it->size;
+	_disk.splice(_disk.begin(), _memory, it);
+	return (true);
+}
+
+void	ResponseCache::_evict() {
+	while (_bytes > _maxBytes && !_memory.empty()) {
+		EntryList::iterator	last = --_memory.end();
+		if (!_spill(last))
+			_drop(last);
+	}
+}
+
+// Back to memory on a hit; the file goes away, the block is in RAM again
+bool	ResponseCache::_load(EntryList::iterator it) {
+	std::string	data;
+	int			fd = open(it->file.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (fd >= 0) {
+		data.resize(it->size);
+		ssize_t	got = read(fd, &data[0], it->size);
+		close(fd);
+		if (got != (ssize_t)it->size)
+			fd = -1;
+	}
+	if (fd < 0) {
+		_drop(it);
+		return (false);
+	}
+	unlink(it->file.c_str());
+	it->file.clear();
+	_diskBytes -= it->size;
+	it->buffer = SharedBuffer::adopt(data, it->split);
+	_bytes += it->size;
+	_memory.splice(_memory.begin(), _disk, it);
+	_evict();
+	return (true);
+}
+
+/*	============================================================================
+		PUBLIC API
+	============================================================================ */
+
+void	ResponseCache::configure(size_t maxBytes, size_t maxEntry,
+                                 const std::string &path, size_t maxDisk) {
+	clear();
+	_maxBytes = maxBytes;
+	_maxEntry = (maxEntry > maxBytes) ? maxBytes : maxEntry;
+	_path = path;
+	_maxDisk = maxDisk;
+	if (!_path.empty())
+		mkdir(_path.c_str(), 0700);
+}
+
+bool	ResponseCache::enabled() {
+	return (_maxBytes > 0);
+}
+
+// The returned buffer is borrowed: retain() it to keep it past the call
+int	ResponseCache::lookup(CacheTicket &ticket, SharedBuffer *&buffer, int &code) {
+	std::string				variant = _variantKey(ticket.key, ticket.request);
+	EntryIndex::iterator	found = _index.find(variant);
+	time_t					now = time(NULL);
+
+	buffer = NULL;
+	ticket.status = CACHE_MISS;
+	if (found == _index.end() || (!found->second->buffer && !_load(found->second)))
+		return (ticket.status);
+	EntryList::iterator	it = found->second;
+	if (it != _memory.begin())
+		_memory.splice(_memory.begin(), _memory, it);
+	if (now < it->expires)
+		ticket.status = CACHE_HIT;
+	else {
+		std::map<std::string, time_t>::iterator	update = _updating.find(variant);
+		if (update != _updating.end() && update->second > now
+		    && (it->staleUntil == 0 || now < it->staleUntil))
+			ticket.status = CACHE_STALE;
+		else {
+			_updating[variant] = now + RESPONSE_CACHE_LOCK;
+			ticket.locked = variant;
+			ticket.status = CACHE_EXPIRED;
+			return (ticket.status);
+		}
+	}
+	buffer = it->buffer;
+	code = it->code;
+	return (ticket.status);
+}
+
+// Decides from the response head whether it may be stored, and for how
+// long: Cache-Control (s-maxage, max-age, no-store, private, no-cache)
+// wins over cache_valid; Set-Cookie and "Vary: *" are never stored
+bool	ResponseCache::prepare(CacheTicket &ticket, const Response &resp,
+                               const std::map<int, long> &valid) {
+	std::map<int, long>::const_iterator	rule = valid.find(resp.getStatusCode());
+	if (rule == valid.end())
+		rule = valid.find(0);
+	if (ticket.key.empty() || rule == valid.end() || !resp.getHeader("Set-Cookie").empty())
+		return (false);
+	long		ttl = rule->second;
+	long		stale = -1;
+	std::string	control = httpToLower(resp.getHeader("Cache-Control"));
+	if (control.find("no-store") != std::string::npos || control.find("private") != std::string::npos
+	    || control.find("no-cache") != std::string::npos)
+		return (false);
+	size_t	maxAge = control.find("s-maxage=");
+	if (maxAge == std::string::npos)
+		maxAge = control.find("max-age=");
+	if (maxAge != std::string::npos)
+		ttl = std::atol(control.c_str() + control.find('=', maxAge) + 1);
+	size_t	swr = control.find("stale-while-revalidate=");
+	if (swr != std::string::npos)
+		stale = std::atol(control.c_str() + swr + 23);
+	std::string	vary = httpToLower(resp.getHeader("Vary"));
+	if (ttl <= 0 || vary.find('*') != std::string::npos)
+		return (false);
+	ticket.vary.clear();
+	for (size_t pos = 0; pos < vary.length(); ) {
+		size_t	end = vary.find(',', pos);
+		if (end == std::string::npos)
+			end = vary.length();
+		size_t	start = vary.find_first_not_of(" \t", pos);
+		size_t	last = vary.find_last_not_of(" \t", end - 1);
+		if (start < end && last != std::string::npos && last >= start)
+			ticket.vary.push_back(vary.substr(start, last - start + 1));
+		pos = end + 1;
+	}
+	RawResponse	raw = resp.toRaw();
+	raw.headers.erase("Content-Length");
+	raw.headers.erase("Transfer-Encoding");
+	raw.headers.erase("Connection");
+	raw.headers.erase("Keep-Alive");
+	raw.headers.erase("X-Cache-Status");
+	ticket.head = HTTPSerializer::serializeHead(raw);
+	ticket.head.erase(ticket.head.length() - 2);
+	ticket.code = resp.getStatusCode();
+	ticket.expires = time(NULL) + ttl;
+	ticket.staleUntil = (stale >= 0) ? ticket.expires + stale : 0;
+	ticket.body.clear();
+	ticket.storing = true;
+	return (true);
+}
+
+// Streamed body: collection stops once the entry could no longer fit
+void	ResponseCache::collect(CacheTicket &ticket, const std::string &data) {
+	if (!ticket.storing)
+		return ;
+	if (ticket.head.length() + ticket.body.length() + data.length() > _maxEntry) {
+		ticket.storing = false;
+		std::string().swap(ticket.body);
+		return ;
+	}
+	ticket.body += data;
+}
+
+// Files the collected response under the variant its Vary asks for
+void	ResponseCache::store(CacheTicket &ticket) {
+	size_t	size = ticket.head.length() + ticket.body.length() + 32;
+
+	if (!enabled() || !ticket.storing || size > _maxEntry) {
+		ticket.storing = false;
+		release(ticket);
+		return ;
+	}
+	if (ticket.vary.empty())
+		_vary.erase(ticket.key);
+	else
+		_vary[ticket.key] = ticket.vary;
+	std::string	variant = _variantKey(ticket.key, ticket.request);
+	EntryIndex::iterator	found = _index.find(variant);
+	if (found != _index.end())
+		_drop(found->second);
+	std::string	block;
+	block.swap(ticket.head);
+	block += "Content-Length: " + httpIntToString(ticket.body.length()) + "\r\n";
+	Entry	entry;
+	entry.key = variant;
+	entry.code = ticket.code;
+	entry.expires = ticket.expires;
+	entry.staleUntil = ticket.staleUntil;
+	entry.split = block.length();
+	block += ticket.body;
+	std::string().swap(ticket.body);
+	entry.size = block.length();
+	entry.buffer = SharedBuffer::adopt(block, entry.split);
+	_memory.push_front(entry);
+	_index[variant] = _memory.begin();
+	_bytes += entry.size;
+	_evict();
+	ticket.storing = false;
+	release(ticket);
+}
+
+void	ResponseCache::release(CacheTicket &ticket) {
+	if (ticket.locked.empty())
+		return ;
+	_updating.erase(ticket.locked);
+	ticket.locked.clear();
+}
+
+const char	*ResponseCache::statusName(int status) {
+	static const char	*names[] = { "MISS", "BYPASS", "EXPIRED", "STALE", "HIT" };
+
+	return (names[status]);
+}
+
+void	ResponseCache::clear() {
+	while (!_memory.empty())
+		_drop(_memory.begin());
+	while (!_disk.empty())
+		_drop(_disk.begin());
+	_vary.clear();
+	_updating.clear();
+}
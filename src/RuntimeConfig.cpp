@@ -0,0 +1,148 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   RuntimeConfig.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 17:20:08 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 17:20:08 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/RuntimeConfig.hpp"
+#include "../inc/HTTPCommon.hpp"
+#include "../inc/FileHandler.hpp"
+#include "../inc/ResponseBuilder.hpp"
+#include <unistd.h>
+#include <climits>
+#include <cstdlib>
+
+/*	============================================================================
+	LOOKUPS (request path)
+	============================================================================ */
+
+bool	RuntimeLocation::allows(int method) const {
+	return (method != HTTP_METHOD_UNKNOWN && (methods & METHOD_BIT(method)));
+}
+
+bool	RuntimeLocation::hasCGI() const {
+	return (!source->cgiHandlers.empty());
+}
+
+// cache_valid set: dynamic responses go through the ResponseCache
+bool	RuntimeLocation::caches() const {
+	return (!source->cacheValid.empty());
+}
+
+// "gzip" policy: content type without parameters, length -1 when unknown
+bool	RuntimeLocation::compresses(const std::string &contentType, long length) const {
+	if (!gzip || (length >= 0 && length < gzipMinLength))
+		return (false);
+	std::string	type = httpToLower(contentType.substr(0, contentType.find(';')));
+	size_t		end = type.find_last_not_of(" \t");
+	type.erase(end == std::string::npos ? 0 : end + 1);
+	return (gzipTypes.count(type) || gzipTypes.count("*"));
+}
+
+const RuntimeLocation*	RuntimeServer::findLocation(const std::string &uri) const {
+	int	index = router.lookup(uri);
+
+	if (index < 0)
+		return (NULL);
+	return (&locations[index]);
+}
+
+SharedBuffer*	RuntimeServer::errorPage(int code) const {
+	std::map<int, SharedBuffer*>::const_iterator	it = errorPages.find(code);
+
+	if (it == errorPages.end())
+		return (NULL);
+	return (it->second);
+}
+
+/*	============================================================================
+	COMPILATION (startup only)
+	============================================================================ */
+
+// Relative paths are anchored to the working directory the server starts in
+std::string	RuntimeConfig::_absoluteDir(const std::string &path) {
+	std::string	dir = path;
+
+	if (dir.empty() || dir[0] != '/') {
+		char	cwd[PATH_MAX];
+		if (getcwd(cwd, sizeof(cwd)))
+			dir = std::string(cwd) + "/" + dir;
+	}
+	if (dir[dir.length() - 1] != '/')
+		dir += '/';
+	return (FileHandler::normalizePath(dir));
+}
+
+std::string	RuntimeConfig::_readErrorPage(const std::string &root, const std::string &page) {
+	std::string	path = root + page;
+
+	if (!FileHandler::exists(path) || FileHandler::isDirectory(path))
+		return ("");
+	try {
+		return (FileHandler::getContent(path));
+	} catch (...) {
+		return ("");
+	}
+}
+
+RuntimeServer	RuntimeConfig::compile(ServerConfig &server) {
+	RuntimeServer	rt;
+	std::string		serverRoot = _absoluteDir(server.root);
+
+	rt.config = &server;
+	for (size_t i = 0; i < server.locations.size(); i++) {
+		const LocationConfig	&loc = server.locations[i];
+		RuntimeLocation			out;
+		out.source = &loc;
+		out.path = loc.path;
+		out.methods = 0;
+		for (size_t j = 0; j < loc.allowedMethods.size(); j++) {
+			int method = httpStringToMethod(loc.allowedMethods[j]);
+			if (method != HTTP_METHOD_UNKNOWN)
+				out.methods |= METHOD_BIT(method);
+		}
+		out.root = loc.root.empty() ? serverRoot : _absoluteDir(loc.root);
+		out.index = loc.index;
+		out.autoIndex = loc.autoIndex;
+		out.redirectUrl = loc.redirectUrl;
+		out.allowUpload = loc.allowUpload;
+		if (!loc.uploadStore.empty())
+			out.uploadStore = _absoluteDir(loc.uploadStore);
+		out.fastcgiPass = loc.fastcgiPass;
+		out.proxyPass = loc.proxyPass;
+		out.proxyUri = loc.proxyUri;
+		out.expires = loc.expires;
+		out.cacheControl = loc.cacheControl;
+		out.gzipStatic = loc.gzipStatic;
+		out.gzip = loc.gzip;
+		out.gzipTypes.insert(loc.gzipTypes.begin(), loc.gzipTypes.end());
+		out.gzipTypes.insert("text/html");
+		out.gzipMinLength = loc.gzipMinLength;
+		out.gzipLevel = loc.gzipLevel;
+		out.maxBodySize = loc.maxBodySize >= 0 ? loc.maxBodySize : server.maxBodySize;
+		rt.locations.push_back(out);
+		rt.router.insert(loc.path, loc.exactMatch, (int)i);
+	}
+	for (std::map<int, std::string>::const_iterator it = server.errorPages.begin();
+	     it != server.errorPages.end(); ++it) {
+		std::string	body = _readErrorPage(serverRoot, it->second);
+		if (!body.empty())
+			rt.errorPages[it->first] = ResponseBuilder::serialize(
+				ResponseBuilder(NULL).buildSuccess(it->first, "", "text/html"), body);
+	}
+	return (rt);
+}
+
+// Copies of a RuntimeServer share its error pages: released once, by the owner
+void	RuntimeConfig::release(RuntimeServer &server) {
+	for (std::map<int, SharedBuffer*>::iterator it = server.errorPages.begin();
+	     it != server.errorPages.end(); ++it)
+		it->second->release();
+	server.errorPages.clear();
+}
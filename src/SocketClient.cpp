@@ -2,9 +2,17 @@
 #include <unistd.h>
 #include <fcntl.h>
 
-SocketClient::SocketClient(int fd, struct sockaddr_in addr) : ASocket(0, "") { // Initialiser _state ici
+SocketClient::SocketClient(int fd, struct sockaddr_in addr)
+	: ASocket(0, ""), _keepAlive(false), _keepAliveTimeout(0), _requestCount(0),
+	  _cgiJob(NULL), _phase(PHASE_NONE), _progress(0), _lingering(false),
+	  _interim(false) {
 	this->_fd = fd;
 	this->_addr = addr;
+	_timeouts.header = 0;
+	_timeouts.body = 0;
+	_timeouts.send = 0;
+	_timeouts.minRate = 0;
+	_timer.owner = fd;
 }
 
 SocketClient::~SocketClient() {
@@ -28,6 +36,8 @@ void SocketClient::setNonBlocking() {
 			return;
 		}
 		fcntl(this->_fd, F_SETFL, flags | O_NONBLOCK);
+		// Les CGI ne doivent pas hériter des connexions clientes
+		fcntl(this->_fd, F_SETFD, FD_CLOEXEC);
 	}
 }
 
@@ -39,6 +49,11 @@ ssize_t SocketClient::recvData(void* buf, size_t len) {
 	return recv(_fd, buf, len, 0);
 }
 
+// Un seul appel système (writev ou sendfile) par évènement d'écriture
+ssize_t SocketClient::flushOutput() {
+	return _output.flush(_fd);
+}
+
 bool SocketClient::isConnected() const {
 	return this->isOpen();
 }
@@ -47,6 +62,99 @@ std::string& SocketClient::getRequestBuffer() {
 	return _requestBuffer;
 }
 
-std::string& SocketClient::getResponseBuffer() {
-	return _responseBuffer;
+bool SocketClient::hasPendingOutput() const {
+	return (!_output.empty());
+}
+
+OutputQueue& SocketClient::getOutput() {
+	return _output;
+}
+
+RequestParser& SocketClient::getParser() {
+	return _parser;
+}
+
+// ============ KEEP-ALIVE ============
+
+void SocketClient::setKeepAlive(bool keepAlive, int timeout) {
+	_keepAlive = keepAlive;
+	_keepAliveTimeout = timeout;
+}
+
+bool SocketClient::isKeepAlive() const {
+	return _keepAlive;
+}
+
+int SocketClient::getKeepAliveTimeout() const {
+	return _keepAliveTimeout;
+}
+
+// Réponse partie, écriture fermée : on ne fait plus que vider la lecture
+void SocketClient::startLingering() {
+	shutdown(_fd, SHUT_WR);
+	_lingering = true;
+}
+
+bool SocketClient::isLingering() const {
+	return _lingering;
+}
+
+void SocketClient::setInterim(bool interim) {
+	_interim = interim;
+}
+
+bool SocketClient::hasInterim() const {
+	return _interim;
+}
+
+int SocketClient::getRequestCount() const {
+	return _requestCount;
+}
+
+void SocketClient::countRequest() {
+	_requestCount++;
+}
+
+// ============ TIMEOUTS ============
+
+Timer& SocketClient::getTimer() {
+	return _timer;
+}
+
+int SocketClient::getPhase() const {
+	return _phase;
+}
+
+void SocketClient::setPhase(int phase) {
+	_phase = phase;
+}
+
+// Octets reçus ou envoyés depuis le dernier contrôle de l'échéance
+void SocketClient::addProgress(size_t bytes) {
+	_progress += bytes;
+}
+
+size_t SocketClient::takeProgress() {
+	size_t bytes = _progress;
+	_progress = 0;
+	return bytes;
+}
+
+// Délais du vhost de la requête en cours (voir server::_resolveTimeouts)
+void SocketClient::setTimeouts(const ClientTimeouts& timeouts) {
+	_timeouts = timeouts;
+}
+
+const ClientTimeouts& SocketClient::getTimeouts() const {
+	return _timeouts;
+}
+
+// ============ CGI ============
+
+void SocketClient::setCGIJob(CGIJob* job) {
+	_cgiJob = job;
+}
+
+CGIJob* SocketClient::getCGIJob() const {
+	return _cgiJob;
 }
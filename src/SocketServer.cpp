@@ -31,6 +31,7 @@ void	SocketServer::setNonBlocking() {
 	int flags = fcntl(_fd, F_GETFL, 0);
 		if (flags == -1 || fcntl(_fd, F_SETFL, flags | O_NONBLOCK) == -1)
 			throw socketException("Error: fcntl");
+	fcntl(_fd, F_SETFD, FD_CLOEXEC);
 }
 
 void	SocketServer::bindSocket() {
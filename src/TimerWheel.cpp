@@ -0,0 +1,165 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 15:32:47 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 15:32:47 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/TimerWheel.hpp"
+#include <sys/time.h>
+
+Timer::Timer() : prev(NULL), next(NULL), expires(0), active(false), owner(-1), kind(0) {
+}
+
+/*	============================================================================
+	LISTES INTRUSIVES (têtes circulaires)
+	============================================================================ */
+
+void	TimerWheel::_link(Timer &head, Timer &timer) {
+	timer.prev = head.prev;
+	timer.next = &head;
+	head.prev->next = &timer;
+	head.prev = &timer;
+}
+
+void	TimerWheel::_unlink(Timer &timer) {
+	timer.prev->next = timer.next;
+	timer.next->prev = timer.prev;
+	timer.prev = NULL;
+	timer.next = NULL;
+}
+
+TimerWheel::TimerWheel() : _tick(nowMs() / TIMER_TICK_MS), _count(0) {
+	for (int level = 0; level < TIMER_LEVELS; level++) {
+		for (int i = 0; i < TIMER_SLOTS; i++) {
+			_slots[level][i].prev = &_slots[level][i];
+			_slots[level][i].next = &_slots[level][i];
+		}
+	}
+	_due.prev = &_due;
+	_due.next = &_due;
+}
+
+// Les Timer appartiennent à leurs propriétaires, qui les annulent avant
+// d'être détruits : la roue n'a rien à libérer
+TimerWheel::~TimerWheel() {
+}
+
+/*	============================================================================
+	PLACEMENT : le niveau dépend de la distance à l'échéance
+	============================================================================ */
+
+void	TimerWheel::_insert(Timer &timer) {
+	if (timer.expires < _tick) {
+		_link(_slots[0][_tick & (TIMER_SLOTS - 1)], timer);
+		return;
+	}
+	unsigned long	delta = timer.expires - _tick;
+	int				level = 0;
+	while (level < TIMER_LEVELS - 1
+	       && delta >= (1UL << (TIMER_LEVEL_BITS * (level + 1))))
+		level++;
+	if (delta >= (1UL << (TIMER_LEVEL_BITS * TIMER_LEVELS)))
+		timer.expires = _tick + (1UL << (TIMER_LEVEL_BITS * TIMER_LEVELS)) - 1;
+	int index = (timer.expires >> (TIMER_LEVEL_BITS * level)) & (TIMER_SLOTS - 1);
+	_link(_slots[level][index], timer);
+}
+
+void	TimerWheel::schedule(Timer &timer, unsigned long delayMs) {
+	cancel(timer);
+	if (_count == 0 && _due.next == &_due)
+		_tick = nowMs() / TIMER_TICK_MS;
+	unsigned long	ticks = (delayMs + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+	timer.expires = nowMs() / TIMER_TICK_MS + (ticks ? ticks : 1);
+	timer.active = true;
+	_insert(timer);
+	_count++;
+}
+
+void	TimerWheel::cancel(Timer &timer) {
+	if (!timer.active)
+		return;
+	_unlink(timer);
+	timer.active = false;
+	_count--;
+}
+
+/*	============================================================================
+	AVANCE : traite chaque tick écoulé depuis le dernier appel
+	============================================================================ */
+
+void	TimerWheel::_cascade(int level, int index) {
+	Timer	&head = _slots[level][index];
+
+	while (head.next != &head) {
+		Timer *timer = head.next;
+		_unlink(*timer);
+		_insert(*timer);
+	}
+}
+
+void	TimerWheel::advance(unsigned long nowMs) {
+	unsigned long	target = nowMs / TIMER_TICK_MS;
+
+	while (_tick <= target) {
+		int index = _tick & (TIMER_SLOTS - 1);
+		for (int level = 1; index == 0 && level < TIMER_LEVELS; level++) {
+			index = (_tick >> (TIMER_LEVEL_BITS * level)) & (TIMER_SLOTS - 1);
+			_cascade(level, index);
+		}
+		Timer &slot = _slots[0][_tick & (TIMER_SLOTS - 1)];
+		while (slot.next != &slot) {
+			Timer *timer = slot.next;
+			_unlink(*timer);
+			_link(_due, *timer);
+		}
+		_tick++;
+		if (_count == 0)
+			_tick = target + 1;
+	}
+}
+
+Timer*	TimerWheel::popDue() {
+	if (_due.next == &_due)
+		return (NULL);
+	Timer	*timer = _due.next;
+	cancel(*timer);
+	return (timer);
+}
+
+/*	============================================================================
+	PROCHAINE ÉCHÉANCE (timeout du poller)
+	Au plus 64 cases du niveau 0 examinées ; au-delà, on se réveille à la
+	prochaine cascade, qui peut rapprocher un timer des niveaux supérieurs.
+	============================================================================ */
+
+long	TimerWheel::nextTimeout(unsigned long nowMs) const {
+	if (_count == 0)
+		return (-1);
+	if (_due.next != &_due)
+		return (0);
+	unsigned long	tick = _tick;
+	for (int i = 0; i < TIMER_SLOTS; i++, tick++) {
+		const Timer &slot = _slots[0][tick & (TIMER_SLOTS - 1)];
+		if (slot.next != &slot || (i > 0 && (tick & (TIMER_SLOTS - 1)) == 0))
+			break;
+	}
+	unsigned long	dueMs = tick * TIMER_TICK_MS;
+	return (dueMs > nowMs ? (long)(dueMs - nowMs) : 0);
+}
+
+size_t	TimerWheel::size() const {
+	return (_count);
+}
+
+unsigned long	TimerWheel::nowMs() {
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+	return ((unsigned long)tv.tv_sec * 1000UL + tv.tv_usec / 1000);
+}
@@ -0,0 +1,237 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHostIndex.cpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: dinguyen <dinguyen@student.42lausanne.c    +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2026/10/17 16:41:30 by dinguyen          #+#    #+#             */
+/*   Updated: 2026/10/17 16:41:30 by dinguyen         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/VirtualHostIndex.hpp"
+#include <cctype>
+
+VirtualHostIndex::VirtualHostIndex() {}
+VirtualHostIndex::~VirtualHostIndex() {}
+
+/*	============================================================================
+	HASH TABLES (separate chaining, keys stored lowercased)
+	============================================================================ */
+
+unsigned long	VirtualHostIndex::_hash(unsigned long salt, const char *data, size_t len) {
+	unsigned long	h = 2166136261UL;
+
+	for (size_t i = 0; i < sizeof(salt); i++) {
+		h ^= (salt >> (i * 8)) & 0xff;
+		h *= 16777619UL;
+	}
+	for (size_t i = 0; i < len; i++) {
+		h ^= (unsigned char)std::tolower((unsigned char)data[i]);
+		h *= 16777619UL;
+	}
+	return (h);
+}
+
+bool	VirtualHostIndex::_equals(const std::string &key, const char *data, size_t len) {
+	if (key.length() != len)
+		return (false);
+	for (size_t i = 0; i < len; i++) {
+		if (key[i] != std::tolower((unsigned char)data[i]))
+			return (false);
+	}
+	return (true);
+}
+
+const VirtualHostIndex::Entry*	VirtualHostIndex::_find(const std::vector<std::vector<Entry> > &table,
+                                                        unsigned long salt, const char *data, size_t len) {
+	if (table.empty())
+		return (NULL);
+	const std::vector<Entry>	&bucket = table[_hash(salt, data, len) & (table.size() - 1)];
+	for (size_t i = 0; i < bucket.size(); i++) {
+		if (bucket[i].salt == salt && _equals(bucket[i].key, data, len))
+			return (&bucket[i]);
+	}
+	return (NULL);
+}
+
+void	VirtualHostIndex::_store(std::vector<std::vector<Entry> > &table,
+                                 unsigned long salt, const std::string &key, int value) {
+	Entry	entry;
+
+	entry.salt = salt;
+	entry.key = key;
+	entry.value = value;
+	table[_hash(salt, key.data(), key.length()) & (table.size() - 1)].push_back(entry);
+}
+
+// Power of two, about twice the number of keys
+static size_t	tableSize(size_t keys) {
+	size_t	size = 16;
+
+	while (size < keys * 2)
+		size *= 2;
+	return (size);
+}
+
+static std::string	lowercase(const std::string &str) {
+	std::string	out(str);
+
+	for (size_t i = 0; i < out.length(); i++)
+		out[i] = std::tolower((unsigned char)out[i]);
+	return (out);
+}
+
+/*	============================================================================
+	LABEL TRIES
+	============================================================================ */
+
+int	VirtualHostIndex::_newNode() {
+	_nodeServer.push_back(-1);
+	return ((int)_nodeServer.size() - 1);
+}
+
+int	VirtualHostIndex::_child(int node, const char *label, size_t len, bool create) {
+	const Entry	*edge = _find(_edges, node, label, len);
+
+	if (edge)
+		return (edge->value);
+	if (!create)
+		return (-1);
+	int	child = _newNode();
+	_store(_edges, node, lowercase(std::string(label, len)), child);
+	return (child);
+}
+
+// name is already stripped of its "*." or ".*"
+void	VirtualHostIndex::_addWildcard(int root, const std::string &name, bool reversed, int server) {
+	int		node = root;
+	size_t	pos = reversed ? name.length() : 0;
+
+	while (true) {
+		size_t	start, end;
+		if (reversed) {
+			size_t dot = name.rfind('.', pos - 1);
+			start = (dot == std::string::npos) ? 0 : dot + 1;
+			end = pos;
+		} else {
+			size_t dot = name.find('.', pos);
+			start = pos;
+			end = (dot == std::string::npos) ? name.length() : dot;
+		}
+		node = _child(node, name.data() + start, end - start, true);
+		if (reversed ? start == 0 : end == name.length())
+			break ;
+		pos = reversed ? start - 1 : end + 1;
+	}
+	if (_nodeServer[node] < 0)
+		_nodeServer[node] = server;
+}
+
+/*	Deepest node carrying a server, provided at least one label of the
+	host is left for the '*' to cover */
+int	VirtualHostIndex::_walk(int root, const char *host, size_t len, bool reversed) const {
+	int		node = root;
+	int		best = -1;
+	size_t	pos = reversed ? len : 0;
+
+	while (reversed ? pos > 0 : pos < len) {
+		size_t	start, end;
+		if (reversed) {
+			end = pos;
+			start = end;
+			while (start > 0 && host[start - 1] != '.')
+				start--;
+		} else {
+			start = pos;
+			end = start;
+			while (end < len && host[end] != '.')
+				end++;
+		}
+		const Entry	*edge = _find(_edges, node, host + start, end - start);
+		if (!edge)
+			break ;
+		node = edge->value;
+		bool	more = reversed ? start > 0 : end < len;
+		if (!more)
+			break ;
+		if (_nodeServer[node] >= 0)
+			best = _nodeServer[node];
+		pos = reversed ? start - 1 : end + 1;
+	}
+	return (best);
+}
+
+/*	============================================================================
+	BUILD: declaration order wins between duplicate names, as before
+	============================================================================ */
+
+void	VirtualHostIndex::build(std::vector<ServerConfig> &servers) {
+	size_t	names = 0;
+	size_t	labels = 0;
+
+	for (size_t i = 0; i < servers.size(); i++) {
+		for (size_t j = 0; j < servers[i].serverNames.size(); j++) {
+			const std::string	&name = servers[i].serverNames[j];
+			names++;
+			for (size_t k = 0; k < name.length(); k++)
+				labels += (name[k] == '.');
+			labels++;
+		}
+	}
+	_exact.assign(tableSize(names), std::vector<Entry>());
+	_edges.assign(tableSize(labels), std::vector<Entry>());
+	for (size_t i = 0; i < servers.size(); i++) {
+		int	server = (int)_servers.size();
+		_servers.push_back(&servers[i]);
+		if (_ports.find(servers[i].port) == _ports.end()) {
+			PortIndex	index;
+			index.fallback = server;
+			index.suffixRoot = _newNode();
+			index.prefixRoot = _newNode();
+			_ports[servers[i].port] = index;
+		}
+		const PortIndex	&index = _ports[servers[i].port];
+		for (size_t j = 0; j < servers[i].serverNames.size(); j++) {
+			std::string	name = lowercase(servers[i].serverNames[j]);
+			if (name.length() > 2 && name.compare(0, 2, "*.") == 0)
+				_addWildcard(index.suffixRoot, name.substr(2), true, server);
+			else if (name.length() > 2 && name.compare(name.length() - 2, 2, ".*") == 0)
+				_addWildcard(index.prefixRoot, name.substr(0, name.length() - 2), false, server);
+			else {
+				// ".example.com" : example.com and all its subdomains
+				if (name.length() > 1 && name[0] == '.') {
+					_addWildcard(index.suffixRoot, name.substr(1), true, server);
+					name.erase(0, 1);
+				}
+				if (!_find(_exact, servers[i].port, name.data(), name.length()))
+					_store(_exact, servers[i].port, name, server);
+			}
+		}
+	}
+}
+
+/*	============================================================================
+	LOOKUP
+	============================================================================ */
+
+ServerConfig*	VirtualHostIndex::lookup(int port, const std::string &host) const {
+	std::map<int, PortIndex>::const_iterator	it = _ports.find(port);
+	if (it == _ports.end())
+		return (NULL);
+	size_t	len = host.find(':');
+	if (len == std::string::npos)
+		len = host.length();
+	if (len > 0 && host[len - 1] == '.')
+		len--;
+	const Entry	*exact = _find(_exact, port, host.data(), len);
+	if (exact)
+		return (_servers[exact->value]);
+	int	server = _walk(it->second.suffixRoot, host.data(), len, true);
+	if (server < 0)
+		server = _walk(it->second.prefixRoot, host.data(), len, false);
+	if (server < 0)
+		server = it->second.fallback;
+	return (_servers[server]);
+}
@@ -2,10 +2,14 @@
 #include "../inc/SocketServer.hpp"
 #include <iostream>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <cerrno>
 #include <csignal>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cstring>
 
 static volatile sig_atomic_t g_stop = 0;
 
@@ -14,49 +18,33 @@ void serverSigHandler(int) {
 }
 
 /*	============================================================================
-	HELPER: vérifie si la requête HTTP dans le buffer est complète
-	(headers + body entier selon Content-Length ou chunked)
+	HELPER: leve la limite souple de descripteurs au maximum autorise,
+	sinon le backend epoll plafonne bien avant 10k connexions
 	============================================================================ */
 
-static bool isRequestComplete(const std::string& rawData)
-{
-	size_t headerEnd = rawData.find("\r\n\r\n");
-	if (headerEnd == std::string::npos)
-		return (false);
-	std::string headersSection = httpToLower(rawData.substr(0, headerEnd));
-	size_t tePos = headersSection.find("transfer-encoding:");
-	if (tePos != std::string::npos) {
-		size_t lineEnd = headersSection.find('\n', tePos);
-		std::string teLine = headersSection.substr(tePos,
-			(lineEnd == std::string::npos ? headersSection.size() : lineEnd) - tePos);
-		if (teLine.find("chunked") != std::string::npos) {
-			std::string body = rawData.substr(headerEnd + 4);
-			return (body.find("0\r\n\r\n") != std::string::npos);
-		}
-	}
-	size_t clPos = headersSection.find("content-length:");
-	if (clPos == std::string::npos)
-		return (true);
-	size_t valStart = clPos + 15;
-	while (valStart < headersSection.size() && headersSection[valStart] == ' ')
-		valStart++;
-	size_t valEnd = headersSection.find('\n', valStart);
-	if (valEnd == std::string::npos)
-		return (false);
-	long contentLength = atol(headersSection.substr(valStart, valEnd - valStart).c_str());
-	if (contentLength <= 0)
-		return (true);
-	size_t bodySize = rawData.size() - (headerEnd + 4);
-	return ((long)bodySize >= contentLength);
+static void raiseFdLimit()
+{
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == rl.rlim_max)
+		return;
+	rl.rlim_cur = rl.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rl);
 }
 
 /*	============================================================================
 	CONSTRUCTEUR / DESTRUCTEUR
 	============================================================================ */
 
-server::server(const std::vector<ServerConfig>& serverConfigs)
-	: _maxUsers(1024), _engine(NULL)
+server::server(const std::vector<ServerConfig>& serverConfigs, const GlobalConfig& global)
+	: _maxUsers(1024), _global(global), _engine(NULL), _poller(NULL)
 {
+	raiseFdLimit();
+	// Avant la compilation de la config, qui consulte déjà le système de fichiers
+	OpenFileCache::configure(global.openFileCacheMax, global.openFileCacheValid);
+	ContentCache::configure(global.contentCacheSize, global.contentCacheMaxFile);
+	ResponseCache::configure(global.responseCacheSize, global.responseCacheMaxEntry,
+	                         global.responseCachePath, global.responseCacheDiskSize);
+	_proxyPool.configure(global.upstreams);
 	for (size_t i = 0; i < serverConfigs.size(); ++i) {
 		const ServerConfig& config = serverConfigs[i];
 		SocketServer* newServer = NULL;
@@ -68,6 +56,11 @@ server::server(const std::vector<ServerConfig>& serverConfigs)
 				newServer->bindSocket();
 				newServer->listenSocket();
 				_serverPorts[config.port] = newServer;
+				_listenFds[newServer->getFd()] = config.port;
+				_timeouts[config.port].header  = config.clientHeaderTimeout;
+				_timeouts[config.port].body    = config.clientBodyTimeout;
+				_timeouts[config.port].send    = config.sendTimeout;
+				_timeouts[config.port].minRate = config.sendMinRate;
 				newServer = NULL;
 				std::cout << "Server listening on " << config.host
 				          << ":" << config.port << std::endl;
@@ -81,6 +74,7 @@ server::server(const std::vector<ServerConfig>& serverConfigs)
 			     it != _serverPorts.end(); ++it)
 				delete it->second;
 			_serverPorts.clear();
+			_listenFds.clear();
 			std::cerr << "Error on port " << config.port << ": " << e.what() << std::endl;
 			throw serverException(std::string("Failed to set up socket: ") + e.what());
 		}
@@ -95,18 +89,130 @@ server::~server()
 		delete it->second;
 	}
 	_serverPorts.clear();
+	_listenFds.clear();
 
 	for (std::map<int, SocketClient*>::iterator it = _clients.begin();
 	     it != _clients.end(); ++it) {
+		if (it->second->getCGIJob())
+			_abortCGI(it->second);
+		_timers.cancel(it->second->getTimer());
 		delete it->second;
 	}
 	_clients.clear();
 	_clientPorts.clear();
+	for (size_t i = 0; i < _deferredClose.size(); i++)
+		close(_deferredClose[i]);
+	_deferredClose.clear();
+	// Fichiers de débordement du cache : propres à ce processus
+	ResponseCache::clear();
 
 	if (_engine) {
 		delete _engine;
 		_engine = NULL;
 	}
+	if (_poller) {
+		delete _poller;
+		_poller = NULL;
+	}
+}
+
+/*	============================================================================
+	POLLER
+	Créé au démarrage de la boucle, donc après le fork : une instance epoll
+	héritée serait partagée entre workers et leur volerait les évènements.
+	============================================================================ */
+
+void server::_initPoller()
+{
+	int listenEvents = POLLER_READ;
+	if (_global.workerProcesses > 1)
+		listenEvents |= POLLER_EXCLUSIVE;
+	_poller = APoller::create(_global.eventBackend);
+	std::cout << "Event backend: " << _poller->name()
+	          << " (pid " << getpid() << ")" << std::endl;
+	for (std::map<int, int>::iterator it = _listenFds.begin();
+	     it != _listenFds.end(); ++it) {
+		if (!_poller->add(it->first, listenEvents))
+			throw serverException("Error: poller registration");
+	}
+}
+
+/*	============================================================================
+	MODE MULTI-PROCESSUS (worker_processes N)
+	Le maître ouvre les sockets d'écoute, fork N workers qui les partagent
+	(chacun dans son propre run()) puis se contente de les surveiller :
+	un worker qui meurt est relancé, SIGINT/SIGTERM arrête tout le monde.
+	============================================================================ */
+
+static void installMasterSignals()
+{
+	struct sigaction sa;
+	std::memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = serverSigHandler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;	// pas de SA_RESTART : waitpid() doit rendre la main
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+}
+
+void server::start()
+{
+	int count = _global.workerProcesses;
+	if (count <= 1) {
+		run();
+		return;
+	}
+	installMasterSignals();
+	std::vector<pid_t>  workers(count, -1);
+	std::vector<time_t> started(count, 0);
+	for (int i = 0; i < count; i++) {
+		std::cout.flush();
+		workers[i] = fork();
+		if (workers[i] == 0) {
+			run();
+			return;
+		}
+		started[i] = time(NULL);
+		std::cout << "Worker " << i << " started (pid " << workers[i] << ")" << std::endl;
+	}
+	while (!g_stop) {
+		int   status = 0;
+		pid_t pid    = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (int i = 0; i < count; i++) {
+			if (workers[i] != pid)
+				continue;
+			workers[i] = -1;
+			if (g_stop)
+				break;
+			std::cerr << "Worker " << i << " (pid " << pid << ") "
+			          << (WIFSIGNALED(status) ? "killed by signal " : "exited with status ")
+			          << (WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status))
+			          << ", restarting" << std::endl;
+			// Crash au démarrage : on évite de relancer en boucle serrée
+			if (time(NULL) - started[i] < 1)
+				sleep(1);
+			std::cout.flush();
+			workers[i] = fork();
+			if (workers[i] == 0) {
+				run();
+				return;
+			}
+			started[i] = time(NULL);
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		if (workers[i] > 0)
+			kill(workers[i], SIGTERM);
+	}
+	for (int i = 0; i < count; i++) {
+		if (workers[i] > 0)
+			waitpid(workers[i], NULL, 0);
+	}
 }
 
 int server::getServerLimit()
@@ -114,109 +220,873 @@ int server::getServerLimit()
 	return (_maxUsers);
 }
 
+/*	============================================================================
+	GESTION DES CLIENTS
+	Chaque fd est enregistre une seule fois aupres du poller ; l'interet
+	ne change que lorsqu'un client passe de la lecture a l'ecriture.
+	============================================================================ */
+
+void server::_acceptClients(int listenFd)
+{
+	int           port     = _listenFds[listenFd];
+	SocketServer* listener = _serverPorts[port];
+	SocketClient* newClient = listener->acceptClient();
+	if (!newClient)
+		return;
+	newClient->setNonBlocking();
+	int clientFd = newClient->getFd();
+	if (!_poller->add(clientFd, POLLER_READ)) {
+		std::cerr << "Rejecting client fd=" << clientFd
+		          << ": " << _poller->name() << " cannot watch it" << std::endl;
+		delete newClient;
+		return;
+	}
+	_clients[clientFd]     = newClient;
+	_clientPorts[clientFd] = port;
+	newClient->getTimer().kind = TIMER_CLIENT;
+	newClient->setTimeouts(_timeouts[port]);
+	_armClient(clientFd, newClient);
+	std::cout << "New client fd=" << clientFd
+	          << " on port " << port << std::endl;
+}
+
+void server::_readClient(int fd, SocketClient* client, std::vector<int>& toRemove)
+{
+	char    buf[8192];
+	ssize_t bytes_read = recv(fd, buf, sizeof(buf), 0);
+	if (bytes_read <= 0) {
+		toRemove.push_back(fd);
+		return;
+	}
+	if (client->isLingering())
+		return;
+	client->addProgress((size_t)bytes_read);
+	_feedClient(fd, client, buf, (size_t)bytes_read);
+}
+
+/*	============================================================================
+	Donne les octets reçus au parseur incrémental du client. Une requête
+	complète est traitée une seule fois ; les octets suivants (pipelining)
+	sont mis de côté jusqu'à ce que la réponse courante soit envoyée.
+	============================================================================ */
+
+void server::_feedClient(int fd, SocketClient* client, const char* data, size_t len)
+{
+	RequestParser& parser = client->getParser();
+	size_t         used   = parser.feed(data, len);
+	if (parser.needsBodyPolicy()) {
+		// En-têtes complets : la route fixe max_body_size (413 avant le
+		// premier octet du corps) et l'endroit où déborde un gros corps
+		_resolveTimeouts(fd, client);
+		parser.setBodyPolicy(_engine->bodyPolicy(parser.getRequest(), _clientPorts[fd]));
+		// Inutile si le client a déjà commencé à envoyer le corps. Sinon la
+		// réponse intermédiaire passe par la file comme les autres : le corps
+		// n'est relu qu'une fois la file vidée, elle précède donc la finale
+		if (!parser.hasError() && parser.expectsContinue() && used == len) {
+			client->getOutput().append(HTTP_CONTINUE_LINE);
+			client->setInterim(true);
+			_poller->modify(fd, POLLER_WRITE);
+			return;
+		}
+		used += parser.feed(data + used, len - used);
+	}
+	if (parser.hasError()) {
+		_resolveTimeouts(fd, client);
+		HTTPOutput out = _engine->rejectRequest(parser.getRequest(), _clientPorts[fd],
+		                                        parser.getErrorStatus(), parser.getError());
+		_queueOutput(client, out);
+		client->setKeepAlive(false, 0);
+		_poller->modify(fd, POLLER_WRITE);
+		return;
+	}
+	if (!parser.isComplete())
+		return;
+	client->getRequestBuffer().append(data + used, len - used);
+	_resolveTimeouts(fd, client);
+	HTTPConnection conn;
+	conn.port = _clientPorts[fd];
+	conn.requestCount = client->getRequestCount();
+	conn.keepAlive = false;
+	conn.keepAliveTimeout = 0;
+	HTTPOutput out = _engine->processRequest(parser.getRequest(), conn);
+	parser.reset();
+	client->setKeepAlive(conn.keepAlive, conn.keepAliveTimeout);
+	client->countRequest();
+	if (out.cgi) {
+		_attachCGI(fd, client, out.cgi);
+		return;
+	}
+	_queueOutput(client, out);
+	_poller->modify(fd, POLLER_WRITE);
+}
+
+// Réponse en cache : status + en-têtes fixes, puis Connection, puis le corps,
+// envoyés depuis le même bloc partagé sans copie
+void server::_queueOutput(SocketClient* client, HTTPOutput& out)
+{
+	OutputQueue& output = client->getOutput();
+
+	if (out.shared) {
+		output.appendShared(out.shared, 0, out.shared->split());
+		output.appendSwap(out.head);
+		output.appendShared(out.shared, out.shared->split(), out.shared->data().size());
+		out.shared->release();
+		out.shared = NULL;
+		return;
+	}
+	output.appendSwap(out.head);
+	output.appendSwap(out.body);
+	if (out.fileRanges.empty()) {
+		output.appendFile(out.fileFd, 0, out.fileLength);
+		return;
+	}
+	// Plages d'octets : chaque tranche a son propre descripteur (dup, fermé
+	// à l'exec comme tous les autres). Plus de descripteur : réponse
+	// abandonnée, la connexion se ferme une fois la file (vide) écrite
+	for (size_t i = 0; i < out.fileRanges.size(); i++) {
+		FileRange& range = out.fileRanges[i];
+		output.appendSwap(range.prefix);
+		if (range.length <= 0)
+			continue;
+		int fd = fcntl(out.fileFd, F_DUPFD_CLOEXEC, 0);
+		if (fd < 0) {
+			output.clear();
+			client->setKeepAlive(false, 0);
+			break;
+		}
+		output.appendFile(fd, range.offset, range.length);
+	}
+	close(out.fileFd);
+}
+
+void server::_writeClient(int fd, SocketClient* client, std::vector<int>& toRemove)
+{
+	ssize_t sent = client->flushOutput();
+	if (sent < 0) {
+		toRemove.push_back(fd);
+		return;
+	}
+	client->addProgress((size_t)sent);
+	if (client->getCGIJob()) {
+		_drainCGIStream(fd, client);
+		return;
+	}
+	if (client->hasPendingOutput())
+		return;
+	// "100 Continue" parti : retour à la lecture du corps
+	if (client->hasInterim()) {
+		client->setInterim(false);
+		_poller->modify(fd, POLLER_READ);
+		return;
+	}
+	if (!client->isKeepAlive()) {
+		// Requête refusée en plein corps : fermer avec des octets non lus
+		// enverrait un RST, qui peut effacer la réponse côté client
+		if (client->getParser().hasError() && !client->isLingering()) {
+			client->startLingering();
+			_poller->modify(fd, POLLER_READ);
+			return;
+		}
+		toRemove.push_back(fd);
+		return;
+	}
+	// Connexion persistante : on attend la requête suivante sur le même fd
+	if (!client->getRequestBuffer().empty()) {
+		std::string pending;
+		pending.swap(client->getRequestBuffer());
+		_feedClient(fd, client, pending.data(), pending.size());
+		if (client->hasPendingOutput() || client->getCGIJob())
+			return;
+	}
+	_poller->modify(fd, POLLER_READ);
+}
+
+void server::_closeClient(int fd)
+{
+	std::map<int, SocketClient*>::iterator it = _clients.find(fd);
+	if (it == _clients.end())
+		return;
+	if (it->second->getCGIJob())
+		_abortCGI(it->second);
+	_timers.cancel(it->second->getTimer());
+	_poller->remove(fd);
+	delete it->second;
+	_clients.erase(it);
+	_clientPorts.erase(fd);
+}
+
+/*	============================================================================
+	CGI ASYNCHRONE
+	Les pipes stdin/stdout du job sont enregistrés auprès du poller ; le
+	client n'est plus surveillé que pour sa fermeture (EPOLLRDHUP, ou une
+	lecture sondée avec select) : un client parti arrête le script, la
+	requête FastCGI ou la connexion au backend. Les fds libérés ne sont
+	fermés qu'en fin d'itération pour qu'un numéro de fd ne soit pas
+	réutilisé par un évènement encore en attente.
+	============================================================================ */
+
+// Au-delà, les octets pipelinés ne sont plus lus pendant le job
+static int busyInterest(SocketClient* client)
+{
+	return (client->getRequestBuffer().size() < PARSER_MAX_LINE * 4 ? POLLER_HANGUP : 0);
+}
+
+void server::_attachCGI(int fd, SocketClient* client, CGIJob* job)
+{
+	client->setCGIJob(job);
+	_poller->modify(fd, busyInterest(client));
+	job->timer.owner = fd;
+	job->timer.kind  = TIMER_CGI;
+	_timers.schedule(job->timer, CGI_TIMEOUT * 1000);
+	if (!job->fastcgiPass.empty()) {
+		_attachFastCGI(fd, job);
+		return;
+	}
+	if (!job->proxyPass.empty()) {
+		_attachProxy(fd, job);
+		return;
+	}
+	if (_poller->add(job->stdoutFd, POLLER_READ))
+		_cgiFds[job->stdoutFd] = fd;
+	else
+		job->timedOut = true;
+	if (job->stdinFd >= 0) {
+		if (_poller->add(job->stdinFd, POLLER_WRITE))
+			_cgiFds[job->stdinFd] = fd;
+		else
+			_releaseCGIFd(job->stdinFd);
+	}
+	if (job->timedOut) {
+		CGIHandler::kill(*job);
+		_releaseCGIFd(job->stdoutFd);
+		_cgiExiting.insert(fd);
+	}
+}
+
+// Détache le job de son transport (pipes, requête FastCGI ou proxy).
+// Une réponse de proxy interrompue rend la connexion inutilisable.
+void server::_detachCGI(CGIJob* job)
+{
+	_timers.cancel(job->timer);
+	_releaseCGIFd(job->stdinFd);
+	_releaseCGIFd(job->stdoutFd);
+	_fcgiJobs.erase(job);
+	if (!job->fastcgiPass.empty())
+		_fcgiPool.cancelWait(job);
+	if (job->fcgiConn) {
+		FastCGIConnection* conn = job->fcgiConn;
+		conn->abort(job);
+		_poller->modify(conn->getFd(), conn->interest());
+	}
+	_proxyJobs.erase(job);
+	if (job->proxyConn) {
+		ProxyConnection* conn = job->proxyConn;
+		if (job->timedOut) {
+			std::vector<ProxyConnection*> stale;
+			_proxyPool.fail(conn, stale);
+		}
+		_closeProxy(conn);
+	}
+}
+
+void server::_releaseCGIFd(int& pipeFd)
+{
+	if (pipeFd < 0)
+		return;
+	_poller->remove(pipeFd);
+	_cgiFds.erase(pipeFd);
+	_deferredClose.push_back(pipeFd);
+	pipeFd = -1;
+}
+
+void server::_handleCGIEvent(int pipeFd, int events)
+{
+	int      clientFd = _cgiFds[pipeFd];
+	CGIJob*  job      = _clients[clientFd]->getCGIJob();
+	if (pipeFd == job->stdinFd) {
+		if (CGIHandler::writeInput(*job) <= 0
+		    || job->inputOffset >= job->input.length())
+			_releaseCGIFd(job->stdinFd);
+		return;
+	}
+	if (!(events & (POLLER_READ | POLLER_ERROR)))
+		return;
+	if (CGIHandler::readOutput(*job) > 0) {
+		_streamCGI(clientFd);
+		return;
+	}
+	// EOF (ou erreur) sur stdout : le script a fini d'écrire
+	_releaseCGIFd(job->stdoutFd);
+	_releaseCGIFd(job->stdinFd);
+	if (job->headersSent)
+		_endCGIStream(clientFd);
+	else if (CGIHandler::reap(*job))
+		_completeCGI(clientFd);
+	else
+		_cgiExiting.insert(clientFd);
+}
+
+/*	============================================================================
+	FASTCGI
+	Les requêtes partent sur une connexion du pool (enregistrée auprès du
+	poller à sa création) ; les records STDOUT alimentent la même
+	mécanique que la sortie d'un pipe CGI.
+	============================================================================ */
+
+void server::_attachFastCGI(int fd, CGIJob* job)
+{
+	bool               created = false;
+	FastCGIConnection* conn    = _fcgiPool.acquire(job->fastcgiPass, created);
+
+	// Toutes les connexions pleines : le job attend une place, sans request
+	// id en trop (un backend sans FCGI_MPXS_CONNS n'en traite qu'une)
+	if (!conn && _fcgiPool.saturated(job->fastcgiPass)) {
+		_fcgiPool.wait(job);
+		_fcgiJobs[job] = fd;
+		return;
+	}
+	if (conn && created && !_poller->add(conn->getFd(), conn->interest())) {
+		_deferredClose.push_back(conn->releaseFd());
+		_fcgiPool.remove(conn);
+		conn = NULL;
+	}
+	if (!conn || !conn->submit(job)) {
+		// Backend injoignable : 502 via le chemin de fin habituel
+		job->exited = true;
+		_cgiExiting.insert(fd);
+		return;
+	}
+	_fcgiJobs[job] = fd;
+	_poller->modify(conn->getFd(), conn->interest());
+}
+
+void server::_handleFastCGIEvent(FastCGIConnection* conn, int events)
+{
+	std::vector<CGIJob*> touched;
+	bool                 broken  = false;
+	std::string          address = conn->getAddress();
+
+	if ((events & POLLER_WRITE) && conn->flush() < 0)
+		broken = true;
+	if (!broken && (events & (POLLER_READ | POLLER_ERROR))
+	    && conn->receive(touched) <= 0)
+		broken = true;
+	if (broken) {
+		conn->failAll(touched);
+		_poller->remove(conn->getFd());
+		_deferredClose.push_back(conn->releaseFd());
+		_fcgiPool.remove(conn);
+	} else
+		_poller->modify(conn->getFd(), conn->interest());
+	for (size_t i = 0; i < touched.size(); i++) {
+		CGIJob* job      = touched[i];
+		int     clientFd = _fcgiJobs[job];
+		// Derniers records STDOUT et FCGI_END_REQUEST peuvent arriver ensemble
+		if (!job->result.output.empty() && (job->headersSent || !job->exited))
+			_streamCGI(clientFd);
+		if (!job->exited)
+			continue;
+		if (job->headersSent)
+			_endCGIStream(clientFd);
+		else
+			_completeCGI(clientFd);
+	}
+	_resumeFastCGI(address);
+}
+
+// Requête terminée, connexion perdue ou multiplexage confirmé : de la place
+void server::_resumeFastCGI(const std::string& address)
+{
+	CGIJob* job;
+
+	while ((job = _fcgiPool.nextWaiting(address)) != NULL)
+		_attachFastCGI(_fcgiJobs[job], job);
+}
+
+/*	============================================================================
+	REVERSE PROXY
+	Même mécanique que FastCGI, une requête par connexion. Tant que rien
+	n'est revenu du backend, un échec (connect refusé, keep-alive fermé
+	entre-temps) relance la requête sur un autre serveur de l'upstream ;
+	sinon le job se termine en 502, ou en réponse coupée si la tête est
+	déjà partie. Une connexion inactive qui signale un évènement a été
+	fermée par le backend.
+	============================================================================ */
+
+void server::_attachProxy(int fd, CGIJob* job)
+{
+	bool             created = false;
+	ProxyConnection* conn;
+
+	while ((conn = _proxyPool.acquire(job, created)) != NULL) {
+		if (!created || _poller->add(conn->getFd(), conn->interest()))
+			break;
+		job->proxyTried.push_back(conn->getPeer());
+		_deferredClose.push_back(conn->releaseFd());
+		_proxyPool.remove(conn);
+	}
+	if (!conn) {
+		job->exited = true;
+		_cgiExiting.insert(fd);
+		return;
+	}
+	_proxyJobs[job] = fd;
+	_poller->modify(conn->getFd(), conn->interest());
+}
+
+void server::_closeProxy(ProxyConnection* conn)
+{
+	_poller->remove(conn->getFd());
+	_deferredClose.push_back(conn->releaseFd());
+	_proxyPool.remove(conn);
+}
+
+void server::_handleProxyEvent(ProxyConnection* conn, int events)
+{
+	CGIJob* job = conn->getJob();
+
+	if (!job) {
+		_closeProxy(conn);
+		return;
+	}
+	int clientFd = _proxyJobs[job];
+	int status   = conn->handle(events);
+	if (status == PROXY_FAILED) {
+		std::vector<ProxyConnection*> stale;
+		bool                          retry = conn->retriable();
+		_proxyPool.fail(conn, stale);
+		_closeProxy(conn);
+		for (size_t i = 0; i < stale.size(); i++)
+			_closeProxy(stale[i]);
+		if (retry) {
+			_attachProxy(clientFd, job);
+			return;
+		}
+		job->exited = true;
+		job->result.exitCode = -1;
+		job->result.success = false;
+	} else if (status == PROXY_DONE) {
+		if (_proxyPool.release(conn))
+			_poller->modify(conn->getFd(), conn->interest());
+		else
+			_closeProxy(conn);
+	} else
+		_poller->modify(conn->getFd(), conn->interest());
+	// Dernier morceau du corps et fin de réponse peuvent arriver ensemble
+	if (!job->result.output.empty() && (job->headersSent || !job->exited))
+		_streamCGI(clientFd);
+	if (!job->exited)
+		return;
+	if (job->headersSent)
+		_endCGIStream(clientFd);
+	else
+		_completeCGI(clientFd);
+}
+
+/*	============================================================================
+	STREAMING CGI
+	Dès la fin du bloc d'en-têtes, la tête de réponse part au client et le
+	corps suit à chaque lecture. Si le client ne suit pas, stdout est retiré
+	du poller (le script bloque sur son pipe) jusqu'à ce que la file
+	redescende sous la moitié de CGI_BUFFER_LIMIT.
+	============================================================================ */
+
+void server::_streamCGI(int clientFd)
+{
+	SocketClient* client = _clients[clientFd];
+	CGIJob*       job    = client->getCGIJob();
+	OutputQueue&  output = client->getOutput();
+
+	if (!job->headersSent) {
+		size_t bodyStart = 0;
+		size_t headerEnd = CGIHandler::findHeaderEnd(*job, bodyStart);
+		if (headerEnd == std::string::npos) {
+			if (job->result.output.size() < CGI_MAX_HEADER)
+				return;
+			headerEnd = 0;	// pas de bloc d'en-têtes : tout est corps
+		}
+		HTTPOutput out = _engine->startCGIStream(*job, headerEnd, bodyStart);
+		output.appendSwap(out.head);
+		job->headersSent = true;
+		client->setKeepAlive(job->keepAlive, job->keepAliveTimeout);
+	}
+	std::string chunk;
+	chunk.swap(job->result.output);
+	if (job->contentLength >= 0
+	    && job->bodySent + (long)chunk.size() > job->contentLength)
+		chunk.resize(job->contentLength - job->bodySent);
+	if (!chunk.empty()) {
+		job->bodySent += chunk.size();
+		if (job->gzip) {
+			std::string zipped;
+			job->gzip->write(chunk, zipped, false);
+			chunk.swap(zipped);
+		}
+		ResponseCache::collect(job->cache, chunk);
+		_appendBody(output, chunk, job->chunked);
+	}
+	if (!job->paused && output.memoryBytes() >= CGI_BUFFER_LIMIT)
+		_pauseCGI(job, true);
+	if (client->hasPendingOutput())
+		_poller->modify(clientFd, POLLER_WRITE);
+	_armClient(clientFd, client);
+}
+
+// Un chunk vide terminerait le corps : il n'est jamais émis ici
+void server::_appendBody(OutputQueue& output, std::string& data, bool chunked)
+{
+	if (data.empty())
+		return;
+	if (chunked)
+		output.append(httpSizeToHex(data.size()) + "\r\n");
+	output.appendSwap(data);
+	if (chunked)
+		output.append("\r\n");
+}
+
+// Après un envoi : relance la lecture du script si la file s'est vidée
+void server::_drainCGIStream(int fd, SocketClient* client)
+{
+	CGIJob* job = client->getCGIJob();
+
+	job->lastActivity = time(NULL);
+	if (job->paused && client->getOutput().memoryBytes() < CGI_BUFFER_LIMIT / 2)
+		_pauseCGI(job, false);
+	if (!client->hasPendingOutput())
+		_poller->modify(fd, busyInterest(client));
+}
+
+// Une connexion FastCGI est partagée : la mettre en pause bloque tous ses jobs
+void server::_pauseCGI(CGIJob* job, bool paused)
+{
+	if (job->fcgiConn) {
+		job->fcgiConn->setPaused(job, paused);
+		_poller->modify(job->fcgiConn->getFd(), job->fcgiConn->interest());
+	} else if (job->proxyConn) {
+		job->proxyConn->setPaused(paused);
+		_poller->modify(job->proxyConn->getFd(), job->proxyConn->interest());
+	} else if (job->stdoutFd >= 0) {
+		_poller->modify(job->stdoutFd, paused ? 0 : POLLER_READ);
+		job->paused = paused;
+	}
+}
+
+// Fin du corps : chunk final, ou fermeture si la réponse est incomplète
+void server::_endCGIStream(int clientFd)
+{
+	SocketClient* client = _clients[clientFd];
+	CGIJob*       job    = client->getCGIJob();
+	bool          exited = CGIHandler::reap(*job);
+
+	if (job->timedOut || (exited && !job->result.success))
+		client->setKeepAlive(false, 0);
+	else if (job->chunked) {
+		if (job->gzip) {
+			std::string trailer;
+			job->gzip->write("", trailer, true);
+			ResponseCache::collect(job->cache, trailer);
+			_appendBody(client->getOutput(), trailer, true);
+		}
+		client->getOutput().append("0\r\n\r\n");
+		if (job->contentLength < 0 || job->bodySent == job->contentLength)
+			ResponseCache::store(job->cache);
+	}
+	else if (job->contentLength < 0 || job->bodySent < job->contentLength)
+		client->setKeepAlive(false, 0);
+	else
+		ResponseCache::store(job->cache);
+	if (!exited)
+		_zombies.push_back(job->pid);
+	_detachCGI(job);
+	delete job;
+	client->setCGIJob(NULL);
+	_cgiExiting.erase(clientFd);
+	_poller->modify(clientFd, POLLER_WRITE);
+	_armClient(clientFd, client);
+}
+
+void server::_completeCGI(int clientFd)
+{
+	SocketClient* client = _clients[clientFd];
+	CGIJob*       job    = client->getCGIJob();
+	HTTPOutput    out    = _engine->finishCGI(*job);
+
+	client->setKeepAlive(job->keepAlive, job->keepAliveTimeout);
+	_detachCGI(job);
+	delete job;
+	client->setCGIJob(NULL);
+	_cgiExiting.erase(clientFd);
+	_queueOutput(client, out);
+	_poller->modify(clientFd, POLLER_WRITE);
+	_armClient(clientFd, client);
+}
+
+// Client réveillé pendant un job : requête pipelinée mise de côté comme
+// dans _feedClient, ou fermeture (EOF, erreur) qui abandonne le job
+void server::_probeClient(int fd, SocketClient* client, std::vector<int>& toRemove)
+{
+	char    buf[8192];
+	ssize_t bytes_read = recv(fd, buf, sizeof(buf), 0);
+
+	if (bytes_read <= 0) {
+		toRemove.push_back(fd);
+		return;
+	}
+	client->getRequestBuffer().append(buf, (size_t)bytes_read);
+	if (!client->hasPendingOutput())
+		_poller->modify(fd, busyInterest(client));
+}
+
+// Client parti avant la fin du script : on tue le processus sans l'attendre
+void server::_abortCGI(SocketClient* client)
+{
+	CGIJob* job = client->getCGIJob();
+	int     fd  = client->getFd();
+
+	_detachCGI(job);
+	CGIHandler::kill(*job);
+	if (!CGIHandler::reap(*job))
+		_zombies.push_back(job->pid);
+	delete job;
+	client->setCGIJob(NULL);
+	_cgiExiting.erase(fd);
+}
+
+// waitpid(WNOHANG) uniquement : jamais d'attente bloquante dans la boucle
+void server::_reapChildren()
+{
+	std::vector<int> done;
+	for (std::set<int>::iterator it = _cgiExiting.begin();
+	     it != _cgiExiting.end(); ++it) {
+		if (CGIHandler::reap(*_clients[*it]->getCGIJob()))
+			done.push_back(*it);
+	}
+	for (size_t i = 0; i < done.size(); i++)
+		_completeCGI(done[i]);
+	for (size_t i = 0; i < _zombies.size(); ) {
+		if (waitpid(_zombies[i], NULL, WNOHANG) != 0) {
+			_zombies[i] = _zombies.back();
+			_zombies.pop_back();
+		} else
+			i++;
+	}
+}
+
+/*	============================================================================
+	TIMEOUTS
+	Un seul Timer par client, réarmé seulement quand sa phase change
+	(en-têtes, corps, keep-alive, envoi) ; les délais "entre deux
+	lectures/écritures" sont vérifiés à l'échéance grâce au compteur de
+	progression, sans toucher à la roue à chaque recv/send. Le timeout
+	du poller est celui de la prochaine échéance.
+	============================================================================ */
+
+void server::_armClient(int fd, SocketClient* client)
+{
+	RequestParser& parser = client->getParser();
+	int            phase;
+
+	if (client->hasPendingOutput())
+		phase = PHASE_SEND;
+	else if (client->isLingering())
+		phase = PHASE_LINGER;
+	else if (client->getCGIJob())
+		phase = PHASE_NONE;
+	else if (parser.isReadingBody())
+		phase = PHASE_BODY;
+	else if (!parser.hasStarted() && client->getRequestCount() > 0)
+		phase = PHASE_IDLE;
+	else
+		phase = PHASE_HEADER;
+	if (phase == client->getPhase())
+		return;
+	client->setPhase(phase);
+	client->takeProgress();
+	const ClientTimeouts& t = client->getTimeouts();
+	if (phase == PHASE_NONE)
+		_timers.cancel(client->getTimer());
+	else if (phase == PHASE_SEND)
+		_timers.schedule(client->getTimer(), t.send * 1000UL);
+	else if (phase == PHASE_BODY)
+		_timers.schedule(client->getTimer(), t.body * 1000UL);
+	else if (phase == PHASE_IDLE)
+		_timers.schedule(client->getTimer(), client->getKeepAliveTimeout() * 1000UL);
+	else if (phase == PHASE_LINGER)
+		_timers.schedule(client->getTimer(), LINGERING_TIMEOUT * 1000UL);
+	else
+		_timers.schedule(client->getTimer(), _timeouts[_clientPorts[fd]].header * 1000UL);
+}
+
+// En-têtes lus : corps et envoi suivent le vhost qui répond, le délai
+// d'en-tête reste celui du port (la requête suivante n'a pas de vhost)
+void server::_resolveTimeouts(int fd, SocketClient* client)
+{
+	ClientTimeouts t = _timeouts[_clientPorts[fd]];
+
+	_engine->clientTimeouts(client->getParser().getRequest(), _clientPorts[fd], t);
+	client->setTimeouts(t);
+}
+
+void server::_expireClient(int fd, SocketClient* client)
+{
+	const ClientTimeouts& t        = client->getTimeouts();
+	size_t                progress = client->takeProgress();
+
+	switch (client->getPhase()) {
+		case PHASE_BODY:
+			// client_body_timeout : délai entre deux lectures
+			if (progress > 0) {
+				_timers.schedule(client->getTimer(), t.body * 1000UL);
+				return;
+			}
+			break;
+		case PHASE_SEND:
+			// send_timeout entre deux écritures, send_min_rate sur la fenêtre
+			if (progress > 0 && (t.minRate <= 0 || progress >= (size_t)(t.minRate * t.send))) {
+				_timers.schedule(client->getTimer(), t.send * 1000UL);
+				return;
+			}
+			_closeClient(fd);
+			return;
+		case PHASE_HEADER:
+			if (client->getParser().hasStarted())
+				break;
+			_closeClient(fd);
+			return;
+		default:
+			_closeClient(fd);
+			return;
+	}
+	// Requête commencée mais trop lente : 408 puis fermeture
+	client->setInterim(false);
+	client->getOutput().append(_engine->buildErrorResponse(HTTP_REQUEST_TIMEOUT,
+	                                                       "Request Timeout"));
+	client->setKeepAlive(false, 0);
+	_poller->modify(fd, POLLER_WRITE);
+	_armClient(fd, client);
+}
+
+void server::_expireCGI(int clientFd)
+{
+	CGIJob* job  = _clients[clientFd]->getCGIJob();
+	time_t  idle = time(NULL) - job->lastActivity;
+
+	// Script en pause : c'est le client qui est lent, pas le script
+	if (job->paused || idle < CGI_TIMEOUT) {
+		_timers.schedule(job->timer, (job->paused ? CGI_TIMEOUT : CGI_TIMEOUT - idle) * 1000UL);
+		return;
+	}
+	job->timedOut = true;
+	CGIHandler::kill(*job);
+	_detachCGI(job);
+	// En-têtes déjà partis : plus de 504 possible, on coupe la réponse
+	if (job->headersSent)
+		_endCGIStream(clientFd);
+	else
+		_cgiExiting.insert(clientFd);
+}
+
+// Les timers sont retirés de la liste un à un : un client fermé par une
+// échéance peut annuler sans risque celles qui restent à traiter
+void server::_expireTimers()
+{
+	_timers.advance(TimerWheel::nowMs());
+	while (Timer* timer = _timers.popDue()) {
+		std::map<int, SocketClient*>::iterator it = _clients.find(timer->owner);
+		if (it == _clients.end())
+			continue;
+		if (timer->kind == TIMER_CGI)
+			_expireCGI(it->first);
+		else
+			_expireClient(it->first, it->second);
+	}
+}
+
+int server::_pollTimeout() const
+{
+	long timeout = _timers.nextTimeout(TimerWheel::nowMs());
+
+	if ((!_cgiExiting.empty() || !_zombies.empty()) && (timeout < 0 || timeout > 10))
+		return (10);
+	return ((int)timeout);
+}
+
 /*	============================================================================
 	BOUCLE PRINCIPALE
-	Utilise select() pour read ET write, conformément au sujet :
-	  - jamais de recv/send sans passer par select() d'abord
+	Le backend (select ou epoll) est choisi via "events { use ...; }" :
+	  - jamais de recv/send sans notification du poller d'abord
 	  - pas de vérification de errno après read/write
 	============================================================================ */
 
 void server::run()
 {
+	std::vector<PollEvent> events;
+
+	if (!_poller)
+		_initPoller();
 	signal(SIGINT, serverSigHandler);
 	signal(SIGTERM, serverSigHandler);
 	while (!g_stop)
 	{
-		fd_set read_fds, write_fds;
-		int    max_fd = 0;
-		FD_ZERO(&read_fds);
-		FD_ZERO(&write_fds);
-		for (std::map<int, SocketServer*>::iterator it = _serverPorts.begin();
-		     it != _serverPorts.end(); ++it) {
-			int fd = it->second->getFd();
-			FD_SET(fd, &read_fds);
-			if (fd > max_fd)
-				max_fd = fd;
-		}
-		for (std::map<int, SocketClient*>::iterator it = _clients.begin();
-		     it != _clients.end(); ++it) {
-			int           fd     = it->first;
-			SocketClient* client = it->second;
-			if (!client->getResponseBuffer().empty())
-				FD_SET(fd, &write_fds);
-			else
-				FD_SET(fd, &read_fds);
-			if (fd > max_fd)
-				max_fd = fd;
-		}
-		int activity = select(max_fd + 1, &read_fds, &write_fds, NULL, NULL);
+		int activity = _poller->wait(events, _pollTimeout());
 		if (activity < 0) {
 			if (errno == EINTR)
 				break;
-			std::cerr << "select() error" << std::endl;
+			std::cerr << _poller->name() << "() error" << std::endl;
 			continue;
 		}
-		for (std::map<int, SocketServer*>::iterator it = _serverPorts.begin();
-		     it != _serverPorts.end(); ++it) {
-			int listening_fd = it->second->getFd();
-			if (!FD_ISSET(listening_fd, &read_fds))
-				continue;
-			SocketClient* newClient = it->second->acceptClient();
-			if (newClient) {
-				newClient->setNonBlocking();
-				int clientFd = newClient->getFd();
-				_clients[clientFd]     = newClient;
-				_clientPorts[clientFd] = it->first;
-				std::cout << "New client fd=" << clientFd
-				          << " on port " << it->first << std::endl;
-			}
-		}
 		std::vector<int> toRemove;
-		for (std::map<int, SocketClient*>::iterator it = _clients.begin();
-		     it != _clients.end(); ++it)
+		for (size_t i = 0; i < events.size(); i++)
 		{
-			int           fd     = it->first;
-			SocketClient* client = it->second;
-			if (FD_ISSET(fd, &read_fds)) {
-				char    buf[8192];
-				ssize_t bytes_read = recv(fd, buf, sizeof(buf), 0);
-				if (bytes_read <= 0) {
-					toRemove.push_back(fd);
-					continue;
-				}
-				client->getRequestBuffer().append(buf, (size_t)bytes_read);
-				if (isRequestComplete(client->getRequestBuffer())) {
-					int port = _clientPorts[fd];
-					std::string response = _engine->processRequest(
-						client->getRequestBuffer(), port);
-					client->getResponseBuffer() = response;
-					client->getRequestBuffer().clear();
-				}
+			int fd = events[i].fd;
+			if (_listenFds.find(fd) != _listenFds.end()) {
+				_acceptClients(fd);
+				continue;
+			}
+			if (_cgiFds.find(fd) != _cgiFds.end()) {
+				_handleCGIEvent(fd, events[i].events);
+				continue;
 			}
-			if (FD_ISSET(fd, &write_fds)) {
-				std::string& resp = client->getResponseBuffer();
-				if (!resp.empty()) {
-					ssize_t sent = send(fd, resp.c_str(), resp.size(), 0);
-					if (sent < 0) {
-						toRemove.push_back(fd);
-						continue;
-					}
-					if (sent > 0)
-						resp = resp.substr((size_t)sent);
-					if (resp.empty())
-						toRemove.push_back(fd);
-				}
+			FastCGIConnection* fcgi = _fcgiPool.find(fd);
+			if (fcgi) {
+				_handleFastCGIEvent(fcgi, events[i].events);
+				continue;
+			}
+			ProxyConnection* proxy = _proxyPool.find(fd);
+			if (proxy) {
+				_handleProxyEvent(proxy, events[i].events);
+				continue;
 			}
-		}
-		for (size_t i = 0; i < toRemove.size(); i++) {
-			int fd = toRemove[i];
 			std::map<int, SocketClient*>::iterator it = _clients.find(fd);
-			if (it != _clients.end()) {
-				delete it->second;
-				_clients.erase(it);
-				_clientPorts.erase(fd);
+			if (it == _clients.end())
+				continue;
+			SocketClient* client = it->second;
+			if (client->getCGIJob() && !client->hasPendingOutput()) {
+				if (events[i].events & (POLLER_READ | POLLER_ERROR))
+					_probeClient(fd, client, toRemove);
+				continue;
+			}
+			if (events[i].events & (POLLER_READ | POLLER_ERROR)) {
+				if (!client->hasPendingOutput())
+					_readClient(fd, client, toRemove);
+				else if (!(events[i].events & POLLER_WRITE))
+					toRemove.push_back(fd);
 			}
+			// Sans sortie en attente, un évènement WRITE signale la fin d'un
+			// corps CGI déjà entièrement envoyé
+			if (events[i].events & POLLER_WRITE)
+				_writeClient(fd, client, toRemove);
+			if (toRemove.empty() || toRemove.back() != fd)
+				_armClient(fd, client);
 		}
+		for (size_t i = 0; i < toRemove.size(); i++)
+			_closeClient(toRemove[i]);
+		if (!_cgiExiting.empty() || !_zombies.empty())
+			_reapChildren();
+		_expireTimers();
+		for (size_t i = 0; i < _deferredClose.size(); i++)
+			close(_deferredClose[i]);
+		_deferredClose.clear();
 	}
 }
 
@@ -166,7 +166,7 @@ def test_config_body_limit():
     check("Body > max_body_size (server3 100KB) → 413 ou 405",
           code in (413, 405), f"got {code}")
 
-    # Server2 : max_body_size = 5 000 000 → envoyer 6 Mo
+    # Server2 : max_body_size = 5m (5 Mio) → envoyer 6 Mo
     big2 = "Y" * 6_000_000
     req2 = (
         f"POST /upload/oversized.bin HTTP/1.1\r\nHost: api.localhost\r\n"
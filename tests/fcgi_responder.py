@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+fcgi_responder.py — Petit serveur FastCGI (rôle Responder) pour les tests
+
+Usage:
+    python3 tests/fcgi_responder.py [hôte:port | unix:/chemin] [--no-mpxs]
+                                                        (défaut 127.0.0.1:9000)
+
+Multiplexe les requêtes (annonce FCGI_MPXS_CONNS=1) et garde les
+connexions ouvertes. Chaque réponse liste les paramètres reçus puis
+renvoie le body ; "?sleep=N" retarde la réponse de N secondes.
+Avec --no-mpxs, annonce FCGI_MPXS_CONNS=0 comme php-fpm et refuse par
+FCGI_CANT_MPX_CONN toute requête ouverte pendant qu'une autre est en
+cours sur la même connexion.
+"""
+
+import asyncio
+import struct
+import sys
+from urllib.parse import parse_qs
+
+BEGIN_REQUEST, ABORT_REQUEST, END_REQUEST = 1, 2, 3
+PARAMS, STDIN, STDOUT = 4, 5, 6
+GET_VALUES, GET_VALUES_RESULT = 9, 10
+CANT_MPX_CONN = 1
+MPXS = "--no-mpxs" not in sys.argv
+
+
+def record(rtype, rid, content=b""):
+    return struct.pack("!BBHHBB", 1, rtype, rid, len(content), 0, 0) + content
+
+
+def read_length(data, pos):
+    if data[pos] < 128:
+        return data[pos], pos + 1
+    return struct.unpack("!I", data[pos:pos + 4])[0] & 0x7fffffff, pos + 4
+
+
+def decode_pairs(data):
+    pairs, pos = {}, 0
+    while pos < len(data):
+        nlen, pos = read_length(data, pos)
+        vlen, pos = read_length(data, pos)
+        name = data[pos:pos + nlen].decode("latin-1")
+        pairs[name] = data[pos + nlen:pos + nlen + vlen].decode("latin-1")
+        pos += nlen + vlen
+    return pairs
+
+
+def encode_pairs(pairs):
+    out = b""
+    for name, value in pairs.items():
+        out += bytes([len(name), len(value)]) + name.encode() + value.encode()
+    return out
+
+
+async def respond(writer, rid, params, body):
+    query = parse_qs(params.get("QUERY_STRING", ""))
+    delay = float(query.get("sleep", ["0"])[0])
+    if delay:
+        await asyncio.sleep(delay)
+    lines = "".join(f"{k}={v}\n" for k, v in sorted(params.items()))
+    payload = b"Content-Type: text/plain\r\n\r\n" + lines.encode() + b"\n" + body
+    for off in range(0, len(payload), 65535):
+        writer.write(record(STDOUT, rid, payload[off:off + 65535]))
+    writer.write(record(STDOUT, rid))
+    writer.write(record(END_REQUEST, rid, struct.pack("!IB3x", 0, 0)))
+    await writer.drain()
+
+
+async def handle(reader, writer):
+    requests, active = {}, set()
+
+    async def run(rid, params, body):
+        await respond(writer, rid, params, body)
+        active.discard(rid)
+    try:
+        while True:
+            header = await reader.readexactly(8)
+            _, rtype, rid, clen, plen, _ = struct.unpack("!BBHHBB", header)
+            content = await reader.readexactly(clen)
+            await reader.readexactly(plen)
+            if rtype == GET_VALUES:
+                wanted = decode_pairs(content)
+                values = {k: "1" if MPXS else "0" for k in wanted if k == "FCGI_MPXS_CONNS"}
+                writer.write(record(GET_VALUES_RESULT, 0, encode_pairs(values)))
+            elif rtype == BEGIN_REQUEST:
+                if not MPXS and active:
+                    writer.write(record(END_REQUEST, rid, struct.pack("!IB3x", 0, CANT_MPX_CONN)))
+                    continue
+                requests[rid] = {"params": b"", "stdin": b""}
+                active.add(rid)
+            elif rtype == ABORT_REQUEST:
+                requests.pop(rid, None)
+                active.discard(rid)
+                writer.write(record(END_REQUEST, rid, struct.pack("!IB3x", 1, 0)))
+            elif rtype == PARAMS and rid in requests:
+                requests[rid]["params"] += content
+            elif rtype == STDIN and rid in requests:
+                if content:
+                    requests[rid]["stdin"] += content
+                else:
+                    req = requests.pop(rid)
+                    asyncio.ensure_future(
+                        run(rid, decode_pairs(req["params"]), req["stdin"]))
+    except (asyncio.IncompleteReadError, ConnectionError):
+        writer.close()
+
+
+async def main(address):
+    if address.startswith("unix:"):
+        server = await asyncio.start_unix_server(handle, path=address[5:])
+    else:
+        host, port = address.rsplit(":", 1)
+        server = await asyncio.start_server(handle, host, int(port))
+    async with server:
+        await server.serve_forever()
+
+
+if __name__ == "__main__":
+    try:
+        args = [a for a in sys.argv[1:] if a != "--no-mpxs"]
+        asyncio.run(main(args[0] if args else "127.0.0.1:9000"))
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+http_backend.py — Serveur HTTP/1.1 de remplacement derrière proxy_pass
+
+Usage:
+    python3 tests/http_backend.py PORT [PORT...]   (un serveur par port)
+
+Chaque réponse décrit ce que le backend a reçu, une ligne "clé=valeur"
+par information : port du backend, port source de la connexion (pour
+vérifier la réutilisation keep-alive), méthode, URI, taille et somme du
+body, en-têtes. Paramètres de la query :
+    chunked=1   corps en Transfer-Encoding: chunked
+    close=1     corps délimité par la fermeture de la connexion
+    length=V    annonce "Content-Length: V" tel quel (même invalide), puis ferme
+    size=N      N octets de remplissage après la description
+"""
+
+import sys
+import threading
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlsplit, parse_qs
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, *args):
+        pass
+
+    def _respond(self):
+        length = int(self.headers.get("Content-Length", "0"))
+        body = self.rfile.read(length) if length else b""
+        query = parse_qs(urlsplit(self.path).query)
+        lines = [
+            f"backend={self.server.server_port}",
+            f"peer={self.client_address[1]}",
+            f"method={self.command}",
+            f"uri={self.path}",
+            f"body_length={len(body)}",
+            f"body_crc={zlib.crc32(body)}",
+        ]
+        lines += [f"h-{k.lower()}={v}" for k, v in self.headers.items()]
+        payload = ("\n".join(lines) + "\n").encode()
+        payload += b"x" * int(query.get("size", ["0"])[0])
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("X-Backend", str(self.server.server_port))
+        if "chunked" in query:
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            for off in range(0, len(payload), 1000):
+                part = payload[off:off + 1000]
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(part), part))
+            self.wfile.write(b"0\r\n\r\n")
+        elif "length" in query:
+            self.send_header("Content-Length", query["length"][0])
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.wfile.write(payload)
+            self.close_connection = True
+        elif "close" in query:
+            self.send_header("Connection", "close")
+            self.end_headers()
+            self.wfile.write(payload)
+            self.close_connection = True
+        else:
+            self.send_header("Content-Length", str(len(payload)))
+            self.end_headers()
+            self.wfile.write(payload)
+
+    do_GET = _respond
+    do_POST = _respond
+    do_DELETE = _respond
+
+
+def serve(port):
+    ThreadingHTTPServer(("127.0.0.1", port), Handler).serve_forever()
+
+
+if __name__ == "__main__":
+    ports = [int(p) for p in sys.argv[1:]] or [9101]
+    for port in ports[1:]:
+        threading.Thread(target=serve, args=(port,), daemon=True).start()
+    try:
+        serve(ports[0])
+    except KeyboardInterrupt:
+        pass
@@ -16,6 +16,8 @@ import time
 import sys
 import os
 import threading
+import subprocess
+import zlib
 
 # ─── Configuration ────────────────────────────────────────────────────────────
 HOST1 = "127.0.0.1"; PORT1 = 8080  # Serveur 1 – statique
@@ -46,15 +48,7 @@ def send_raw(host, port, raw_request, timeout=TIMEOUT):
         s.settimeout(timeout)
         s.connect((host, port))
         s.sendall(raw_request.encode() if isinstance(raw_request, str) else raw_request)
-        response = b""
-        while True:
-            try:
-                chunk = s.recv(4096)
-                if not chunk:
-                    break
-                response += chunk
-            except socket.timeout:
-                break
+        response = read_all(s)
         s.close()
         return parse_response(response)
     except Exception as e:
@@ -67,20 +61,68 @@ def send_raw_bytes(host, port, data, timeout=TIMEOUT):
         s.settimeout(timeout)
         s.connect((host, port))
         s.sendall(data)
-        response = b""
-        while True:
-            try:
-                chunk = s.recv(4096)
-                if not chunk:
-                    break
-                response += chunk
-            except socket.timeout:
-                break
+        response = read_all(s)
         s.close()
         return parse_response(response)
     except Exception as e:
         return (0, {}, f"CONNECTION_ERROR: {e}")
 
+def read_all(s, on_timeout=b""):
+    """Lit jusqu'à la fermeture par le serveur ; on_timeout est ajouté si le délai expire avant"""
+    data = b""
+    try:
+        while True:
+            chunk = s.recv(65536)
+            if not chunk:
+                return data
+            data += chunk
+    except socket.timeout:
+        return data + on_timeout
+
+def read_response(s):
+    """Lit une seule réponse sur une connexion persistante → bytes bruts (en-têtes + corps)
+    Lève ConnectionError si le serveur ferme avant la fin de la réponse"""
+    def more(data):
+        chunk = s.recv(65536)
+        if not chunk:
+            raise ConnectionError("connexion fermée avant la fin de la réponse")
+        return data + chunk
+
+    data = b""
+    while b"\r\n\r\n" not in data:
+        data = more(data)
+    end = data.index(b"\r\n\r\n") + 4
+    headers = {}
+    for line in data[:end].split(b"\r\n")[1:]:
+        k, _, v = line.partition(b":")
+        headers[k.strip().lower()] = v.strip().lower()
+    if headers.get(b"transfer-encoding") == b"chunked":
+        while True:
+            while b"\r\n" not in data[end:]:
+                data = more(data)
+            line_end = data.index(b"\r\n", end)
+            size = int(data[end:line_end].split(b";")[0], 16)
+            end = line_end + 2 + size + 2
+            while len(data) < end:
+                data = more(data)
+            if size == 0:
+                return data[:end]
+    end += int(headers.get(b"content-length", b"0"))
+    while len(data) < end:
+        data = more(data)
+    return data[:end]
+
+def dechunk(body):
+    """Décode un corps Transfer-Encoding: chunked (bytes)"""
+    out = b""
+    while True:
+        size, _, body = body.partition(b"\r\n")
+        size = int(size, 16)
+        if size == 0:
+            return out
+        out += body[:size]
+        body = body[size + 2:]
+
 def parse_response(raw):
     """Parse une réponse HTTP brute → (status_code, headers, body_str)"""
     if not raw:
@@ -237,11 +279,19 @@ def test_redirects():
           hdrs.get("location","").endswith("/new"),
           hdrs.get("location",""))
 
+    for path, target in (("/old/page", "/new/page"), ("/old/page/x", "/new"),
+                         ("/old/pages", "/new"), ("/old/page?q=1", "/new/page")):
+        code, hdrs, _ = send_raw(HOST3, PORT3,
+            f"GET {path} HTTP/1.1\r\nHost: 127.0.0.1:8082\r\nConnection: close\r\n\r\n")
+        check(f"location = /old/page : {path} → {target}",
+              code == 301 and hdrs.get("location", "").endswith(target),
+              hdrs.get("location", ""))
+
 
 def test_body_size_limit():
     section("6. Limite taille body (max_body_size)")
 
-    # Server 2: max_body_size = 5 000 000 octets → envoyer 6 Mo doit donner 413
+    # Server 2: max_body_size = 5m (5 Mio) → envoyer 6 Mo doit donner 413
     big_body = "X" * 6_000_000
     req = (
         f"POST /upload/big.bin HTTP/1.1\r\n"
@@ -267,6 +317,39 @@ def test_body_size_limit():
     code2, _, _ = send_raw(HOST3, PORT3, req2, timeout=10)
     check("Body > max_body_size server3 → 405 ou 413", code2 in (405, 413), f"got {code2}")
 
+    def expect(length, path="/upload/expect.bin"):
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        s.sendall(f"POST {path} HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+                  f"Content-Length: {length}\r\nExpect: 100-continue\r\n"
+                  "Connection: close\r\n\r\n".encode())
+        return s, s.recv(4096).decode(errors="replace")
+
+    try:
+        # Refus sur le seul Content-Length, sans attendre le corps
+        s, interim = expect(2_000_000)
+        s.close()
+        check("Expect + Content-Length > max_body_size de la location → 413 immédiat",
+              interim.startswith("HTTP/1.1 413"), interim[:40])
+        s, interim = expect(5)
+        s.sendall(b"hello")
+        final = read_all(s)
+        s.close()
+        whole = interim.encode() + final
+        check("Expect accepté → 100 Continue puis 201",
+              whole.startswith(b"HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 201"), whole[:60])
+        # Corps envoyé avec les en-têtes : pas de réponse intermédiaire
+        code, _, _ = send_raw(HOST2, PORT2,
+            "POST /upload/expect.bin HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nContent-Length: 5\r\n"
+            "Expect: 100-continue\r\nConnection: close\r\n\r\nhello")
+        check("Expect avec le corps déjà envoyé → 201 sans 100", code == 201, f"got {code}")
+        chunked = b"".join(b"10000\r\n" + b"Z" * 0x10000 + b"\r\n" for _ in range(20))
+        req3 = (b"POST /upload/chunked_big.bin HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+                b"Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n" + chunked + b"0\r\n\r\n")
+        code3, _, _ = send_raw_bytes(HOST2, PORT2, req3, timeout=10)
+        check("Chunked dépassant max_body_size → 413", code3 == 413, f"got {code3}")
+    except Exception as e:
+        check("Expect: 100-continue", False, str(e))
+
 
 def test_cgi():
     section("7. Exécution CGI (Python)")
@@ -300,6 +383,13 @@ def test_cgi():
     check("CGI POST → 200", code == 200, f"got {code}")
     check("CGI reçoit body POST", "message=hello" in body or "POST" in body, body[:400])
 
+    # Content-Length invalide dans la sortie du script : ignoré, corps en chunked
+    code, hdrs, body = send_raw(HOST2, PORT2,
+        "GET /scripts/stream.py?length=12abc HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+    check("CGI Content-Length invalide ignoré (chunked)",
+          code == 200 and hdrs.get("transfer-encoding") == "chunked"
+          and "content-length" not in hdrs and "part 2" in body, f"got {code} {hdrs}")
+
     # Script CGI inexistant → 404
     code, _, _ = send_raw(HOST2, PORT2,
         "GET /scripts/ghost.py HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
@@ -341,6 +431,31 @@ def test_chunked_upload():
     code, _, _ = send_raw_bytes(HOST2, PORT2, req)
     check("POST chunked → 201 ou 200", code in (200, 201), f"got {code}")
 
+    # Décodage au fil de l'eau : "0\r\n\r\n" dans les données, extensions,
+    # trailer, et requête découpée en petits morceaux
+    data = b"avant 0\r\n\r\n milieu 0\r\n\r\n apres" * 50
+    chunked = (b"%x;ext=1\r\n" % 700 + data[:700] + b"\r\n"
+               + b"%x\r\n" % (len(data) - 700) + data[700:] + b"\r\n"
+               + b"0\r\nX-Checksum: 42\r\n\r\n")
+    req = (b"POST /upload/chunked_stream.txt HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+           b"Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n" + chunked)
+    try:
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        for i in range(0, len(req), 97):
+            s.sendall(req[i:i + 97])
+            time.sleep(0.001)
+        reply = s.recv(4096)
+        s.close()
+        with open("www/server2/uploads/chunked_stream.txt", "rb") as f:
+            stored = f.read()
+        check("Chunked fragmenté avec trailer → corps décodé intact",
+              reply.startswith(b"HTTP/1.1 201") and stored == data, reply[:30])
+    except Exception as e:
+        check("Chunked fragmenté", False, str(e))
+    finally:
+        if os.path.exists("www/server2/uploads/chunked_stream.txt"):
+            os.remove("www/server2/uploads/chunked_stream.txt")
+
 
 def test_slow_client():
     section("10. Client lent (requête fragmentée)")
@@ -360,15 +475,7 @@ def test_slow_client():
         time.sleep(0.1)
         s.sendall(b"Connection: close\r\n\r\n")
 
-        response = b""
-        while True:
-            try:
-                chunk = s.recv(4096)
-                if not chunk:
-                    break
-                response += chunk
-            except socket.timeout:
-                break
+        response = read_all(s)
         s.close()
         code, _, _ = parse_response(response)
         check("Client lent → 200", code == 200, f"got {code}")
@@ -488,6 +595,16 @@ def test_multiple_ports_independence():
           body1 != body3 or (code1 == code3 == 200),
           "même contenu sur les deux ports")
 
+    # Hôtes virtuels sur 8082 : server3 par défaut, server4 via jokers
+    def host_body(host):
+        return send_raw(HOST3, PORT3,
+            f"GET / HTTP/1.1\r\nHost: {host}\r\nConnection: close\r\n\r\n")[2]
+    default = host_body("test.localhost")
+    for host in ("a.wild.localhost", "A.B.Wild.Localhost:8082", "www.wild.example"):
+        check(f"Host {host} → server_name joker", host_body(host) not in ("", default))
+    for host in ("wild.localhost", "inconnu.localhost"):
+        check(f"Host {host} → serveur par défaut du port", host_body(host) == default)
+
 
 def test_content_length_header():
     section("15. Exactitude des headers de réponse")
@@ -503,6 +620,836 @@ def test_content_length_header():
                   f"header={cl}, body len={len(body.encode('utf-8', errors='replace'))}")
 
 
+def test_keep_alive():
+    section("16. Connexions persistantes (keep-alive)")
+
+    try:
+        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        s.settimeout(TIMEOUT)
+        s.connect((HOST1, PORT1))
+        codes = []
+        for _ in range(3):
+            s.sendall(b"GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\n\r\n")
+            code, hdrs, _ = parse_response(read_response(s))
+            codes.append(code)
+        check("3 requêtes HTTP/1.1 sur la même connexion → 200",
+              codes == [200, 200, 200], f"got {codes}")
+        check("Connection: keep-alive annoncé",
+              hdrs.get("connection", "").lower() == "keep-alive", hdrs.get("connection"))
+        s.sendall(b"GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n\r\n")
+        read_response(s)
+        check("Connection: close → le serveur ferme", s.recv(4096) == b"")
+        s.close()
+    except Exception as e:
+        check("Keep-alive HTTP/1.1", False, str(e))
+
+    try:
+        s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        s.settimeout(TIMEOUT)
+        s.connect((HOST1, PORT1))
+        s.sendall(b"GET / HTTP/1.0\r\nHost: 127.0.0.1:8080\r\n\r\n")
+        code, hdrs, _ = parse_response(read_response(s))
+        check("HTTP/1.0 sans keep-alive → fermeture",
+              code == 200 and s.recv(4096) == b"", f"got {code}")
+        s.close()
+    except Exception as e:
+        check("HTTP/1.0 fermeture par défaut", False, str(e))
+
+def test_fastcgi():
+    section("17. FastCGI (fastcgi_pass)")
+    responder = subprocess.Popen([sys.executable, "tests/fcgi_responder.py", "127.0.0.1:9000"],
+                                 stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    time.sleep(0.5)
+    try:
+        code, _, body = send_raw(HOST2, PORT2,
+            "GET /fcgi/app.py?name=webserv HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+        check("GET /fcgi/app.py → 200", code == 200, f"got {code}")
+        check("Environnement CGI transmis (QUERY_STRING)", "QUERY_STRING=name=webserv" in body)
+        code, _, body = send_raw(HOST2, PORT2,
+            "POST /fcgi/app.py HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nContent-Length: 11\r\n"
+            "Connection: close\r\n\r\nhello fcgi!")
+        check("POST → body relayé au backend", code == 200 and "hello fcgi!" in body, f"got {code}")
+        code, _, body = send_raw(HOST2, PORT2,
+            "POST /fcgi/app.py HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nTransfer-Encoding: chunked\r\n"
+            "Connection: close\r\n\r\n6\r\nhello \r\n5\r\nfcgi!\r\n0\r\nX-Checksum: 42\r\n\r\n")
+        check("Chunked décodé : CONTENT_LENGTH, trailer transmis, plus de Transfer-Encoding",
+              code == 200 and "CONTENT_LENGTH=11" in body and "HTTP_X_CHECKSUM=42" in body
+              and "TRANSFER_ENCODING" not in body and "hello fcgi!" in body, body[:300])
+
+        # Corps sur disque relus par tranches, deux à la fois sur la connexion multiplexée
+        bodies = {}
+        def upload(tag):
+            payload = (tag * 16 + b"0123456789abcdef" * 4095) * 48   # ~3 Mo
+            req = (f"POST /fcgi/app.py HTTP/1.0\r\nHost: 127.0.0.1:8081\r\n"
+                   f"Content-Length: {len(payload)}\r\n\r\n").encode()
+            code, _, body = send_raw_bytes(HOST2, PORT2, req + payload, timeout=10)
+            bodies[tag] = (code, body.encode().endswith(b"\n" + payload), len(payload))
+        threads = [threading.Thread(target=upload, args=(t,)) for t in (b"A", b"B")]
+        for t in threads: t.start()
+        for t in threads: t.join()
+        check("Gros corps (spool) transmis intact en FCGI_STDIN",
+              all(c == 200 and ok for c, ok, _ in bodies.values()) and len(bodies) == 2, str(bodies))
+
+        results = []
+        def worker():
+            code, _, _ = send_raw(HOST2, PORT2,
+                "GET /fcgi/slow?sleep=1 HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+            results.append(code)
+        start = time.time()
+        threads = [threading.Thread(target=worker) for _ in range(8)]
+        for t in threads: t.start()
+        for t in threads: t.join()
+        elapsed = time.time() - start
+        check("8 requêtes lentes multiplexées en parallèle",
+              results == [200] * 8 and elapsed < 3, f"{results} en {elapsed:.1f}s")
+
+        # Réponse streamée (HTTP/1.0 : corps délimité par la fermeture) dont
+        # la fin arrive avec FCGI_END_REQUEST
+        payload = b"0123456789abcdef" * 32768
+        req = (f"POST /fcgi/app.py HTTP/1.0\r\nHost: 127.0.0.1:8081\r\n"
+               f"Content-Length: {len(payload)}\r\n\r\n").encode()
+        code, _, body = send_raw_bytes(HOST2, PORT2, req + payload, timeout=10)
+        check("Grosse réponse streamée reçue en entier", code == 200
+              and body.encode().endswith(b"\n" + payload), f"got {code}, {len(body)} octets")
+    finally:
+        responder.terminate()
+        responder.wait()
+    time.sleep(0.2)
+    code, _, _ = send_raw(HOST2, PORT2,
+        "GET /fcgi/app.py HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+    check("Backend arrêté → 502", code == 502, f"got {code}")
+
+    # Backend sans multiplexage (php-fpm) : une requête par connexion, au-delà
+    # de FASTCGI_MAX_CONNS (4) les requêtes attendent une place
+    responder = subprocess.Popen([sys.executable, "tests/fcgi_responder.py", "127.0.0.1:9000",
+                                  "--no-mpxs"], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    time.sleep(0.5)
+    try:
+        results = []
+        def worker():
+            code, _, _ = send_raw(HOST2, PORT2,
+                "GET /fcgi/slow?sleep=0.5 HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+            results.append(code)
+        threads = [threading.Thread(target=worker) for _ in range(10)]
+        for t in threads: t.start()
+        for t in threads: t.join()
+        check("10 requêtes concurrentes, backend sans FCGI_MPXS_CONNS → toutes 200",
+              results == [200] * 10, str(results))
+    finally:
+        responder.terminate()
+        responder.wait()
+
+def test_client_timeouts():
+    section("18. Délais client (client_header_timeout / client_body_timeout)")
+
+    def wait_reply(s):
+        start = time.time()
+        data = read_all(s)
+        return data, time.time() - start
+
+    try:
+        s = socket.create_connection((HOST3, PORT3), timeout=8)
+        data, elapsed = wait_reply(s)
+        s.close()
+        check("Connexion muette → fermée sans réponse", data == b"" and elapsed < 4,
+              f"{len(data)} octets en {elapsed:.1f}s")
+
+        s = socket.create_connection((HOST3, PORT3), timeout=8)
+        s.sendall(b"GET / HTTP/1.1\r\nHost: 127.0.0.1:8082\r\n")
+        data, elapsed = wait_reply(s)
+        s.close()
+        code, _, _ = parse_response(data)
+        check("En-têtes incomplets → 408", code == 408 and elapsed < 4,
+              f"got {code} en {elapsed:.1f}s")
+
+        s = socket.create_connection((HOST3, PORT3), timeout=8)
+        s.sendall(b"POST / HTTP/1.1\r\nHost: 127.0.0.1:8082\r\nContent-Length: 100\r\n\r\nabc")
+        data, elapsed = wait_reply(s)
+        s.close()
+        code, _, _ = parse_response(data)
+        check("Corps interrompu → 408", code == 408 and elapsed < 4,
+              f"got {code} en {elapsed:.1f}s")
+
+        # Même port, autre vhost : son client_body_timeout (1s) s'applique
+        s = socket.create_connection((HOST3, PORT3), timeout=8)
+        s.sendall(b"POST / HTTP/1.1\r\nHost: a.wild.localhost\r\nContent-Length: 100\r\n\r\nabc")
+        data, elapsed = wait_reply(s)
+        s.close()
+        code, _, _ = parse_response(data)
+        check("client_body_timeout du vhost résolu par Host", code == 408 and elapsed < 1.6,
+              f"got {code} en {elapsed:.1f}s")
+    except Exception as e:
+        check("Délais client", False, str(e))
+
+def test_conditional_requests():
+    section("19. Requêtes conditionnelles (ETag / Last-Modified / expires)")
+
+    req = "GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n"
+    code, hdrs, _ = send_raw(HOST1, PORT1, req + "\r\n")
+    etag, modified = hdrs.get("etag", ""), hdrs.get("last-modified", "")
+    check("ETag et Last-Modified présents", code == 200 and etag and modified, f"headers: {hdrs}")
+    check("expires 1h → Cache-Control: max-age=3600",
+          hdrs.get("cache-control") == "max-age=3600" and "expires" in hdrs, hdrs.get("cache-control"))
+
+    code, hdrs, body = send_raw(HOST1, PORT1, req + f"If-None-Match: {etag}\r\n\r\n")
+    check("If-None-Match identique → 304 sans corps", code == 304 and body == "", f"got {code}")
+    check("304 garde l'ETag", hdrs.get("etag") == etag)
+    code, _, _ = send_raw(HOST1, PORT1, req + 'If-None-Match: "autre", W/' + etag + "\r\n\r\n")
+    check("If-None-Match en liste (comparaison faible) → 304", code == 304, f"got {code}")
+    code, _, _ = send_raw(HOST1, PORT1, req + 'If-None-Match: "autre"\r\n\r\n')
+    check("If-None-Match différent → 200", code == 200, f"got {code}")
+    code, _, _ = send_raw(HOST1, PORT1, req + f"If-Modified-Since: {modified}\r\n\r\n")
+    check("If-Modified-Since = Last-Modified → 304", code == 304, f"got {code}")
+    code, _, _ = send_raw(HOST1, PORT1,
+        req + "If-Modified-Since: Thu, 01 Jan 1970 00:00:00 GMT\r\n\r\n")
+    check("If-Modified-Since ancien → 200", code == 200, f"got {code}")
+
+def test_byte_ranges():
+    section("20. Requêtes partielles (Range / 206 / 416)")
+
+    req = "GET /website.html HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n"
+    _, hdrs, full = send_raw(HOST1, PORT1, req + "\r\n")
+    size = len(full.encode())
+    check("Accept-Ranges: bytes annoncé", hdrs.get("accept-ranges") == "bytes", f"headers: {hdrs}")
+
+    code, hdrs, body = send_raw(HOST1, PORT1, req + "Range: bytes=0-9\r\n\r\n")
+    check("bytes=0-9 → 206 + 10 octets", code == 206 and body == full[:10], f"got {code}")
+    check("Content-Range exact", hdrs.get("content-range") == f"bytes 0-9/{size}",
+          hdrs.get("content-range"))
+    code, _, body = send_raw(HOST1, PORT1, req + "Range: bytes=-5\r\n\r\n")
+    check("Suffixe bytes=-5 → 5 derniers octets", code == 206 and body == full[-5:], f"got {code}")
+    code, hdrs, body = send_raw(HOST1, PORT1, req + "Range: bytes=0-4, 10-14\r\n\r\n")
+    check("Plusieurs plages → multipart/byteranges",
+          code == 206 and hdrs.get("content-type", "").startswith("multipart/byteranges")
+          and full[:5] in body and full[10:15] in body and len(body) == int(hdrs.get("content-length", -1)),
+          f"got {code}")
+    code, hdrs, _ = send_raw(HOST1, PORT1, req + f"Range: bytes={size}-\r\n\r\n")
+    check("Plage hors fichier → 416", code == 416 and hdrs.get("content-range") == f"bytes */{size}",
+          f"got {code}")
+    code, _, _ = send_raw(HOST1, PORT1, req + 'Range: bytes=0-9\r\nIf-Range: "perime"\r\n\r\n')
+    check("If-Range périmé → fichier entier (200)", code == 200, f"got {code}")
+
+def test_gzip_static():
+    section("21. Fichiers précompressés (gzip_static)")
+    import gzip
+
+    path = "www/server1/gzip_test.css"
+    content = b"body { color: pink; }\n" * 200
+    with open(path, "wb") as f:
+        f.write(content)
+    with open(path + ".gz", "wb") as f:
+        f.write(gzip.compress(content))
+    req = "GET /gzip_test.css HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n"
+    try:
+        s = socket.create_connection((HOST1, PORT1), timeout=TIMEOUT)
+        s.sendall((req + "Accept-Encoding: br, gzip;q=0.8\r\n\r\n").encode())
+        raw = read_all(s)
+        s.close()
+        head, _, body = raw.partition(b"\r\n\r\n")
+        head = head.decode().lower()
+        check("Accept-Encoding: gzip → Content-Encoding: gzip",
+              "content-encoding: gzip" in head and gzip.decompress(body) == content, head)
+        check("Type MIME d'origine conservé", "content-type: text/css" in head)
+        check("Vary: Accept-Encoding", "vary: accept-encoding" in head)
+
+        code, hdrs, body = send_raw(HOST1, PORT1, req + "\r\n")
+        check("Sans Accept-Encoding → fichier d'origine",
+              code == 200 and "content-encoding" not in hdrs and body.encode() == content, f"got {code}")
+        code, hdrs, _ = send_raw(HOST1, PORT1, req + "Accept-Encoding: gzip;q=0, *\r\n\r\n")
+        check("gzip;q=0 → fichier d'origine", code == 200 and "content-encoding" not in hdrs)
+    finally:
+        os.remove(path)
+        os.remove(path + ".gz")
+
+def test_gzip_dynamic():
+    section("22. Compression à la volée (gzip)")
+    import gzip
+
+    def fetch(port, path):
+        s = socket.create_connection((HOST1, port), timeout=TIMEOUT)
+        s.sendall(f"GET {path} HTTP/1.1\r\nHost: 127.0.0.1:{port}\r\n"
+                  "Accept-Encoding: gzip\r\nConnection: close\r\n\r\n".encode())
+        raw = read_all(s)
+        s.close()
+        head, _, body = raw.partition(b"\r\n\r\n")
+        head = head.decode().lower()
+        if "transfer-encoding: chunked" in head:
+            body = dechunk(body)
+        return head, body
+
+    try:
+        head, body = fetch(PORT1, "/website.html")
+        with open("www/server1/website.html", "rb") as f:
+            original = f.read()
+        check("Fichier statique compressé (Content-Encoding: gzip)",
+              "content-encoding: gzip" in head and gzip.decompress(body) == original, head)
+        check("ETag faible pour la version compressée", 'etag: w/"' in head)
+        head, body = fetch(PORT2, "/scripts/hello.py?x=1")
+        check("Sortie CGI compressée en chunks",
+              "content-encoding: gzip" in head and b"QUERY_STRING : x=1" in gzip.decompress(body),
+              head)
+        code, hdrs, _ = send_raw(HOST1, PORT1,
+            "GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n\r\n")
+        check("Sans Accept-Encoding → identité + Vary",
+              code == 200 and "content-encoding" not in hdrs and hdrs.get("vary") == "Accept-Encoding")
+    except Exception as e:
+        check("Compression gzip", False, str(e))
+
+
+def test_body_spool():
+    section("23. Gros corps de requête écrits sur disque (client_body_buffer_size)")
+    payload = bytes(range(256)) * 800          # 200 Ko, au-delà des 16k en mémoire
+    uploads = "www/server2/uploads"
+    try:
+        req = (b"POST /upload/spool_test.bin HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+               + f"Content-Length: {len(payload)}\r\nConnection: close\r\n\r\n".encode()
+               + payload)
+        code, _, _ = send_raw_bytes(HOST2, PORT2, req)
+        with open(os.path.join(uploads, "spool_test.bin"), "rb") as f:
+            stored = f.read()
+        check("Upload 200 Ko → 201 et contenu intact", code == 201 and stored == payload,
+              f"got {code}, {len(stored)} octets")
+        chunked = b"".join(b"%x\r\n" % len(payload[i:i + 30000]) + payload[i:i + 30000] + b"\r\n"
+                           for i in range(0, len(payload), 30000)) + b"0\r\n\r\n"
+        req = (b"POST /upload/spool_chunked.bin HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+               b"Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n" + chunked)
+        code, _, _ = send_raw_bytes(HOST2, PORT2, req)
+        with open(os.path.join(uploads, "spool_chunked.bin"), "rb") as f:
+            stored = f.read()
+        check("Upload chunked 200 Ko → contenu intact", code == 201 and stored == payload,
+              f"got {code}, {len(stored)} octets")
+        leftovers = [n for n in os.listdir(uploads) if n.startswith(".webserv-body-")]
+        check("Aucun fichier temporaire restant", not leftovers, str(leftovers))
+        text = "x" * 50000 + "FIN_DU_CORPS"
+        req = (f"POST /scripts/hello.py HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+               f"Content-Length: {len(text)}\r\nConnection: close\r\n\r\n{text}")
+        code, _, body = send_raw(HOST2, PORT2, req)
+        check("CGI lit un corps resté sur disque", code == 200 and "FIN_DU_CORPS" in body,
+              f"got {code}")
+    except Exception as e:
+        check("Corps sur disque", False, str(e))
+    finally:
+        for name in ("spool_test.bin", "spool_chunked.bin"):
+            if os.path.exists(os.path.join(uploads, name)):
+                os.remove(os.path.join(uploads, name))
+
+
+def test_multipart_upload():
+    section("24. Upload multipart/form-data")
+    uploads = "www/server2/uploads"
+    boundary = "----webservBoundary7MA4YWxk"
+    first = bytes(range(256)) * 300 + b"\r\n--" + boundary[:-3].encode() + b" pas la fin"
+    second = b"deuxieme fichier\r\n"
+    body = (f"--{boundary}\r\nContent-Disposition: form-data; name=\"comment\"\r\n\r\n"
+            "simple champ\r\n"
+            f"--{boundary}\r\nContent-Disposition: form-data; name=\"a\"; filename=\"image.bin\"\r\n"
+            "Content-Type: application/octet-stream\r\n\r\n").encode() + first + (
+            f"\r\n--{boundary}\r\nContent-Disposition: form-data; name=\"b\"; "
+            "filename=\"../../notes.txt\"\r\n\r\n").encode() + second + (
+            f"\r\n--{boundary}--\r\n").encode()
+    req = (f"POST /upload/ HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+           f"Content-Type: multipart/form-data; boundary={boundary}\r\n"
+           f"Content-Length: {len(body)}\r\nConnection: close\r\n\r\n").encode() + body
+    try:
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        for i in range(0, len(req), 1000):
+            s.sendall(req[i:i + 1000])
+        reply = s.recv(4096)
+        s.close()
+        check("POST multipart → 201", reply.startswith(b"HTTP/1.1 201"), reply[:30])
+        with open(os.path.join(uploads, "image.bin"), "rb") as f:
+            check("Partie binaire écrite sans les délimiteurs", f.read() == first)
+        with open(os.path.join(uploads, "notes.txt"), "rb") as f:
+            check("Nom de fichier réduit à son dernier composant", f.read() == second)
+        leftovers = [n for n in os.listdir(uploads) if n.startswith(".webserv-")]
+        check("Aucun fichier temporaire restant", not leftovers, str(leftovers))
+        truncated = req[:len(req) - 20]
+        truncated = truncated.replace(f"Content-Length: {len(body)}".encode(),
+                                      f"Content-Length: {len(body) - 20}".encode())
+        code, _, _ = send_raw_bytes(HOST2, PORT2, truncated)
+        check("Multipart sans délimiteur final → 400", code == 400, f"got {code}")
+    except Exception as e:
+        check("Upload multipart", False, str(e))
+    finally:
+        for name in ("image.bin", "notes.txt"):
+            if os.path.exists(os.path.join(uploads, name)):
+                os.remove(os.path.join(uploads, name))
+
+
+def test_reverse_proxy():
+    section("25. Reverse proxy (proxy_pass / upstream)")
+
+    def start(port):
+        return subprocess.Popen([sys.executable, "tests/http_backend.py", str(port)],
+                                stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+    def fields(body):
+        return dict(l.split("=", 1) for l in body.splitlines() if "=" in l)
+
+    def exchange(s, path):
+        s.sendall(f"GET {path} HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n\r\n".encode())
+        code, _, body = parse_response(read_response(s))
+        return code, fields(body)
+
+    backends = {9101: start(9101), 9102: start(9102)}
+    time.sleep(0.5)
+    try:
+        # Une seule connexion cliente : un seul worker, donc un seul état d'upstream
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        seen = [exchange(s, "/api/hello?n=1")[1] for _ in range(4)]
+        check("URI réécrite (/api → /v1)", seen[0].get("uri") == "/v1/hello?n=1", str(seen[0]))
+        check("Round-robin sur les deux backends",
+              {f.get("backend") for f in seen} == {"9101", "9102"}, str(seen))
+        by_backend = {}
+        for f in seen:
+            by_backend.setdefault(f.get("backend"), set()).add(f.get("peer"))
+        check("Connexions keep-alive vers le backend réutilisées",
+              all(len(p) == 1 for p in by_backend.values()), str(by_backend))
+
+        code, headers, body = send_raw(HOST2, PORT2,
+            "GET /api/c?chunked=1&size=20000 HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+            "Connection: close\r\n\r\n")
+        check("Réponse chunked du backend relayée", code == 200
+              and headers.get("x-backend") in ("9101", "9102") and body.count("x") >= 20000,
+              f"got {code}")
+
+        payload = os.urandom(200000)
+        req = (f"POST /api/upload HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+               f"Content-Length: {len(payload)}\r\nConnection: close\r\n\r\n").encode() + payload
+        code, _, body = send_raw_bytes(HOST2, PORT2, req)
+        f = fields(body)
+        check("Gros body (spool) transmis intact", code == 200
+              and f.get("body_length") == str(len(payload))
+              and f.get("body_crc") == str(zlib.crc32(payload)), f"got {code} {f}")
+
+        code, _, _ = send_raw(HOST2, PORT2,
+            "GET /api/l?length=12abc HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+        check("Content-Length invalide du backend → 502", code == 502, f"got {code}")
+
+        sticky = set()
+        for _ in range(4):
+            _, _, body = send_raw(HOST2, PORT2,
+                "GET /sticky/key42 HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+            sticky.add(fields(body).get("backend"))
+        check("hash $request_uri : même URI, même backend", len(sticky) == 1, str(sticky))
+
+        backends[9102].terminate()
+        backends[9102].wait()
+        time.sleep(0.2)
+        results = [exchange(s, "/api/failover") for _ in range(4)]
+        s.close()
+        check("Backend arrêté : requêtes reprises par l'autre",
+              all(c == 200 and f.get("backend") == "9101" for c, f in results), str(results))
+    except Exception as e:
+        check("Reverse proxy", False, str(e))
+    finally:
+        for proc in backends.values():
+            proc.terminate()
+            proc.wait()
+    time.sleep(0.2)
+    code, _, _ = send_raw(HOST2, PORT2,
+        "GET /api/x HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+    check("Aucun backend joignable → 502", code == 502, f"got {code}")
+
+    # Backends qui lisent la requête puis ferment sans répondre
+    seen, listeners = [], []
+
+    def drop(srv):
+        while True:
+            try:
+                c, _ = srv.accept()
+            except OSError:
+                return
+            data = b""
+            c.settimeout(1)
+            try:
+                while b"\r\n\r\n" not in data:
+                    chunk = c.recv(4096)
+                    if not chunk:
+                        break
+                    data += chunk
+            except OSError:
+                pass
+            if data:
+                seen.append(data.split(b" ", 1)[0].decode())
+            c.close()
+
+    for port in (9101, 9102):
+        srv = socket.socket()
+        srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        srv.bind(("127.0.0.1", port))
+        srv.listen(8)
+        listeners.append(srv)
+        threading.Thread(target=drop, args=(srv,), daemon=True).start()
+    try:
+        code, _, _ = send_raw(HOST2, PORT2,
+            "PATCH /api/p HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nContent-Length: 2\r\n"
+            "Connection: close\r\n\r\nok")
+        check("PATCH envoyé sans réponse : pas rejoué sur l'autre backend",
+              code == 502 and seen.count("PATCH") == 1, f"got {code} {seen}")
+        code, _, _ = send_raw(HOST2, PORT2,
+            "GET /api/g HTTP/1.1\r\nHost: 127.0.0.1:8081\r\nConnection: close\r\n\r\n")
+        check("GET sans réponse : rejoué sur l'autre backend",
+              code == 502 and seen.count("GET") == 2, f"got {code} {seen}")
+    finally:
+        for srv in listeners:
+            srv.shutdown(socket.SHUT_RDWR)
+            srv.close()
+
+
+def test_response_cache():
+    section("26. Microcache des réponses CGI / proxy (cache_valid)")
+    tag = str(int(time.time() * 1000))
+
+    def exchange(s, path, extra=""):
+        s.sendall(f"GET {path} HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n{extra}\r\n".encode())
+        raw = read_response(s)
+        _, headers, _ = parse_response(raw)
+        body = raw.split(b"\r\n\r\n", 1)[1]
+        if headers.get("transfer-encoding") == "chunked":
+            body = dechunk(body)
+        return headers.get("x-cache-status"), body.decode()
+
+    def one_shot(path, out):
+        try:
+            c = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+            start = time.time()
+            status, body = exchange(c, path)
+            out.append((status, body, time.time() - start))
+            c.close()
+        except Exception as e:
+            out.append((None, str(e), 0))
+
+    try:
+        # Le cache est propre à chaque worker : une seule connexion keep-alive
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        url = f"/cached/clock.py?t={tag}"
+        first = exchange(s, url)
+        second = exchange(s, url)
+        check("Première requête → MISS", first[0] == "MISS", str(first))
+        check("Seconde requête → HIT, même contenu",
+              second[0] == "HIT" and second[1] == first[1], str(second))
+
+        bypass = exchange(s, url, "X-Cache-Bypass: 1\r\n")
+        after = exchange(s, url)
+        check("cache_bypass → BYPASS avec une réponse neuve",
+              bypass[0] == "BYPASS" and bypass[1] != first[1], str(bypass))
+        check("La réponse du bypass remplace l'entrée",
+              after[0] == "HIT" and after[1] == bypass[1], str(after))
+
+        for query, label in (("cc=no-store", "Cache-Control: no-store"),
+                             ("cookie=1", "Set-Cookie")):
+            path = f"/cached/clock.py?t={tag}&{query}"
+            runs = [exchange(s, path) for _ in range(2)]
+            check(f"{label} → jamais mis en cache",
+                  all(r[0] == "MISS" for r in runs) and runs[0][1] != runs[1][1], str(runs))
+
+        path = f"/cached/clock.py?t={tag}&vary=X-Lang"
+        fr = exchange(s, path, "X-Lang: fr\r\n")
+        en = exchange(s, path, "X-Lang: en\r\n")
+        fr2 = exchange(s, path, "X-Lang: fr\r\n")
+        check("Vary : une variante par valeur du header",
+              en[0] == "MISS" and "lang=en" in en[1] and fr2[0] == "HIT" and fr2[1] == fr[1],
+              f"{fr} {en} {fr2}")
+
+        # Entrée expirée : une requête la rafraîchit, les autres reçoivent l'ancienne
+        path = f"/cached/clock.py?t={tag}&cc=max-age=1&sleep=1"
+        old = exchange(s, path)
+        time.sleep(1.2)
+        refresh, others = [], []
+        t = threading.Thread(target=lambda: refresh.append(exchange(s, path)))
+        t.start()
+        time.sleep(0.3)
+        threads = [threading.Thread(target=one_shot, args=(path, others)) for _ in range(6)]
+        for th in threads:
+            th.start()
+        for th in threads + [t]:
+            th.join()
+        stale = [o for o in others if o[0] == "STALE"]
+        check("Entrée expirée → EXPIRED pour la requête qui la rafraîchit",
+              refresh and refresh[0][0] == "EXPIRED" and refresh[0][1] != old[1], str(refresh))
+        check("Pendant la mise à jour → STALE immédiat avec l'ancien contenu",
+              stale and all(o[1] == old[1] and o[2] < 0.5 for o in stale), str(others))
+        s.close()
+    except Exception as e:
+        check("Microcache", False, str(e))
+
+
+def test_request_framing():
+    section("27. Cadrage et découpage des requêtes (Transfer-Encoding / Content-Length / limites)")
+
+    def raw_exchange(data):
+        s = socket.create_connection((HOST1, PORT1), timeout=2)
+        s.sendall(data.encode())
+        response = read_all(s, b"<timeout>")
+        s.close()
+        return response
+
+    head = "POST / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\n"
+    for name, headers, expected in (
+        ("Transfer-Encoding: gzip + Content-Length → 400",
+         "Transfer-Encoding: gzip\r\nContent-Length: 3\r\n\r\nabc", 400),
+        ("Transfer-Encoding: chunked, gzip → 400",
+         "Transfer-Encoding: chunked, gzip\r\n\r\n", 400),
+        ("Transfer-Encoding: xchunked → 400",
+         "Transfer-Encoding: xchunked\r\n\r\n", 400),
+        ("Transfer-Encoding: gzip, chunked → 501",
+         "Transfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n", 501),
+        ("Deux Content-Length différents → 400",
+         "Content-Length: 0\r\nContent-Length: 40\r\n\r\n", 400),
+        ("Content-Length répété → 400",
+         "Content-Length: 3\r\nContent-Length: 3\r\n\r\nabc", 400),
+    ):
+        response = raw_exchange(head + headers)
+        code, hdrs, _ = parse_response(response)
+        check(name, code == expected and hdrs.get("connection") == "close"
+              and b"<timeout>" not in response, f"got {code} {hdrs.get('connection')}")
+
+    # chunked l'emporte, mais la connexion ne doit pas servir la requête suivante
+    response = raw_exchange(head + "Transfer-Encoding: chunked\r\nContent-Length: 5\r\n\r\n"
+                            "0\r\n\r\nGET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\n\r\n")
+    code, hdrs, _ = parse_response(response)
+    check("Transfer-Encoding + Content-Length → Connection: close",
+          code != 0 and hdrs.get("connection") == "close", f"got {code} {hdrs}")
+    check("Requête pipelinée derrière elle ignorée",
+          response.count(b"HTTP/1.1 ") == 1, response[:200])
+
+    # Découpage arbitraire : le parseur reprend là où le segment précédent s'arrête
+    def split_exchange(port, pieces, delay=0.02):
+        s = socket.create_connection((HOST1, port), timeout=2)
+        s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        for piece in pieces:
+            s.sendall(piece.encode())
+            time.sleep(delay)
+        response = read_all(s, b"<timeout>")
+        s.close()
+        return response
+
+    request = "GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n\r\n"
+    code, _, _ = parse_response(split_exchange(PORT1, list(request), 0.005))
+    check("En-têtes reçus octet par octet → 200", code == 200, f"got {code}")
+
+    code, _, body = parse_response(split_exchange(PORT2, [
+        "PO", "ST /scr", "ipts/hello.py HTTP/1.1\r", "\nHost: 127.0.0.1:8081\r\nContent-Le",
+        "ngth: 19\r\nConnection: close\r\n\r", "\nmessage=hel", "lo+world"]))
+    check("Ligne de requête, en-têtes et body coupés au milieu",
+          code == 200 and "message=hello" in body, f"got {code}")
+
+    code, _, body = parse_response(split_exchange(PORT2, [
+        "POST /scripts/hello.py HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+        "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n",
+        "1", "3\r", "\nmessage=he", "llo+world\r", "\n0", "\r\n", "\r\n"]))
+    check("Taille de chunk et CRLF coupés entre deux segments",
+          code == 200 and "message=hello" in body, f"got {code}")
+
+    response = raw_exchange("GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\n\r\n"
+                            "GET /index.html HTTP/1.1\r\nHost: 127.0.0.1:8080\r\n\r\n"
+                            "GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n\r\n")
+    check("Trois requêtes pipelinées dans un segment → trois réponses",
+          response.count(b"HTTP/1.1 200") == 3, response[:200])
+
+    base = "GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n"
+    for name, extra, expected in (
+        ("Ligne d'en-tête de plus de 8 Kio → 400", "X-Big: " + "a" * 9000 + "\r\n", 400),
+        ("Section d'en-têtes de plus de 32 Kio → 400",
+         "".join(f"X-Part{i}: {'b' * 7000}\r\n" for i in range(5)), 400),
+        ("101 en-têtes → 400", "".join(f"X-H{i}: v\r\n" for i in range(99)), 400),
+        ("100 en-têtes acceptés", "".join(f"X-H{i}: v\r\n" for i in range(98)), 200),
+    ):
+        response = raw_exchange(base + extra + "\r\n")
+        code, _, _ = parse_response(response)
+        check(name, code == expected and b"<timeout>" not in response, f"got {code}")
+
+
+def test_async_cgi():
+    section("28. CGI asynchrone (script lent, autres clients servis, client parti)")
+
+    def running_scripts():
+        out = subprocess.run(["ps", "-eo", "args"], capture_output=True, text=True).stdout
+        return sum(1 for l in out.splitlines() if l.endswith("clock.py"))
+
+    try:
+        # Script lent en cours : la boucle d'événements sert les autres clients
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        s.sendall(b"GET /scripts/clock.py?sleep=3 HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+                  b"Connection: close\r\n\r\n")
+        time.sleep(0.3)
+        start = time.time()
+        code, _, _ = send_raw(HOST1, PORT1,
+            "GET / HTTP/1.1\r\nHost: 127.0.0.1:8080\r\nConnection: close\r\n\r\n")
+        elapsed = time.time() - start
+        check("GET statique servi pendant un CGI de 3 s", code == 200 and elapsed < 0.3,
+              f"got {code} en {elapsed:.2f}s")
+        response = read_all(s)
+        s.close()
+        check("Réponse du script lent reçue ensuite", response.startswith(b"HTTP/1.1 200"),
+              response[:80])
+    except Exception as e:
+        check("CGI asynchrone", False, str(e))
+
+    try:
+        before = running_scripts()
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        s.sendall(b"GET /scripts/clock.py?sleep=6 HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n\r\n")
+        time.sleep(0.5)
+        started = running_scripts()
+        s.close()
+        time.sleep(0.5)
+        check("Client parti → script arrêté aussitôt",
+              started > before and running_scripts() == before,
+              f"avant={before} pendant={started} après={running_scripts()}")
+    except Exception as e:
+        check("CGI asynchrone", False, str(e))
+
+
+def test_cgi_streaming():
+    section("29. Sortie CGI en flux (chunked / Content-Length / HTTP/1.0)")
+
+    def stream(query, version="HTTP/1.1"):
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        s.sendall(f"GET /scripts/stream.py?{query} {version}\r\nHost: 127.0.0.1:8081\r\n"
+                  f"Connection: close\r\n\r\n".encode())
+        start, first, data = time.time(), None, b""
+        while True:
+            chunk = s.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+            if first is None and b"part 0" in data:
+                first = time.time() - start
+        s.close()
+        head, _, body = data.partition(b"\r\n\r\n")
+        headers = dict(l.lower().split(": ", 1) for l in head.decode().split("\r\n")[1:] if ": " in l)
+        return head.decode().split("\r\n")[0], headers, body, first, time.time() - start
+
+    expected = b"part 0\npart 1\npart 2\n"
+    try:
+        status, headers, body, first, total = stream("parts=3&delay=1")
+        check("Premiers octets avant la fin du script",
+              first is not None and first < 0.8 and total >= 1.8, f"premier={first} total={total:.2f}")
+        check("Sans longueur du script → Transfer-Encoding: chunked",
+              status.startswith("HTTP/1.1 200") and headers.get("transfer-encoding") == "chunked"
+              and "content-length" not in headers and dechunk(body) == expected,
+              f"{status} {headers} {body[:80]}")
+
+        status, headers, body, _, _ = stream("parts=3&length=exact")
+        check("Content-Length du script transmis tel quel",
+              headers.get("content-length") == str(len(expected))
+              and "transfer-encoding" not in headers and body == expected, f"{headers} {body[:80]}")
+
+        status, headers, body, first, total = stream("parts=3&delay=0.5", "HTTP/1.0")
+        check("HTTP/1.0 : corps délimité par la fermeture",
+              " 200 " in status and headers.get("connection") == "close", f"{status} {headers}")
+        check("HTTP/1.0 : ni chunked ni longueur, corps complet",
+              "transfer-encoding" not in headers and "content-length" not in headers
+              and body == expected and first is not None and first < total - 0.5,
+              f"{headers} {body[:80]} premier={first} total={total:.2f}")
+    except Exception as e:
+        check("Sortie CGI en flux", False, str(e))
+
+def test_worker_processes():
+    section("30. Workers (worker_processes 2, relance d'un worker tué)")
+
+    # Deuxième instance sur d'autres ports, même configuration sinon
+    conf = "/tmp/webserv-workers-test.conf"
+    with open("config/server.conf") as f:
+        text = f.read()
+    text = text.replace("worker_processes 1;", "worker_processes 2;")
+    text = text.replace("/tmp/webserv-cache", "/tmp/webserv-cache-workers")
+    for port in ("8080", "8081", "8082"):
+        text = text.replace(f"127.0.0.1:{port}", f"127.0.0.1:{int(port) + 100}")
+    with open(conf, "w") as f:
+        f.write(text)
+
+    def workers(master):
+        out = subprocess.run(["ps", "-o", "pid=", "--ppid", str(master.pid)],
+                             capture_output=True, text=True).stdout
+        return sorted(int(p) for p in out.split())
+
+    def burst(n):
+        codes = []
+        def one():
+            code, _, _ = send_raw(HOST1, PORT1 + 100,
+                "GET / HTTP/1.1\r\nHost: 127.0.0.1:8180\r\nConnection: close\r\n\r\n")
+            codes.append(code)
+        threads = [threading.Thread(target=one) for _ in range(n)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        return codes
+
+    master = subprocess.Popen(["./webserv", conf], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        time.sleep(1)
+        pids = workers(master)
+        check("Deux workers démarrés", len(pids) == 2, str(pids))
+        codes = burst(20)
+        check("20 requêtes concurrentes → 200", codes.count(200) == 20, str(codes))
+
+        os.kill(pids[0], 9)
+        time.sleep(0.5)
+        after = workers(master)
+        check("Worker tué → relancé par le maître",
+              len(after) == 2 and pids[0] not in after and pids[1] in after, f"{pids} → {after}")
+        codes = burst(20)
+        check("Service complet après la relance", codes.count(200) == 20, str(codes))
+    except Exception as e:
+        check("Workers", False, str(e))
+    finally:
+        master.terminate()
+        master.wait()
+        os.remove(conf)
+
+def test_file_caches():
+    section("31. Caches de fichiers (open_file_cache / content_cache)")
+
+    def exchange(s, request):
+        s.sendall(request.encode())
+        code, _, body = parse_response(read_response(s))
+        return code, body
+
+    def get(s, name):
+        return exchange(s, f"GET /drop/{name} HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n\r\n")
+
+    def upload(s, name, data):
+        return exchange(s, f"POST /drop/{name} HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n"
+                           f"Content-Length: {len(data)}\r\n\r\n{data}")[0]
+
+    store = "www/server2/uploads"
+    names = [f"cache_{n}_{int(time.time() * 1000)}.txt" for n in ("up", "edit", "gone")]
+    try:
+        # Caches propres à chaque worker : une seule connexion, un seul worker
+        s = socket.create_connection((HOST2, PORT2), timeout=TIMEOUT)
+        up, edit, gone = names
+        upload(s, up, "first")
+        get(s, up)
+        check("Upload remplaçant un fichier en cache → servi aussitôt",
+              upload(s, up, "second") == 201 and get(s, up) == (200, "second"), str(get(s, up)))
+        exchange(s, f"DELETE /drop/{up} HTTP/1.1\r\nHost: 127.0.0.1:8081\r\n\r\n")
+        check("DELETE d'un fichier en cache → 404 aussitôt", get(s, up)[0] == 404, str(get(s, up)))
+
+        # Modifié ou supprimé hors du serveur : frais une fois "valid" (5 s) écoulé
+        for name, data in ((edit, "old"), (gone, "here")):
+            with open(f"{store}/{name}", "w") as f:
+                f.write(data)
+            get(s, name)
+        with open(f"{store}/{edit}", "w") as f:
+            f.write("new content")
+        os.remove(f"{store}/{gone}")
+        time.sleep(5.5)
+        check("Fichier modifié sur disque → frais après valid",
+              get(s, edit) == (200, "new content"), str(get(s, edit)))
+        check("Fichier supprimé sur disque → 404 après valid",
+              get(s, gone)[0] == 404, str(get(s, gone)))
+        s.close()
+    except Exception as e:
+        check("Caches de fichiers", False, str(e))
+    finally:
+        for name in names:
+            if os.path.exists(f"{store}/{name}"):
+                os.remove(f"{store}/{name}")
+
 # ═══════════════════════════════════════════════════════════════════════════════
 # MAIN
 # ═══════════════════════════════════════════════════════════════════════════════
@@ -546,6 +1493,22 @@ if __name__ == "__main__":
     test_server_resilience()
     test_multiple_ports_independence()
     test_content_length_header()
+    test_keep_alive()
+    test_fastcgi()
+    test_client_timeouts()
+    test_conditional_requests()
+    test_byte_ranges()
+    test_gzip_static()
+    test_gzip_dynamic()
+    test_body_spool()
+    test_multipart_upload()
+    test_reverse_proxy()
+    test_response_cache()
+    test_request_framing()
+    test_async_cgi()
+    test_cgi_streaming()
+    test_worker_processes()
+    test_file_caches()
 
     elapsed = time.time() - start
     total = passed + failed
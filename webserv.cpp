@@ -22,9 +22,9 @@ int main(int argc, char **argv) {
 
 		std::cout << "✓ Loaded " << servers.size() << " server(s) from " << configPath << std::endl;
 
-		server webServer(servers);
+		server webServer(servers, parser.getGlobalConfig());
 		std::cout << "✓ Server setup successful. Starting..." << std::endl;
-		webServer.run();
+		webServer.start();
 	}
 	catch (const ConfigParserE &e) {
 		std::cerr << "✗ Config parsing error: " << e.what() << std::endl;
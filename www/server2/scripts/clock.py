@@ -0,0 +1,19 @@
+#!/usr/bin/env python3
+import os
+import time
+from urllib.parse import parse_qs
+
+# Réponse différente à chaque exécution : sert à vérifier le microcache
+query = parse_qs(os.environ.get("QUERY_STRING", ""))
+time.sleep(float(query.get("sleep", ["0"])[0]))
+
+print("Content-Type: text/plain")
+if "cc" in query:
+    print("Cache-Control: " + query["cc"][0])
+if "vary" in query:
+    print("Vary: " + query["vary"][0])
+if "cookie" in query:
+    print("Set-Cookie: session=" + str(os.getpid()))
+print("")
+print("generated={}".format(time.time_ns()))
+print("lang={}".format(os.environ.get("HTTP_X_LANG", "")))
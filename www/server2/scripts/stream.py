@@ -0,0 +1,26 @@
+#!/usr/bin/env python3
+import os
+import sys
+import time
+from urllib.parse import parse_qs
+
+# Corps écrit en plusieurs morceaux, avec une pause entre chacun :
+# sert à vérifier l'envoi au fil de l'eau (chunked, Content-Length, HTTP/1.0)
+query = parse_qs(os.environ.get("QUERY_STRING", ""))
+parts = int(query.get("parts", ["3"])[0])
+delay = float(query.get("delay", ["0"])[0])
+chunks = ["part {}\n".format(i) for i in range(parts)]
+
+sys.stdout.write("Content-Type: text/plain\r\n")
+if "length" in query:
+    length = query["length"][0]
+    if length == "exact":
+        length = str(sum(len(c) for c in chunks))
+    sys.stdout.write("Content-Length: " + length + "\r\n")
+sys.stdout.write("\r\n")
+sys.stdout.flush()
+for i, chunk in enumerate(chunks):
+    if i:
+        time.sleep(delay)
+    sys.stdout.write(chunk)
+    sys.stdout.flush()